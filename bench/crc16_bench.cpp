@@ -0,0 +1,166 @@
+/**
+ * @file crc16_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Verifies every gss_crc16 implementation against crc16(...) and times them.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Exits with 1 if any implementation disagrees with the reference on any input, so `make bench` doubles as the equivalence check.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gss.hpp"
+#include "gss_crc.hpp"
+
+#define BENCH_BUFFER_SIZE (0x10000 + 64)
+#define BENCH_RANDOM_TRIALS 20000
+#define BENCH_TARGET_BYTES (256ULL << 20) // Bytes hashed per timing measurement.
+
+typedef struct
+{
+    const char *name;
+    gss_crc16_fn fn;
+} bench_impl_t;
+
+static uint16_t bench_reference(const unsigned char *data, size_t length)
+{
+    return crc16((unsigned char *)data, (uint16_t)length);
+}
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Compares one implementation against the reference.
+ *
+ * @return int Number of mismatches.
+ */
+static int bench_verify(const bench_impl_t *impl, unsigned char *buffer)
+{
+    int mismatches = 0;
+
+    // Exhaustive over every one and two byte input.
+    for (int value = 0; value < 0x10000; value++)
+    {
+        unsigned char input[2] = {(unsigned char)(value & 0xff), (unsigned char)(value >> 8)};
+        for (size_t length = 1; length <= 2; length++)
+        {
+            if (length == 1 && value > 0xff)
+            {
+                continue;
+            }
+            if (impl->fn(input, length) != bench_reference(input, length))
+            {
+                if (mismatches++ < 5)
+                {
+                    printf("  %s: mismatch on %zu byte input 0x%04x.\n", impl->name, length, value);
+                }
+            }
+        }
+    }
+
+    // Every length up to 4 KiB at every alignment within a 16-byte block, then random lengths and offsets up to the 16-bit limit.
+    for (size_t length = 0; length <= 4096; length++)
+    {
+        size_t offset = length % 16;
+        if (impl->fn(buffer + offset, length) != bench_reference(buffer + offset, length))
+        {
+            if (mismatches++ < 5)
+            {
+                printf("  %s: mismatch at length %zu, offset %zu.\n", impl->name, length, offset);
+            }
+        }
+    }
+
+    for (int trial = 0; trial < BENCH_RANDOM_TRIALS; trial++)
+    {
+        size_t length = rand() % 0x10000;
+        size_t offset = rand() % 64;
+        if (impl->fn(buffer + offset, length) != bench_reference(buffer + offset, length))
+        {
+            if (mismatches++ < 5)
+            {
+                printf("  %s: mismatch at length %zu, offset %zu.\n", impl->name, length, offset);
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+static void bench_time(const bench_impl_t *impl, const unsigned char *buffer, size_t length)
+{
+    size_t iterations = BENCH_TARGET_BYTES / length;
+    if (impl->fn == bench_reference)
+    {
+        iterations /= 16; // The reference is slow enough that a sixteenth still gives a stable number.
+    }
+    if (iterations == 0)
+    {
+        iterations = 1;
+    }
+
+    volatile uint16_t sink = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        sink ^= impl->fn(buffer, length);
+    }
+    double elapsed = bench_now() - start;
+    (void)sink;
+
+    printf("  %-12s %6zu B  %9.1f ns/call  %9.1f MB/s\n", impl->name, length, elapsed * 1e9 / iterations, (double)length * iterations / elapsed / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned char *buffer = (unsigned char *)malloc(BENCH_BUFFER_SIZE);
+    srand(argc > 1 ? atoi(argv[1]) : (unsigned int)time(NULL));
+    for (int i = 0; i < BENCH_BUFFER_SIZE; i++)
+    {
+        buffer[i] = rand() & 0xff;
+    }
+
+    bench_impl_t impls[4];
+    int num_impls = 0;
+    impls[num_impls++] = {"reference", bench_reference};
+    impls[num_impls++] = {"slice-by-8", gss_crc16_table};
+    if (gss_crc16_clmul_supported())
+    {
+        impls[num_impls++] = {"clmul", gss_crc16_clmul};
+    }
+    impls[num_impls++] = {"dispatch", gss_crc16};
+
+    printf("crc16: dispatching to %s.\n", gss_crc16_implementation());
+
+    int mismatches = 0;
+    for (int i = 1; i < num_impls; i++)
+    {
+        int impl_mismatches = bench_verify(&impls[i], buffer);
+        printf("  %-12s %s (%d mismatches)\n", impls[i].name, impl_mismatches ? "FAILED" : "matches reference", impl_mismatches);
+        mismatches += impl_mismatches;
+    }
+
+    const size_t lengths[] = {16, 64, 256, 1024, 4096, 0xffff};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        for (int i = 0; i < num_impls; i++)
+        {
+            bench_time(&impls[i], buffer, lengths[l]);
+        }
+    }
+
+    free(buffer);
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file gss_frame_test.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Checks that receiving a frame at a time recovers the frames swallowed by a rejected one: a header whose GUID matched by chance, a corrupt payload size, or a corrupt payload.
+ * @version 0.1
+ * @date 2026.10.17
+ *
+ * Receives like the RX threads do in frame mode (gss_network_rx_thread(...)), over a socket pair. Exits with 1 on the first frame lost or out of order.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "gss_frame.hpp"
+#include "gss_pool.hpp"
+
+#define TEST_TIMEOUT_MS 200
+#define TEST_MAX_FRAMES 16
+
+static int test_failures = 0;
+
+static void test_expect(bool condition, const char *format, ...)
+{
+    if (condition)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "FAIL: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    test_failures++;
+}
+
+/**
+ * @brief Writes a valid frame numbered by its netstat, so it can be told apart when received.
+ *
+ */
+static void test_send_frame(int sock, uint8_t sequence, int payload_size)
+{
+    unsigned char payload[GSS_FRAME_MAX_PAYLOAD_SIZE];
+    unsigned char frame[GSS_FRAME_MAX_SIZE];
+    memset(payload, sequence, payload_size);
+    ssize_t frame_size = gss_frame_build(frame, (NetType)1, (NetVertex)1, (NetVertex)0, sequence, payload, payload_size);
+    gss_frame_send(sock, frame, frame_size);
+}
+
+/**
+ * @brief Writes a header whose GUID is right but which is no frame: it claims payload_size bytes and a CRC that nothing after it matches.
+ *
+ */
+static void test_send_bogus_header(int sock, int payload_size)
+{
+    gss_frame_header_t header;
+    memset(&header, 0x0, sizeof(header));
+    header.guid = GSS_FRAME_GUID;
+    header.crc1 = 0x5a5a;
+    header.type = 1;
+    header.payload_size = payload_size;
+    gss_frame_send(sock, (const unsigned char *)&header, sizeof(header));
+}
+
+/**
+ * @brief Receives until the socket times out with nothing pending, as gss_network_rx_thread(...) does in frame mode, and records each frame's sequence number.
+ *
+ * @param drops Receive every frame as one going nowhere (gss_frame_discard_body(...)).
+ * @return int Frames received.
+ */
+static int test_receive(int sock, gss_pool_t *pool, gss_frame_decoder_t *decoder, bool drops, uint8_t *sequences)
+{
+    int received = 0;
+
+    while (received < TEST_MAX_FRAMES)
+    {
+        gss_frame_header_t header;
+        if (gss_frame_recv_header(sock, &header, NULL, NULL) < 0)
+        {
+            break;
+        }
+
+        unsigned char *frame = NULL;
+        ssize_t read_size;
+        if (drops)
+        {
+            read_size = gss_frame_discard_body(sock, &header, decoder);
+        }
+        else
+        {
+            read_size = gss_frame_recv_body(sock, &header, pool, &frame, decoder);
+        }
+
+        if (read_size < 0 && (errno == EBADMSG || errno == EAGAIN))
+        {
+            gss_frame_decoder_resync(decoder);
+
+            size_t skipped;
+            while (received < TEST_MAX_FRAMES && (read_size = gss_frame_decoder_recv(decoder, sock, &skipped)) > 0)
+            {
+                sequences[received++] = ((gss_frame_header_t *)decoder->buffer)->netstat;
+                gss_frame_decoder_consume(decoder, read_size);
+            }
+            test_expect(read_size == 0 && decoder->length == 0, "resynchronizing failed (%ld).", (long)read_size);
+            continue;
+        }
+        else if (read_size < 0)
+        {
+            break;
+        }
+
+        sequences[received++] = header.netstat;
+        gss_pool_put(pool, frame);
+    }
+
+    return received;
+}
+
+static void test_expect_sequences(const uint8_t *sequences, int received, const uint8_t *expected, int num_expected, const char *name)
+{
+    test_expect(received == num_expected, "%s: received %d frames, expected %d.", name, received, num_expected);
+    for (int i = 0; i < received && i < num_expected; i++)
+    {
+        test_expect(sequences[i] == expected[i], "%s: frame %d is %u, expected %u.", name, i, sequences[i], expected[i]);
+    }
+}
+
+int main()
+{
+    gss_pool_t *pool = gss_pool_create();
+    gss_frame_decoder_t *decoder = new gss_frame_decoder_t;
+    gss_frame_decoder_reset(decoder);
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = TEST_TIMEOUT_MS * 1000;
+    setsockopt(sockets[1], SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    uint8_t sequences[TEST_MAX_FRAMES];
+    int received;
+
+    // A chance GUID whose payload covers the next two frames and part of a third; all three are recovered.
+    {
+        test_send_frame(sockets[0], 1, 100);
+        test_send_bogus_header(sockets[0], 2 * (GSS_FRAME_OVERHEAD + 300) + 50);
+        test_send_frame(sockets[0], 2, 300);
+        test_send_frame(sockets[0], 3, 300);
+        test_send_frame(sockets[0], 4, 300);
+        test_send_frame(sockets[0], 5, 10);
+        received = test_receive(sockets[1], pool, decoder, false, sequences);
+        const uint8_t expected[] = {1, 2, 3, 4, 5};
+        test_expect_sequences(sequences, received, expected, 5, "chance GUID");
+    }
+
+    // A payload size which runs past everything that was sent: the frames are recovered once the rest never comes, and receiving carries on in step.
+    {
+        test_send_bogus_header(sockets[0], 60000);
+        test_send_frame(sockets[0], 6, 1000);
+        test_send_frame(sockets[0], 7, 0);
+        received = test_receive(sockets[1], pool, decoder, false, sequences);
+        const uint8_t expected[] = {6, 7};
+        test_expect_sequences(sequences, received, expected, 2, "corrupt payload size");
+
+        test_send_frame(sockets[0], 8, 2000);
+        received = test_receive(sockets[1], pool, decoder, false, sequences);
+        const uint8_t after[] = {8};
+        test_expect_sequences(sequences, received, after, 1, "after corrupt payload size");
+    }
+
+    // A genuine frame with a corrupt payload costs that frame alone.
+    {
+        unsigned char frame[GSS_FRAME_MAX_SIZE];
+        unsigned char payload[500];
+        memset(payload, 9, sizeof(payload));
+        ssize_t frame_size = gss_frame_build(frame, (NetType)1, (NetVertex)1, (NetVertex)0, 0, payload, sizeof(payload));
+        frame[sizeof(gss_frame_header_t) + 200] ^= 0x40;
+        // And a GUID inside its payload, claiming more than is left of it.
+        int32_t claimed = 1000;
+        frame[sizeof(gss_frame_header_t) + 10] = GSS_FRAME_GUID & 0xff;
+        frame[sizeof(gss_frame_header_t) + 11] = GSS_FRAME_GUID >> 8;
+        memcpy(frame + sizeof(gss_frame_header_t) + 10 + offsetof(gss_frame_header_t, payload_size), &claimed, sizeof(claimed));
+        gss_frame_send(sockets[0], frame, frame_size);
+        test_send_frame(sockets[0], 10, 40);
+        test_send_frame(sockets[0], 11, 4000);
+        received = test_receive(sockets[1], pool, decoder, false, sequences);
+        const uint8_t expected[] = {10, 11};
+        test_expect_sequences(sequences, received, expected, 2, "corrupt payload");
+    }
+
+    // The same for frames going nowhere, which are received into the decoder alone.
+    {
+        test_send_frame(sockets[0], 12, 20);
+        test_send_bogus_header(sockets[0], GSS_FRAME_OVERHEAD + 20 + 6);
+        test_send_frame(sockets[0], 13, 20);
+        test_send_frame(sockets[0], 14, 20);
+        received = test_receive(sockets[1], pool, decoder, true, sequences);
+        const uint8_t expected[] = {12, 13, 14};
+        test_expect_sequences(sequences, received, expected, 3, "going nowhere");
+    }
+
+    close(sockets[0]);
+    close(sockets[1]);
+    delete decoder;
+    gss_pool_destroy(pool);
+
+    if (test_failures > 0)
+    {
+        fprintf(stderr, "%d frame checks failed.\n", test_failures);
+        return 1;
+    }
+
+    printf("Frame resynchronization checks passed.\n");
+    return 0;
+}
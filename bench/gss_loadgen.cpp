@@ -0,0 +1,576 @@
+/**
+ * @file gss_loadgen.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Synthetic vertex simulator which drives a running server and measures forwarding throughput and latency.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Usage: gss_loadgen.out [-H host] [-m poll|xband|command|mixed] [-n frames] [-s xband_payload] [-w window] [-R rate]
+ *
+ * Connects to all five ports (54200 through 54240) as the GUI client and the four radios, then replays a frame mix:
+ *   poll     Every vertex polls the server as fast as its window allows (latency is poll to response).
+ *   xband    Roof X-Band sends large payloads (-s, default 60000 bytes) to the client.
+ *   command  The client sends small commands to every radio and every radio answers the client.
+ *   mixed    All of the above at once.
+ * -n frames are sent per stream, with at most -w (default 64) unanswered per stream, optionally paced to -R frames per second per stream.
+ *
+ * Every data frame carries its send time, so the simulator must run on the same host as the server. Run the server without -n or -b, since unsolicited netstat frames look like poll responses.
+ *
+ * Exits with 1 if it cannot connect or nothing arrives.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <atomic>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "gss.hpp"
+#include "gss_frame.hpp"
+#include "gss_pool.hpp"
+#include "gss_topology.hpp"
+
+#define LOADGEN_MAGIC 0x474c5347 // "GSLG"
+#define LOADGEN_MAX_STREAMS 16
+#define LOADGEN_DEFAULT_FRAMES 10000
+#define LOADGEN_DEFAULT_XBAND_SIZE 60000
+#define LOADGEN_COMMAND_SIZE 64
+#define LOADGEN_DEFAULT_WINDOW 64
+#define LOADGEN_WINDOW_TIMEOUT_NS 100000000ULL // Frames still unanswered after the window has been full this long are written off as lost.
+#define LOADGEN_DRAIN_TIMEOUT_S 2 // How long to wait for stragglers once every frame has been sent.
+#define LOADGEN_READY_TIMEOUT_S 10 // How long to wait for the server to see every vertex connected.
+
+/**
+ * @brief The vertices of the default topology (see gss.conf), which the simulator plays; indices are also vertex IDs.
+ *
+ */
+enum LOADGEN_VERTEX
+{
+    LOADGEN_CLIENT = 0,
+    LOADGEN_ROOF_UHF,
+    LOADGEN_ROOF_XBAND,
+    LOADGEN_HAYSTACK,
+    LOADGEN_TRACK,
+    LOADGEN_NUM_VERTICES
+};
+
+/**
+ * @brief The start of every data frame's payload.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t stream;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint64_t sent_ns;
+} loadgen_stamp_t;
+
+/**
+ * @brief One direction of traffic between two vertices (or a vertex and the server).
+ *
+ */
+typedef struct
+{
+    char name[32];
+    int origin;
+    int destination; // A vertex, or (int)NetVertex::SERVER for polls.
+    int payload_size;
+
+    int num_frames;
+    uint64_t *sent_ns; // Indexed by sequence; used to match poll responses, which carry no stamp.
+    uint64_t *latency_ns; // One entry per frame received.
+
+    std::atomic<int> sent;
+    std::atomic<int> received;
+} loadgen_stream_t;
+
+typedef struct
+{
+    const char *host;
+    int sockets[LOADGEN_NUM_VERTICES];
+    loadgen_stream_t streams[LOADGEN_MAX_STREAMS];
+    int num_streams;
+    int window;
+    int rate;
+    std::atomic<bool> sending;
+    std::atomic<uint64_t> last_rx_ns;
+} loadgen_t;
+
+typedef struct
+{
+    loadgen_t *loadgen;
+    int vertex;
+} loadgen_args_t;
+
+static uint64_t loadgen_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void loadgen_add_stream(loadgen_t *loadgen, const char *name, int origin, int destination, int payload_size, int num_frames)
+{
+    loadgen_stream_t *stream = &loadgen->streams[loadgen->num_streams++];
+    snprintf(stream->name, sizeof(stream->name), "%s", name);
+    stream->origin = origin;
+    stream->destination = destination;
+    stream->payload_size = payload_size;
+    stream->num_frames = num_frames;
+    stream->sent_ns = new uint64_t[num_frames];
+    stream->latency_ns = new uint64_t[num_frames];
+    stream->sent = 0;
+    stream->received = 0;
+}
+
+static int loadgen_connect(const char *host, int port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0x0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1 || connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(sock);
+        return -1;
+    }
+
+    // Small frames should not wait on Nagle, or the latency measured is the kernel's.
+    int enable = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    // Lets receivers notice that the run is over.
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 200000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    return sock;
+}
+
+/**
+ * @brief Polls the server from the client until it reports every vertex connected.
+ *
+ * @return int 1 once ready, -1 on timeout or error.
+ */
+static int loadgen_wait_ready(loadgen_t *loadgen, gss_pool_t *pool)
+{
+    const uint8_t all_connected = GSS_NETSTAT_BIT(LOADGEN_CLIENT) | GSS_NETSTAT_BIT(LOADGEN_ROOF_UHF) | GSS_NETSTAT_BIT(LOADGEN_ROOF_XBAND) | GSS_NETSTAT_BIT(LOADGEN_HAYSTACK) | GSS_NETSTAT_BIT(LOADGEN_TRACK);
+    uint64_t deadline = loadgen_now_ns() + LOADGEN_READY_TIMEOUT_S * 1000000000ULL;
+
+    while (loadgen_now_ns() < deadline)
+    {
+        unsigned char poll_frame[GSS_FRAME_OVERHEAD];
+        ssize_t poll_size = gss_frame_build(poll_frame, NetType::POLL, NetVertex::CLIENT, NetVertex::SERVER, 0, NULL, 0);
+        if (gss_frame_send(loadgen->sockets[LOADGEN_CLIENT], poll_frame, poll_size) < 0)
+        {
+            return -1;
+        }
+
+        gss_frame_header_t header;
+        unsigned char *frame = NULL;
+        if (gss_frame_recv_header(loadgen->sockets[LOADGEN_CLIENT], &header, NULL, NULL) < 0 || gss_frame_recv_body(loadgen->sockets[LOADGEN_CLIENT], &header, pool, &frame, NULL) < 0)
+        {
+            continue;
+        }
+        gss_pool_put(pool, frame);
+
+        if ((header.netstat & all_connected) == all_connected)
+        {
+            return 1;
+        }
+
+        usleep(100000);
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Sends every stream originating at one vertex, round-robin, within each stream's window.
+ *
+ * @return void* NULL
+ */
+static void *loadgen_sender_thread(void *args_vp)
+{
+    loadgen_args_t *args = (loadgen_args_t *)args_vp;
+    loadgen_t *loadgen = args->loadgen;
+    int sock = loadgen->sockets[args->vertex];
+
+    unsigned char *frame = new unsigned char[GSS_FRAME_MAX_SIZE];
+    unsigned char *payload = new unsigned char[GSS_FRAME_MAX_PAYLOAD_SIZE];
+    for (int i = 0; i < GSS_FRAME_MAX_PAYLOAD_SIZE; i++)
+    {
+        payload[i] = i & 0xff;
+    }
+
+    uint64_t interval_ns = loadgen->rate > 0 ? 1000000000ULL / loadgen->rate : 0;
+    uint64_t next_ns[LOADGEN_MAX_STREAMS];
+    uint64_t window_since_ns[LOADGEN_MAX_STREAMS] = {0};
+    int written_off[LOADGEN_MAX_STREAMS] = {0};
+    for (int s = 0; s < LOADGEN_MAX_STREAMS; s++)
+    {
+        next_ns[s] = loadgen_now_ns();
+    }
+
+    bool pending = true;
+    while (pending)
+    {
+        pending = false;
+        bool sent_any = false;
+
+        for (int s = 0; s < loadgen->num_streams; s++)
+        {
+            loadgen_stream_t *stream = &loadgen->streams[s];
+            if (stream->origin != args->vertex)
+            {
+                continue;
+            }
+
+            int sequence = stream->sent.load(std::memory_order_relaxed);
+            if (sequence >= stream->num_frames)
+            {
+                continue;
+            }
+            pending = true;
+
+            // Hold off while the window is full, unless the frames in it look lost.
+            uint64_t now = loadgen_now_ns();
+            int outstanding = sequence - stream->received.load(std::memory_order_acquire) - written_off[s];
+            if (outstanding >= loadgen->window)
+            {
+                if (window_since_ns[s] == 0)
+                {
+                    window_since_ns[s] = now;
+                }
+                if (now - window_since_ns[s] < LOADGEN_WINDOW_TIMEOUT_NS)
+                {
+                    continue;
+                }
+                written_off[s] += outstanding;
+            }
+            window_since_ns[s] = 0;
+
+            if (interval_ns > 0 && now < next_ns[s])
+            {
+                continue;
+            }
+            next_ns[s] += interval_ns;
+            sent_any = true;
+
+            ssize_t frame_size;
+            stream->sent_ns[sequence] = loadgen_now_ns();
+            if (stream->destination == (int)NetVertex::SERVER)
+            {
+                frame_size = gss_frame_build(frame, NetType::POLL, (NetVertex)stream->origin, NetVertex::SERVER, 0, NULL, 0);
+            }
+            else
+            {
+                loadgen_stamp_t *stamp = (loadgen_stamp_t *)payload;
+                stamp->magic = LOADGEN_MAGIC;
+                stamp->stream = s;
+                stamp->reserved = 0;
+                stamp->sequence = sequence;
+                stamp->sent_ns = stream->sent_ns[sequence];
+                frame_size = gss_frame_build(frame, NetType::DATA, (NetVertex)stream->origin, (NetVertex)stream->destination, 0, payload, stream->payload_size);
+            }
+
+            // Counted before sending, so a fast response never finds received ahead of sent.
+            stream->sent.store(sequence + 1, std::memory_order_release);
+            if (gss_frame_send(sock, frame, frame_size) < 0)
+            {
+                fprintf(stderr, "%s: send failed: %s\n", stream->name, strerror(errno));
+                stream->sent.store(stream->num_frames, std::memory_order_relaxed);
+            }
+        }
+
+        if (!sent_any)
+        {
+            sched_yield();
+        }
+    }
+
+    delete[] frame;
+    delete[] payload;
+
+    return NULL;
+}
+
+/**
+ * @brief Receives everything sent to one vertex and records each frame's latency against its stream.
+ *
+ * @return void* NULL
+ */
+static void *loadgen_receiver_thread(void *args_vp)
+{
+    loadgen_args_t *args = (loadgen_args_t *)args_vp;
+    loadgen_t *loadgen = args->loadgen;
+    int sock = loadgen->sockets[args->vertex];
+    gss_pool_t *pool = gss_pool_create();
+
+    // Poll responses come back to whoever polled, in order, with nothing in them to match on.
+    loadgen_stream_t *poll_stream = NULL;
+    for (int s = 0; s < loadgen->num_streams; s++)
+    {
+        if (loadgen->streams[s].origin == args->vertex && loadgen->streams[s].destination == (int)NetVertex::SERVER)
+        {
+            poll_stream = &loadgen->streams[s];
+        }
+    }
+
+    while (true)
+    {
+        gss_frame_header_t header;
+        unsigned char *frame = NULL;
+        ssize_t read_size = gss_frame_recv_header(sock, &header, NULL, NULL);
+        if (read_size >= 0)
+        {
+            read_size = gss_frame_recv_body(sock, &header, pool, &frame, NULL);
+        }
+
+        if (read_size == -404)
+        {
+            break;
+        }
+        else if (read_size < 0)
+        {
+            // Timed out; give up once senders are done and nothing has arrived for a while.
+            if (!loadgen->sending && loadgen_now_ns() - loadgen->last_rx_ns > LOADGEN_DRAIN_TIMEOUT_S * 1000000000ULL)
+            {
+                break;
+            }
+            continue;
+        }
+
+        uint64_t now = loadgen_now_ns();
+        loadgen->last_rx_ns = now;
+
+        loadgen_stream_t *stream = NULL;
+        uint64_t sent_ns = 0;
+        loadgen_stamp_t *stamp = (loadgen_stamp_t *)(frame + sizeof(gss_frame_header_t));
+
+        if (header.origin == (int)NetVertex::SERVER && header.payload_size == 0)
+        {
+            int received = poll_stream != NULL ? poll_stream->received.load(std::memory_order_relaxed) : 0;
+            if (poll_stream != NULL && received < poll_stream->sent.load(std::memory_order_acquire))
+            {
+                stream = poll_stream;
+                sent_ns = stream->sent_ns[received];
+            }
+        }
+        else if (header.payload_size >= (int)sizeof(loadgen_stamp_t) && stamp->magic == LOADGEN_MAGIC && stamp->stream < loadgen->num_streams)
+        {
+            stream = &loadgen->streams[stamp->stream];
+            sent_ns = stamp->sent_ns;
+        }
+
+        if (stream != NULL)
+        {
+            int received = stream->received.load(std::memory_order_relaxed);
+            if (received < stream->num_frames)
+            {
+                stream->latency_ns[received] = now - sent_ns;
+                stream->received.store(received + 1, std::memory_order_release);
+            }
+        }
+
+        gss_pool_put(pool, frame);
+    }
+
+    gss_pool_destroy(pool);
+
+    return NULL;
+}
+
+static double loadgen_percentile_us(const uint64_t *sorted, int count, double percentile)
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    int index = (int)(percentile * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+static void loadgen_report(const char *name, uint64_t *latency_ns, int sent, int received, uint64_t bytes, double elapsed)
+{
+    std::sort(latency_ns, latency_ns + received);
+    printf("  %-20s sent %8d  received %8d  lost %6d  %9.0f frames/s  %8.1f MB/s  p50 %8.1f us  p99 %8.1f us  p999 %8.1f us\n",
+           name, sent, received, sent - received, received / elapsed, bytes / elapsed / 1e6,
+           loadgen_percentile_us(latency_ns, received, 0.5), loadgen_percentile_us(latency_ns, received, 0.99), loadgen_percentile_us(latency_ns, received, 0.999));
+}
+
+int main(int argc, char *argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    loadgen_t *loadgen = new loadgen_t;
+    loadgen->host = "127.0.0.1";
+    loadgen->num_streams = 0;
+    loadgen->window = LOADGEN_DEFAULT_WINDOW;
+    loadgen->rate = 0;
+
+    const char *mix = "mixed";
+    int num_frames = LOADGEN_DEFAULT_FRAMES;
+    int xband_size = LOADGEN_DEFAULT_XBAND_SIZE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:m:n:s:w:R:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H':
+            loadgen->host = optarg;
+            break;
+        case 'm':
+            mix = optarg;
+            break;
+        case 'n':
+            num_frames = atoi(optarg);
+            break;
+        case 's':
+            xband_size = atoi(optarg);
+            break;
+        case 'w':
+            loadgen->window = atoi(optarg);
+            break;
+        case 'R':
+            loadgen->rate = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-H host] [-m poll|xband|command|mixed] [-n frames] [-s xband_payload] [-w window] [-R rate]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (num_frames < 1 || loadgen->window < 1 || loadgen->rate < 0 || xband_size < (int)sizeof(loadgen_stamp_t) || xband_size > GSS_FRAME_MAX_PAYLOAD_SIZE)
+    {
+        fprintf(stderr, "Frames and window must be positive, and the X-Band payload between %zu and %d bytes.\n", sizeof(loadgen_stamp_t), GSS_FRAME_MAX_PAYLOAD_SIZE);
+        return 1;
+    }
+
+    bool all = strcmp(mix, "mixed") == 0;
+    if (all || strcmp(mix, "poll") == 0)
+    {
+        const char *names[LOADGEN_NUM_VERTICES] = {"poll client", "poll roof uhf", "poll roof x-band", "poll haystack", "poll track"};
+        for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+        {
+            loadgen_add_stream(loadgen, names[i], i, (int)NetVertex::SERVER, 0, num_frames);
+        }
+    }
+    if (all || strcmp(mix, "xband") == 0)
+    {
+        loadgen_add_stream(loadgen, "x-band -> client", LOADGEN_ROOF_XBAND, LOADGEN_CLIENT, xband_size, num_frames);
+    }
+    if (all || strcmp(mix, "command") == 0)
+    {
+        const char *to_names[LOADGEN_NUM_VERTICES] = {"", "client -> roof uhf", "client -> x-band", "client -> haystack", "client -> track"};
+        const char *from_names[LOADGEN_NUM_VERTICES] = {"", "roof uhf -> client", "x-band cmd -> client", "haystack -> client", "track -> client"};
+        for (int i = LOADGEN_ROOF_UHF; i < LOADGEN_NUM_VERTICES; i++)
+        {
+            loadgen_add_stream(loadgen, to_names[i], LOADGEN_CLIENT, i, LOADGEN_COMMAND_SIZE, num_frames);
+            loadgen_add_stream(loadgen, from_names[i], i, LOADGEN_CLIENT, LOADGEN_COMMAND_SIZE, num_frames);
+        }
+    }
+    if (loadgen->num_streams == 0)
+    {
+        fprintf(stderr, "Unknown mix %s (expected poll, xband, command, or mixed).\n", mix);
+        return 1;
+    }
+
+    gss_topology_t topology;
+    gss_topology_default(&topology);
+    for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+    {
+        int port = topology.vertices[i].port;
+        loadgen->sockets[i] = loadgen_connect(loadgen->host, port);
+        if (loadgen->sockets[i] < 0)
+        {
+            fprintf(stderr, "Could not connect to %s:%d: %s\n", loadgen->host, port, strerror(errno));
+            return 1;
+        }
+    }
+
+    gss_pool_t *pool = gss_pool_create();
+    if (loadgen_wait_ready(loadgen, pool) < 0)
+    {
+        fprintf(stderr, "The server never reported every vertex connected.\n");
+        return 1;
+    }
+    gss_pool_destroy(pool);
+
+    printf("%s mix: %d streams, %d frames each, window %d, %s.\n", mix, loadgen->num_streams, num_frames, loadgen->window, loadgen->rate ? "paced" : "unpaced");
+
+    loadgen->sending = true;
+    loadgen->last_rx_ns = loadgen_now_ns();
+
+    pthread_t sender_pid[LOADGEN_NUM_VERTICES], receiver_pid[LOADGEN_NUM_VERTICES];
+    loadgen_args_t args[LOADGEN_NUM_VERTICES];
+    uint64_t start_ns = loadgen_now_ns();
+    for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+    {
+        args[i].loadgen = loadgen;
+        args[i].vertex = i;
+        pthread_create(&receiver_pid[i], NULL, loadgen_receiver_thread, &args[i]);
+        pthread_create(&sender_pid[i], NULL, loadgen_sender_thread, &args[i]);
+    }
+
+    for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+    {
+        pthread_join(sender_pid[i], NULL);
+    }
+    loadgen->sending = false;
+    for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+    {
+        pthread_join(receiver_pid[i], NULL);
+    }
+    double elapsed = (loadgen->last_rx_ns - start_ns) * 1e-9;
+
+    int total_sent = 0, total_received = 0;
+    uint64_t total_bytes = 0;
+    for (int s = 0; s < loadgen->num_streams; s++)
+    {
+        total_sent += loadgen->streams[s].sent;
+        total_received += loadgen->streams[s].received;
+    }
+    uint64_t *all_latency_ns = new uint64_t[total_received > 0 ? total_received : 1];
+
+    int offset = 0;
+    for (int s = 0; s < loadgen->num_streams; s++)
+    {
+        loadgen_stream_t *stream = &loadgen->streams[s];
+        uint64_t bytes = (uint64_t)stream->received * (GSS_FRAME_OVERHEAD + stream->payload_size);
+        total_bytes += bytes;
+        memcpy(all_latency_ns + offset, stream->latency_ns, stream->received * sizeof(uint64_t));
+        offset += stream->received;
+        loadgen_report(stream->name, stream->latency_ns, stream->sent, stream->received, bytes, elapsed);
+    }
+    loadgen_report("total", all_latency_ns, total_sent, total_received, total_bytes, elapsed);
+
+    for (int i = 0; i < LOADGEN_NUM_VERTICES; i++)
+    {
+        close(loadgen->sockets[i]);
+    }
+
+    return total_received > 0 ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file gss_lz4_test.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Checks gss_lz4_compress(...) and gss_lz4_decompress(...): blocks from the reference LZ4 encoder decode, every block compressed here decodes back to its input, and corrupted blocks are rejected without writing past the output buffer.
+ * @version 0.1
+ * @date 2026.10.17
+ *
+ * Exits with 1 on the first block which does not round trip or any write outside of the output buffer.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gss_compress.hpp"
+
+#define TEST_MAX_SIZE 0x10000
+#define TEST_CAPACITY (TEST_MAX_SIZE + TEST_MAX_SIZE / 255 + 16) // Worst case for incompressible input.
+#define TEST_GUARD 64 // Bytes after each output buffer which must never be written.
+#define TEST_ROUND_TRIPS 4000
+#define TEST_CORRUPTIONS 20000
+
+static int test_failures = 0;
+
+static void test_expect(bool condition, const char *format, ...)
+{
+    if (condition)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "FAIL: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    test_failures++;
+}
+
+// 200 bytes of "telemetry," repeated, compressed by LZ4_compress_default(...) (liblz4 1.9.4).
+static const unsigned char test_telemetry_block[] = {
+    0xaf, 0x74, 0x65, 0x6c, 0x65, 0x6d, 0x65, 0x74, 0x72, 0x79, 0x2c, 0x0a, 0x00, 0xa6, 0x50, 0x65,
+    0x74, 0x72, 0x79, 0x2c};
+
+// 40 literals (i * 37 + 11) then 400 zeros, compressed likewise; both lengths need extra length bytes, and the match overlaps itself.
+static const unsigned char test_zeros_block[] = {
+    0xff, 0x1a, 0x0b, 0x30, 0x55, 0x7a, 0x9f, 0xc4, 0xe9, 0x0e, 0x33, 0x58, 0x7d, 0xa2, 0xc7, 0xec,
+    0x11, 0x36, 0x5b, 0x80, 0xa5, 0xca, 0xef, 0x14, 0x39, 0x5e, 0x83, 0xa8, 0xcd, 0xf2, 0x17, 0x3c,
+    0x61, 0x86, 0xab, 0xd0, 0xf5, 0x1a, 0x3f, 0x64, 0x89, 0xae, 0x00, 0x01, 0x00, 0xff, 0x78, 0x50,
+    0x00, 0x00, 0x00, 0x00, 0x00};
+
+/**
+ * @brief Fills data with one of four kinds of payload: random bytes, a slow ramp, repetitive text with the odd error, or random bytes from a four-letter alphabet.
+ *
+ */
+static void test_fill(unsigned char *data, size_t size, int kind)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        switch (kind)
+        {
+        case 0:
+            data[i] = rand();
+            break;
+        case 1:
+            data[i] = (i / 7) & 0xff;
+            break;
+        case 2:
+            data[i] = "telemetry,"[i % 10] + (rand() % 50 == 0);
+            break;
+        default:
+            data[i] = rand() % 4;
+            break;
+        }
+    }
+}
+
+static void test_guard_set(unsigned char *buffer, size_t capacity)
+{
+    memset(buffer + capacity, 0xa5, TEST_GUARD);
+}
+
+static bool test_guard_intact(const unsigned char *buffer, size_t capacity)
+{
+    for (size_t i = 0; i < TEST_GUARD; i++)
+    {
+        if (buffer[capacity + i] != 0xa5)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes a block from the reference encoder and compares it with what was compressed.
+ *
+ */
+static void test_reference(const char *name, const unsigned char *block, size_t block_size, const unsigned char *expected, size_t expected_size, unsigned char *output)
+{
+    test_guard_set(output, expected_size);
+    ssize_t size = gss_lz4_decompress(block, block_size, output, expected_size);
+    test_expect(size == (ssize_t)expected_size && memcmp(output, expected, expected_size) == 0, "%s: reference block decoded to %ld bytes, expected %lu.", name, (long)size, (unsigned long)expected_size);
+    test_expect(test_guard_intact(output, expected_size), "%s: wrote past the output buffer.", name);
+
+    // One byte too little room must be refused, not overrun.
+    test_guard_set(output, expected_size - 1);
+    test_expect(gss_lz4_decompress(block, block_size, output, expected_size - 1) < 0, "%s: decoded into too small a buffer.", name);
+    test_expect(test_guard_intact(output, expected_size - 1), "%s: wrote past too small an output buffer.", name);
+}
+
+int main()
+{
+    unsigned char *input = new unsigned char[TEST_MAX_SIZE];
+    unsigned char *block = new unsigned char[TEST_CAPACITY + TEST_GUARD];
+    unsigned char *output = new unsigned char[TEST_MAX_SIZE + TEST_GUARD];
+    srand(1);
+
+    // Blocks from the reference encoder.
+    for (int i = 0; i < 200; i++)
+    {
+        input[i] = "telemetry,"[i % 10];
+    }
+    test_reference("telemetry", test_telemetry_block, sizeof(test_telemetry_block), input, 200, output);
+
+    for (int i = 0; i < 40; i++)
+    {
+        input[i] = (unsigned char)(i * 37 + 11);
+    }
+    memset(input + 40, 0, 400);
+    test_reference("zeros", test_zeros_block, sizeof(test_zeros_block), input, 440, output);
+
+    // Round trips of every kind of payload, at every size up to the largest frame's.
+    for (int trial = 0; trial < TEST_ROUND_TRIPS; trial++)
+    {
+        size_t size = trial < 64 ? trial : rand() % (TEST_MAX_SIZE + 1);
+        int kind = trial % 4;
+        test_fill(input, size, kind);
+
+        test_guard_set(block, TEST_CAPACITY);
+        ssize_t block_size = gss_lz4_compress(input, size, block, TEST_CAPACITY);
+        test_expect(block_size >= 0, "round trip %d: %lu bytes of kind %d did not compress.", trial, (unsigned long)size, kind);
+        test_expect(test_guard_intact(block, TEST_CAPACITY), "round trip %d: compression wrote past its buffer.", trial);
+        if (block_size < 0)
+        {
+            continue;
+        }
+
+        test_guard_set(output, size);
+        ssize_t output_size = gss_lz4_decompress(block, block_size, output, size);
+        test_expect(output_size == (ssize_t)size && memcmp(output, input, size) == 0, "round trip %d: %lu bytes of kind %d came back as %ld.", trial, (unsigned long)size, kind, (long)output_size);
+        test_expect(test_guard_intact(output, size), "round trip %d: decompression wrote past its buffer.", trial);
+
+        // Too little room to compress into must be refused, not overrun.
+        if (block_size > 0)
+        {
+            test_guard_set(block, block_size - 1);
+            test_expect(gss_lz4_compress(input, size, block, block_size - 1) < 0, "round trip %d: compressed into too small a buffer.", trial);
+            test_expect(test_guard_intact(block, block_size - 1), "round trip %d: compression wrote past too small a buffer.", trial);
+        }
+    }
+
+    // Corrupted, truncated, and random blocks: any result is fine as long as it fits and nothing is written outside of the output buffer.
+    for (int trial = 0; trial < TEST_CORRUPTIONS; trial++)
+    {
+        size_t size = 1 + rand() % 4096;
+        test_fill(input, size, trial % 4);
+        ssize_t block_size = gss_lz4_compress(input, size, block, TEST_CAPACITY);
+        if (block_size <= 0)
+        {
+            continue;
+        }
+
+        switch (trial % 3)
+        {
+        case 0:
+            for (int flips = 1 + rand() % 4; flips > 0; flips--)
+            {
+                block[rand() % block_size] ^= 1 << (rand() % 8);
+            }
+            break;
+        case 1:
+            block_size = rand() % block_size;
+            break;
+        default:
+            for (ssize_t i = 0; i < block_size; i++)
+            {
+                block[i] = rand();
+            }
+            break;
+        }
+
+        size_t capacity = trial % 2 ? size : rand() % (size + 1);
+        test_guard_set(output, capacity);
+        ssize_t output_size = gss_lz4_decompress(block, block_size, output, capacity);
+        test_expect(output_size <= (ssize_t)capacity, "corruption %d: decoded %ld bytes into %lu.", trial, (long)output_size, (unsigned long)capacity);
+        test_expect(test_guard_intact(output, capacity), "corruption %d: wrote past the output buffer.", trial);
+    }
+
+    delete[] input;
+    delete[] block;
+    delete[] output;
+
+    if (test_failures > 0)
+    {
+        fprintf(stderr, "%d LZ4 checks failed.\n", test_failures);
+        return 1;
+    }
+
+    printf("LZ4 round trip and corruption checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,524 @@
+/**
+ * @file gss_replay.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Replays a pass captured with the server's -R into a running server, and measures forwarding latency.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Usage: gss_replay.out [-H host] [-C topology_file] [-x speed | -f] capture_file...
+ *
+ * Plays every vertex of the capture (see gss_capture.hpp): each recorded connection and disconnection is repeated on the same vertex's port, and each recorded frame is sent, byte for byte, on the connection it arrived on. Files are read through memory maps, in name order, which is the order the server wrote them in.
+ *
+ * Records are replayed at the pace they were captured, -x times faster (e.g. -x 10), or with -f as fast as possible. The same capture replayed against two builds therefore exercises both with the same frames, in the same order, on the same connections, which makes its latency figures comparable between them.
+ *
+ * Every frame that arrives at one of the replayed vertices is matched to the oldest unanswered frame sent with the same origin, destination, type, CRC and size, and its forwarding latency recorded per route. Frames the server sends itself (poll responses, netstat pushes) are not matched. Frames whose destination was offline during the pass are lost in the replay too, so compare losses between builds rather than expecting none. Use the topology file the capture was made with (-C), since the vertices' ports come from it, and run on the same host as the server.
+ *
+ * Exits with 1 if a capture cannot be read or the server cannot be reached.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <atomic>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "gss_frame.hpp"
+#include "gss_pool.hpp"
+#include "gss_topology.hpp"
+#include "gss_capture.hpp"
+
+#define REPLAY_MAX_CONNECTIONS 8 // Per vertex; only the GUI client has more than one.
+#define REPLAY_READY_TIMEOUT_NS 1000000000ULL // How long to wait for the server to answer a new connection's first poll.
+#define REPLAY_DRAIN_TIMEOUT_S 2 // How long to wait for stragglers once every record has been replayed.
+
+/**
+ * @brief Forwarding counters of one origin-destination pair.
+ *
+ */
+typedef struct
+{
+    uint64_t sent;
+    uint64_t bytes;
+    std::vector<uint64_t> latency_ns; // One entry per frame received.
+} replay_route_t;
+
+typedef struct replay replay_t;
+
+/**
+ * @brief One of a vertex's connections to the server, as the capture saw it.
+ *
+ */
+typedef struct
+{
+    replay_t *replay;
+    int vertex;
+    int socket; // -1 while disconnected.
+    pthread_t receiver;
+    std::atomic<bool> active;
+    std::atomic<bool> ready; // The server has answered since the connection was made.
+} replay_connection_t;
+
+struct replay
+{
+    const char *host;
+    gss_topology_t topology;
+    replay_connection_t connections[GSS_MAX_VERTICES][REPLAY_MAX_CONNECTIONS];
+
+    pthread_mutex_t lock; // Guards everything below.
+    std::unordered_map<uint64_t, std::deque<uint64_t>> in_flight; // Send times of unanswered frames, by replay_key(...).
+    std::map<uint16_t, replay_route_t> routes; // By origin ID << 8 | destination ID.
+    uint64_t outstanding;
+    uint64_t unmatched;
+    uint64_t from_server;
+    uint64_t last_rx_ns;
+};
+
+static uint64_t replay_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief What a forwarded frame is matched on: everything in its header the server does not change.
+ *
+ */
+static inline uint64_t replay_key(const gss_frame_header_t *header)
+{
+    return (uint64_t)header->origin << 56 | (uint64_t)header->destination << 48 | (uint64_t)(header->type & 0xffff) << 32 | (uint64_t)header->crc1 << 16 | (uint64_t)(header->payload_size & 0xffff);
+}
+
+static const char *replay_vertex_name(const gss_topology_t *topology, int id)
+{
+    int index = gss_topology_route(topology, id);
+    return index >= 0 ? topology->vertices[index].name : index == GSS_ROUTE_SERVER ? "server" : "unknown";
+}
+
+/**
+ * @brief Receives everything the server sends one connection, and matches each forwarded frame to when it was sent.
+ *
+ * @return void* NULL
+ */
+static void *replay_receiver_thread(void *connection_vp)
+{
+    replay_connection_t *connection = (replay_connection_t *)connection_vp;
+    replay_t *replay = connection->replay;
+    gss_pool_t *pool = gss_pool_create();
+
+    while (connection->active)
+    {
+        gss_frame_header_t header;
+        unsigned char *frame = NULL;
+        ssize_t read_size = gss_frame_recv_header(connection->socket, &header, NULL, NULL);
+        if (read_size >= 0)
+        {
+            read_size = gss_frame_recv_body(connection->socket, &header, pool, &frame, NULL);
+        }
+
+        if (read_size == -404)
+        {
+            break;
+        }
+        else if (read_size < 0)
+        {
+            // Timed out, or the connection is being closed.
+            continue;
+        }
+
+        uint64_t now = replay_now_ns();
+        gss_pool_put(pool, frame);
+
+        if (header.origin == replay->topology.server_id)
+        {
+            pthread_mutex_lock(&replay->lock);
+            replay->from_server++;
+            replay->last_rx_ns = now;
+            pthread_mutex_unlock(&replay->lock);
+            connection->ready = true;
+            continue;
+        }
+
+        pthread_mutex_lock(&replay->lock);
+        replay->last_rx_ns = now;
+        auto sent = replay->in_flight.find(replay_key(&header));
+        if (sent != replay->in_flight.end() && !sent->second.empty())
+        {
+            replay->routes[header.origin << 8 | header.destination].latency_ns.push_back(now - sent->second.front());
+            sent->second.pop_front();
+            replay->outstanding--;
+        }
+        else
+        {
+            // A second GUI client's copy of a broadcast, or a frame sent before the replay started.
+            replay->unmatched++;
+        }
+        pthread_mutex_unlock(&replay->lock);
+    }
+
+    gss_pool_destroy(pool);
+
+    return NULL;
+}
+
+static void replay_disconnect(replay_connection_t *connection)
+{
+    if (connection->socket < 0)
+    {
+        return;
+    }
+
+    connection->active = false;
+    shutdown(connection->socket, SHUT_RDWR);
+    pthread_join(connection->receiver, NULL);
+    close(connection->socket);
+    connection->socket = -1;
+}
+
+/**
+ * @brief Connects to a vertex's port and waits for the server to answer a poll on it, so that frames sent next are not raced by the server's accept.
+ *
+ * @return int 1 on success, -1 if the server could not be reached.
+ */
+static int replay_connect(replay_t *replay, replay_connection_t *connection)
+{
+    replay_disconnect(connection);
+
+    const gss_vertex_config_t *vertex = &replay->topology.vertices[connection->vertex];
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0x0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(vertex->port);
+    if (sock < 0 || inet_pton(AF_INET, replay->host, &address.sin_addr) != 1 || connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        fprintf(stderr, "Could not connect to %s:%d for %s: %s\n", replay->host, vertex->port, vertex->name, strerror(errno));
+        if (sock >= 0)
+        {
+            close(sock);
+        }
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 200000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    connection->socket = sock;
+    connection->active = true;
+    connection->ready = false;
+    pthread_create(&connection->receiver, NULL, replay_receiver_thread, connection);
+
+    unsigned char poll_frame[GSS_FRAME_OVERHEAD];
+    ssize_t poll_size = gss_frame_build(poll_frame, NetType::POLL, (NetVertex)vertex->id, (NetVertex)replay->topology.server_id, 0, NULL, 0);
+    gss_frame_send(sock, poll_frame, poll_size);
+
+    uint64_t deadline = replay_now_ns() + REPLAY_READY_TIMEOUT_NS;
+    while (!connection->ready && replay_now_ns() < deadline)
+    {
+        usleep(100);
+    }
+    if (!connection->ready)
+    {
+        fprintf(stderr, "The server did not answer %s's connection; replaying anyway.\n", vertex->name);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Memory-maps one capture file.
+ *
+ * @return unsigned char* The file, or NULL if it could not be mapped or is not a capture.
+ */
+static unsigned char *replay_map(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(gss_log_file_header_t))
+    {
+        fprintf(stderr, "%s: could not open, or too short to be a capture.\n", path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    *size = status.st_size;
+    unsigned char *file = (unsigned char *)mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: could not map: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    madvise(file, *size, MADV_SEQUENTIAL);
+
+    if (memcmp(((gss_log_file_header_t *)file)->magic, GSS_CAPTURE_MAGIC, sizeof(((gss_log_file_header_t *)file)->magic)) != 0)
+    {
+        fprintf(stderr, "%s: not a capture.\n", path);
+        munmap(file, *size);
+        return NULL;
+    }
+
+    return file;
+}
+
+static double replay_percentile_us(const std::vector<uint64_t> &sorted, double percentile)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    return sorted[(size_t)(percentile * (sorted.size() - 1) + 0.5)] / 1000.0;
+}
+
+static void replay_report(const char *name, std::vector<uint64_t> &latency_ns, uint64_t sent, uint64_t bytes, double elapsed)
+{
+    std::sort(latency_ns.begin(), latency_ns.end());
+    printf("  %-28s sent %8lu  received %8zu  lost %6ld  %8.1f MB/s  p50 %8.1f us  p99 %8.1f us  p999 %8.1f us\n",
+           name, sent, latency_ns.size(), (long)(sent - latency_ns.size()), bytes / elapsed / 1e6,
+           replay_percentile_us(latency_ns, 0.5), replay_percentile_us(latency_ns, 0.99), replay_percentile_us(latency_ns, 0.999));
+}
+
+int main(int argc, char *argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    replay_t *replay = new replay_t;
+    replay->host = "127.0.0.1";
+    gss_topology_default(&replay->topology);
+    pthread_mutex_init(&replay->lock, NULL);
+    replay->outstanding = 0;
+    replay->unmatched = 0;
+    replay->from_server = 0;
+    replay->last_rx_ns = 0;
+
+    double speed = 1.0;
+    bool fast = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:C:x:f")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H':
+            replay->host = optarg;
+            break;
+        case 'C':
+            if (gss_topology_load(optarg, &replay->topology) < 0)
+            {
+                return 1;
+            }
+            break;
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'f':
+            fast = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-H host] [-C topology_file] [-x speed | -f] capture_file...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || speed <= 0.0)
+    {
+        fprintf(stderr, "Usage: %s [-H host] [-C topology_file] [-x speed | -f] capture_file...\n", argv[0]);
+        return 1;
+    }
+
+    for (int v = 0; v < GSS_MAX_VERTICES; v++)
+    {
+        for (int c = 0; c < REPLAY_MAX_CONNECTIONS; c++)
+        {
+            replay->connections[v][c].replay = replay;
+            replay->connections[v][c].vertex = v;
+            replay->connections[v][c].socket = -1;
+            replay->connections[v][c].active = false;
+            replay->connections[v][c].ready = false;
+        }
+    }
+
+    // The server names its files so that name order is the order they were written in.
+    std::vector<std::string> paths(argv + optind, argv + argc);
+    std::sort(paths.begin(), paths.end());
+
+    uint64_t frames = 0, connects = 0, disconnects = 0, skipped = 0;
+    uint64_t first_ns = 0, last_ns = 0, start_ns = replay_now_ns(), max_lag_ns = 0;
+    bool started = false;
+
+    for (const std::string &path : paths)
+    {
+        size_t size;
+        unsigned char *file = replay_map(path.c_str(), &size);
+        if (file == NULL)
+        {
+            return 1;
+        }
+
+        size_t offset = sizeof(gss_log_file_header_t);
+        while (offset + sizeof(gss_capture_record_t) <= size)
+        {
+            const gss_capture_record_t *record = (const gss_capture_record_t *)(file + offset);
+            const unsigned char *frame = file + offset + sizeof(gss_capture_record_t);
+            if (offset + sizeof(gss_capture_record_t) + record->size > size)
+            {
+                fprintf(stderr, "%s: truncated record at offset %zu.\n", path.c_str(), offset);
+                break;
+            }
+            offset += sizeof(gss_capture_record_t) + record->size;
+
+            int vertex = gss_topology_route(&replay->topology, record->vertex_id);
+            if (vertex < 0 || record->connection >= REPLAY_MAX_CONNECTIONS || (record->event == GSS_CAPTURE_FRAME && record->size < GSS_FRAME_OVERHEAD))
+            {
+                skipped++;
+                continue;
+            }
+            replay_connection_t *connection = &replay->connections[vertex][record->connection];
+
+            // Keep to the capture's pace, scaled.
+            if (!started)
+            {
+                first_ns = record->timestamp_ns;
+                start_ns = replay_now_ns();
+                started = true;
+            }
+            last_ns = record->timestamp_ns;
+            if (!fast && record->timestamp_ns > first_ns)
+            {
+                uint64_t due_ns = start_ns + (uint64_t)((record->timestamp_ns - first_ns) / speed);
+                uint64_t now = replay_now_ns();
+                if (now < due_ns)
+                {
+                    struct timespec due;
+                    due.tv_sec = due_ns / 1000000000ULL;
+                    due.tv_nsec = due_ns % 1000000000ULL;
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+                }
+                else if (now - due_ns > max_lag_ns)
+                {
+                    max_lag_ns = now - due_ns;
+                }
+            }
+
+            if (record->event == GSS_CAPTURE_CONNECT)
+            {
+                connects++;
+                if (replay_connect(replay, connection) < 0)
+                {
+                    return 1;
+                }
+                continue;
+            }
+            if (record->event == GSS_CAPTURE_DISCONNECT)
+            {
+                disconnects++;
+                replay_disconnect(connection);
+                continue;
+            }
+
+            // The capture began while this connection was already up (e.g. after a rotation).
+            if (connection->socket < 0 && replay_connect(replay, connection) < 0)
+            {
+                return 1;
+            }
+
+            const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+            if (header->destination != replay->topology.server_id)
+            {
+                pthread_mutex_lock(&replay->lock);
+                replay_route_t *route = &replay->routes[header->origin << 8 | header->destination];
+                route->sent++;
+                route->bytes += record->size;
+                replay->in_flight[replay_key(header)].push_back(replay_now_ns());
+                replay->outstanding++;
+                pthread_mutex_unlock(&replay->lock);
+            }
+
+            frames++;
+            if (gss_frame_send(connection->socket, frame, record->size) < 0)
+            {
+                fprintf(stderr, "Send on %s's connection failed: %s\n", replay->topology.vertices[vertex].name, strerror(errno));
+            }
+        }
+
+        munmap(file, size);
+    }
+
+    uint64_t sent_ns = replay_now_ns();
+
+    // Wait for stragglers.
+    while (true)
+    {
+        pthread_mutex_lock(&replay->lock);
+        bool done = replay->outstanding == 0 || replay_now_ns() - std::max(replay->last_rx_ns, sent_ns) > REPLAY_DRAIN_TIMEOUT_S * 1000000000ULL;
+        pthread_mutex_unlock(&replay->lock);
+        if (done)
+        {
+            break;
+        }
+        usleep(10000);
+    }
+
+    for (int v = 0; v < GSS_MAX_VERTICES; v++)
+    {
+        for (int c = 0; c < REPLAY_MAX_CONNECTIONS; c++)
+        {
+            replay_disconnect(&replay->connections[v][c]);
+        }
+    }
+
+    double elapsed = (sent_ns - start_ns) * 1e-9;
+    printf("Replayed %lu frames, %lu connections and %lu disconnections (%lu records skipped) from %zu files in %.3f s (captured over %.3f s), %s.\n",
+           frames, connects, disconnects, skipped, paths.size(), elapsed, (last_ns - first_ns) * 1e-9,
+           fast ? "as fast as possible" : "paced");
+    if (!fast)
+    {
+        printf("Fell behind the capture's pace by at most %.3f ms.\n", max_lag_ns * 1e-6);
+    }
+    printf("%lu frames from the server, %lu forwarded frames not matched to one sent.\n", replay->from_server, replay->unmatched);
+
+    if (elapsed <= 0.0)
+    {
+        elapsed = 1e-9;
+    }
+    std::vector<uint64_t> all_latency_ns;
+    uint64_t total_sent = 0, total_bytes = 0;
+    for (auto &entry : replay->routes)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s -> %s", replay_vertex_name(&replay->topology, entry.first >> 8), replay_vertex_name(&replay->topology, entry.first & 0xff));
+        all_latency_ns.insert(all_latency_ns.end(), entry.second.latency_ns.begin(), entry.second.latency_ns.end());
+        total_sent += entry.second.sent;
+        total_bytes += entry.second.bytes;
+        replay_report(name, entry.second.latency_ns, entry.second.sent, entry.second.bytes, elapsed);
+    }
+    replay_report("total", all_latency_ns, total_sent, total_bytes, elapsed);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file gss_spool_test.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Checks that a spool hands frames back oldest first as they move from its ring to its overflow segment, wrap around the segment, and are evicted.
+ * @version 0.1
+ * @date 2026.10.17
+ *
+ * Exits with 1 on the first frame out of order or counter that disagrees.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "gss_spool.hpp"
+#include "gss_pool.hpp"
+
+#define TEST_CAPACITY 4
+#define TEST_FRAME_SIZE 60000 // Sixteen of these fill a 1 MB segment.
+#define TEST_SEGMENT_FRAMES 16
+
+static int test_failures = 0;
+
+static void test_expect(bool condition, const char *format, ...)
+{
+    if (condition)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "FAIL: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    test_failures++;
+}
+
+static void test_push(gss_spool_t *spool, gss_pool_t *pool, uint32_t sequence)
+{
+    unsigned char *frame = gss_pool_get(pool, TEST_FRAME_SIZE);
+    memset(frame, (int)(sequence & 0xff), TEST_FRAME_SIZE);
+    memcpy(frame, &sequence, sizeof(sequence));
+    gss_spool_push(spool, frame, TEST_FRAME_SIZE);
+}
+
+/**
+ * @brief Pops every frame and checks they come out as first through last, intact.
+ *
+ */
+static void test_pop_all(gss_spool_t *spool, gss_pool_t *pool, uint32_t first, uint32_t last, const char *name)
+{
+    for (uint32_t expected = first; expected <= last; expected++)
+    {
+        size_t frame_size = 0;
+        unsigned char *frame = gss_spool_pop(spool, &frame_size);
+        test_expect(frame != NULL, "%s: spool empty, expected frame %u.", name, expected);
+        if (frame == NULL)
+        {
+            return;
+        }
+
+        uint32_t sequence;
+        memcpy(&sequence, frame, sizeof(sequence));
+        test_expect(sequence == expected, "%s: got frame %u, expected %u.", name, sequence, expected);
+        test_expect(frame_size == TEST_FRAME_SIZE && frame[TEST_FRAME_SIZE - 1] == (expected & 0xff), "%s: frame %u corrupted.", name, expected);
+        gss_pool_put(pool, frame);
+    }
+
+    size_t frame_size;
+    test_expect(gss_spool_pop(spool, &frame_size) == NULL, "%s: frames left over after %u.", name, last);
+}
+
+static void test_expect_stats(gss_spool_t *spool, size_t depth, size_t on_disk, uint64_t evicted, const char *name)
+{
+    gss_spool_stats_t stats;
+    gss_spool_get_stats(spool, &stats);
+    test_expect(stats.depth == depth && stats.on_disk == on_disk && stats.evicted == evicted, "%s: depth %lu, on disk %lu, evicted %lu; expected %lu, %lu, %lu.", name,
+                (unsigned long)stats.depth, (unsigned long)stats.on_disk, (unsigned long)stats.evicted, (unsigned long)depth, (unsigned long)on_disk, (unsigned long)evicted);
+}
+
+int main()
+{
+    gss_pool_t *pool = gss_pool_create();
+
+    char directory[] = "/tmp/gss_spool_test_XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    gss_spool_config_t config;
+    config.ttl_s = 3600;
+    config.capacity = TEST_CAPACITY;
+    config.directory = directory;
+    config.segment_mb = 1;
+
+    // Ring, then segment, then a full segment which wraps as the oldest frames are evicted.
+    gss_spool_t *spool = gss_spool_create(0, &config, pool);
+    uint32_t sequence = 0;
+    for (; sequence < TEST_CAPACITY; sequence++)
+    {
+        test_push(spool, pool, sequence);
+    }
+    test_expect_stats(spool, TEST_CAPACITY, 0, 0, "ring");
+
+    for (; sequence < TEST_CAPACITY + TEST_SEGMENT_FRAMES; sequence++)
+    {
+        test_push(spool, pool, sequence);
+    }
+    test_expect_stats(spool, TEST_CAPACITY + TEST_SEGMENT_FRAMES, TEST_SEGMENT_FRAMES, 0, "segment");
+
+    // Each push evicts exactly the oldest frame, never the whole ring.
+    for (int i = 0; i < 6; i++, sequence++)
+    {
+        test_push(spool, pool, sequence);
+        test_expect_stats(spool, TEST_CAPACITY + TEST_SEGMENT_FRAMES, TEST_SEGMENT_FRAMES, (uint64_t)i + 1, "eviction");
+    }
+    test_pop_all(spool, pool, 6, sequence - 1, "wrap");
+    test_expect_stats(spool, 0, 0, 6, "drained");
+
+    // Popping from the ring pulls the oldest frame off of disk, so the ring keeps the oldest frames and newer ones still follow them.
+    sequence = 100;
+    for (int i = 0; i < TEST_CAPACITY + 8; i++, sequence++)
+    {
+        test_push(spool, pool, sequence);
+    }
+    size_t frame_size;
+    for (uint32_t expected = 100; expected < 103; expected++)
+    {
+        unsigned char *frame = gss_spool_pop(spool, &frame_size);
+        uint32_t popped = UINT32_MAX;
+        if (frame != NULL)
+        {
+            memcpy(&popped, frame, sizeof(popped));
+        }
+        test_expect(popped == expected, "refill: got frame %u, expected %u.", popped, expected);
+        gss_pool_put(pool, frame);
+    }
+    test_expect_stats(spool, TEST_CAPACITY + 5, 5, 6, "refill");
+    for (int i = 0; i < 3; i++, sequence++)
+    {
+        test_push(spool, pool, sequence);
+    }
+    test_pop_all(spool, pool, 103, sequence - 1, "refill");
+    gss_spool_destroy(spool);
+
+    // Memory only: the ring alone evicts its oldest frame.
+    config.directory = NULL;
+    spool = gss_spool_create(1, &config, pool);
+    for (sequence = 0; sequence < TEST_CAPACITY + 2; sequence++)
+    {
+        test_push(spool, pool, sequence);
+    }
+    test_expect_stats(spool, TEST_CAPACITY, 0, 2, "memory");
+    test_pop_all(spool, pool, 2, sequence - 1, "memory");
+    gss_spool_destroy(spool);
+
+    rmdir(directory);
+    gss_pool_destroy(pool);
+
+    if (test_failures > 0)
+    {
+        fprintf(stderr, "%d spool checks failed.\n", test_failures);
+        return 1;
+    }
+
+    printf("Spool ordering checks passed.\n");
+    return 0;
+}
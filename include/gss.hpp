@@ -13,45 +13,306 @@
 #define GSS_HPP
 
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <atomic>
 #include "network.hpp"
+#include "gss_txq.hpp"
+#include "gss_pool.hpp"
+#include "gss_frame.hpp"
+#include "gss_splice.hpp"
+#include "gss_log.hpp"
+#include "gss_health.hpp"
+#include "gss_metrics.hpp"
+#include "gss_spool.hpp"
+#include "gss_dedup.hpp"
+#include "gss_capture.hpp"
+#include "gss_compress.hpp"
+#include "gss_latency.hpp"
+#include "gss_topology.hpp"
+#include "gss_recv.hpp"
 
 #define LISTENING_IP_ADDRESS "127.0.0.1" // hostname -I
-#define LISTENING_SOCKET_TIMEOUT 20
-#define NUM_PORTS 5 // How many ports to open
+#define GSS_NETSTAT_BIT(id) (0x80 >> (id)) // 0x80 (Client, ID 0) through 0x8 (Track, ID 4) in the default topology.
+#define GSS_MAX_CLIENTS 8 // Most GUI clients which may be connected at once.
+#define GSS_DEFAULT_CLIENTS 4
+#define GSS_MAX_CONNECTIONS (GSS_MAX_VERTICES + GSS_MAX_CLIENTS - 1) // One connection per vertex plus one per additional GUI client; at most 32.
+static_assert(GSS_MAX_CONNECTIONS <= GSS_COMPRESS_MAX_LINKS, "Every connection needs its compression counters.");
+#define GSS_LISTEN_BACKLOG 16
+#define GSS_ACCEPT_SLICE_MS 100 // RX threads waiting for a connection check for a shutdown this often.
+#define GSS_BIND_RETRY_MS 10 // First wait before binding a port still held by another process again; doubles on each try.
+#define GSS_BIND_RETRY_MAX_MS 1000
+#define GSS_BIND_TIMEOUT_S 30 // How long to keep trying before giving up.
+#define GSS_DRAIN_DEFAULT_S 5 // How long a shutdown may take, mostly spent waiting for the transmit queues to empty.
+#define GSS_SHUTDOWN_TICK_MS 100 // How often the signal thread checks a shutdown against its deadline.
 
 /**
- * @brief Enumeration representing what client each RX thread is listening for.
- * 
+ * @brief Which GUI clients may send frames to the radios. Every client always receives every downlink frame and may poll the server.
+ *
  */
-enum LISTEN_FOR
+enum GSS_UPLINK_POLICY
 {
-    LF_ERROR = -1,
-    LF_CLIENT = 0,
-    LF_ROOF_UHF,
-    LF_ROOF_XBAND,
-    LF_HAYSTACK,
-    LF_TRACK
+    GSS_UPLINK_ANY = 0, // Any connected client.
+    GSS_UPLINK_FIRST // Only the client which has been connected the longest; the others monitor until it leaves.
 };
 
 /**
  * @brief Data structure used to store arguments for rx_threads as a void pointer.
+ *
+ * Per-connection arrays are indexed by connection: 0 through num_vertices - 1 are the first connection of each vertex (so, for everything but the GUI client, the connection index is the vertex index), and num_vertices onwards are the additional GUI clients. gss_vertex(...) maps a connection back to its vertex.
  * 
  */
 typedef struct
 {
-    NetDataServer *network_data[NUM_PORTS];
-    pthread_t pid[NUM_PORTS];
+    gss_topology_t topology;
+    uint32_t vertex_connections[GSS_MAX_VERTICES]; // The connections belonging to each vertex, as bits of connected.
+    NetDataServer *network_data[GSS_MAX_CONNECTIONS];
+    pthread_t pid[GSS_MAX_CONNECTIONS];
+    pthread_mutex_t tx_lock[GSS_MAX_CONNECTIONS]; // Guards a connection's socket while it is replaced, claimed for a send, or closed; never held across a send (see gss_txq_claim_socket(...)).
+    gss_txq_t *txq[GSS_MAX_CONNECTIONS]; // Frames destined for each connection; only the connection's writer thread writes to its socket.
+    pthread_t tx_pid[GSS_MAX_CONNECTIONS];
+    int num_connections; // num_vertices - 1 + max_clients; the rest of each array is unused.
+    int max_clients;
+    GSS_UPLINK_POLICY uplink_policy;
+    int listening_socket[GSS_MAX_VERTICES]; // Bound before any worker starts (see gss_network_listen(...)); every GUI client connection accepts from the client's.
+    gss_pool_t *pool; // Every frame buffer in flight comes from, and returns to, this pool.
+    int splice_threshold; // RX threads splice frames with at least this many payload bytes straight to their destination; 0 disables.
+    GSS_RECV_ENGINE recv_engine; // How RX threads read frames off of their sockets; anything but GSS_RECV_FRAME requires splice_threshold to be 0.
+    gss_log_t *log; // Binary log of every routed frame; NULL disables.
+    pthread_t log_pid;
+    gss_log_t *capture; // Replayable capture of every received frame and connection change (see gss_capture.hpp); NULL disables.
+    pthread_t capture_pid;
+    std::atomic<uint8_t> netstat; // Each vertex's netstat_bit is set while it has a connection. Only changed by gss_set_connected(...).
+    std::atomic<uint32_t> connected; // Bit i is set while connection i is up.
+    uint64_t connected_ns[GSS_MAX_CONNECTIONS]; // When each connection came up, for GSS_UPLINK_FIRST. Guarded by netstat_lock.
+    pthread_mutex_t netstat_lock; // Serializes connection changes so pushed notifications arrive in order.
+    bool netstat_push; // Send the GUI clients a netstat frame whenever a connection changes.
+    gss_health_config_t health; // Keepalive, user timeout and heartbeat settings applied to every connection.
+    pthread_t health_pid;
+    std::atomic<uint64_t> last_rx_ns[GSS_MAX_CONNECTIONS]; // When each connection last sent anything (gss_health_now_ns()).
+    gss_metrics_t *metrics; // NULL disables.
+    gss_spool_t *spool[GSS_MAX_VERTICES]; // Frames for each vertex while it is offline; NULL disables.
+    gss_dedup_t *dedup[GSS_MAX_VERTICES]; // Frames each vertex recently sent, to drop its retransmissions; NULL disables.
+    gss_compress_t *compress; // Compression for the GUI clients which ask for it (see gss_compress.hpp); NULL disables.
+    gss_latency_t *latency; // Per-hop latency of sampled frames (see gss_latency.hpp); NULL disables.
+    pthread_t latency_pid;
+    pthread_t metrics_pid;
+    std::atomic<bool> stopping; // Set once by gss_shutdown(...).
+    int drain_s; // Longest a graceful shutdown may take, from gss_shutdown(...) until every connection is closed.
+    std::atomic<uint64_t> drain_deadline_ns; // When that is up (gss_health_now_ns()); set by gss_shutdown(...).
 } global_data_t;
 
+/**
+ * @brief Arguments of each RX thread.
+ *
+ */
+typedef struct
+{
+    global_data_t *global;
+    int t_index; // The connection this thread accepts and receives on.
+} gss_rx_args_t;
+
+/**
+ * @brief Maps a connection index to the vertex it belongs to.
+ *
+ * @param global
+ * @param t_index Connection index.
+ * @return int Vertex index.
+ */
+static inline int gss_vertex(global_data_t *global, int t_index)
+{
+    return t_index < global->topology.num_vertices ? t_index : global->topology.client;
+}
+
+/**
+ * @brief The vertex ID a connection's frames are addressed to and from.
+ *
+ * @param global
+ * @param t_index Connection index.
+ * @return NetVertex
+ */
+static inline NetVertex gss_vertex_id(global_data_t *global, int t_index)
+{
+    return (NetVertex)global->topology.vertices[gss_vertex(global, t_index)].id;
+}
+
+/**
+ * @brief Checks whether a connection is up.
+ *
+ * @param global
+ * @param t_index Connection index.
+ * @return true
+ * @return false
+ */
+static inline bool gss_is_connected(global_data_t *global, int t_index)
+{
+    return global->connected.load(std::memory_order_acquire) & (1u << t_index);
+}
+
+/**
+ * @brief Checks whether any of a vertex's connections is up.
+ *
+ * @param global
+ * @param vertex Vertex index.
+ * @return true
+ * @return false
+ */
+static inline bool gss_vertex_connected(global_data_t *global, int vertex)
+{
+    return global->connected.load(std::memory_order_acquire) & global->vertex_connections[vertex];
+}
+
+/**
+ * @brief Creates, binds, and begins listening on a vertex's port, or takes over the previous instance's socket after a hot restart. The socket is non-blocking.
+ *
+ * A port still bound by another process is tried again after GSS_BIND_RETRY_MS, then after twice that, and so on up to GSS_BIND_RETRY_MAX_MS apart, for up to GSS_BIND_TIMEOUT_S.
+ *
+ * @param global
+ * @param vertex
+ * @return int The listening socket, or -1 on failure.
+ */
+int gss_network_listen(global_data_t *global, int vertex);
+
 /**
  * @brief Thread which waits to receive network data.
  * 
- * Four of these are started, one for each expected possible client.
+ * One of these is started per connection, with a gss_rx_args_t saying which.
  * 
  * @return void* NULL
  */
 void *gss_network_rx_thread(void *);
 
+/**
+ * @brief Reads the netstat byte, the connection state of every vertex.
+ *
+ * @param global
+ * @return uint8_t Each connected vertex's netstat_bit; 0x80 (Client) through 0x8 (Track) in the default topology.
+ */
+static inline uint8_t gss_netstat(global_data_t *global)
+{
+    return global->netstat.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Records that a connection came up or went down, and notifies the GUI clients if global->netstat_push is set and the netstat changed.
+ *
+ * The notification is queued under netstat_lock, so the clients get netstats in the order they changed, but never waits for room in a client's queue; a client too far behind for it learns the netstat from its next poll instead. Must not be called while holding a tx_lock.
+ *
+ * @param global
+ * @param t_index Connection index.
+ * @param connected
+ */
+void gss_set_connected(global_data_t *global, int t_index, bool connected);
+
+/**
+ * @brief Queues one serialized frame for every connected GUI client. The frame is shared, not copied, and must not be modified afterwards.
+ *
+ * @param global
+ * @param frame A buffer from global->pool; ownership is taken either way.
+ * @param frame_size
+ * @param may_wait Whether a full queue may hold up the caller under GSS_TXQ_BACKPRESSURE (gss_txq_push(...)), rather than drop the frame (gss_txq_try_push(...)).
+ * @return int Number of clients it was queued for.
+ */
+int gss_broadcast_clients(global_data_t *global, unsigned char *frame, size_t frame_size, bool may_wait);
+
+/**
+ * @brief Parses an uplink policy name (any, first).
+ *
+ * @param name
+ * @param policy
+ * @return int 1 on success, -1 if the name is not recognized.
+ */
+int gss_parse_uplink_policy(const char *name, GSS_UPLINK_POLICY *policy);
+
+/**
+ * @brief Routes one complete serialized frame which arrived on the connection t_index.
+ *
+ * Responds to frames addressed to the server and queues all others for their destination with the netstat byte updated. Takes ownership of the frame, which must be a buffer from global->pool.
+ *
+ * @param global
+ * @param t_index Index of the connection the frame came from.
+ * @param frame
+ * @param frame_size
+ * @param t_tag Prefix for debug output.
+ */
+void gss_route_frame(global_data_t *global, int t_index, unsigned char *frame, size_t frame_size, const char *t_tag);
+
+/**
+ * @brief Decides from its header alone whether gss_route_frame(...) would only drop a frame: no vertex has its destination ID, its destination is offline without a spool, or its origin does not hold the uplink.
+ *
+ * Such a frame need not be copied into a pool buffer; receive or skip it however is cheapest and pass it to gss_route_dropped(...) instead. Always false while frames are logged or captured, since both record dropped frames' payloads.
+ *
+ * @param global
+ * @param t_index Index of the connection the frame came from.
+ * @param header
+ * @return true The frame is going to be dropped.
+ * @return false The frame must be received whole and passed to gss_route_frame(...).
+ */
+bool gss_route_drops(global_data_t *global, int t_index, const gss_frame_header_t *header);
+
+/**
+ * @brief Accounts for a frame dropped by its header, as gss_route_frame(...) would have if given the whole frame.
+ *
+ * @param global
+ * @param t_index Index of the connection the frame came from.
+ * @param header
+ * @param frame_size
+ * @param t_tag Prefix for debug output.
+ */
+void gss_route_dropped(global_data_t *global, int t_index, const gss_frame_header_t *header, size_t frame_size, const char *t_tag);
+
+/**
+ * @brief Records that invalid data was discarded from a connection's stream, which stays up.
+ *
+ * @param global
+ * @param t_index Index of the connection the data came from.
+ * @param skipped Bytes discarded.
+ * @param t_tag Prefix for debug output.
+ */
+void gss_report_corrupt(global_data_t *global, int t_index, size_t skipped, const char *t_tag);
+
+/**
+ * @brief Forwards a large frame by splicing its body from the origin's socket straight into the destination's socket.
+ *
+ * Only used when the destination is connected and its transmit queue is empty, so frames from one origin are never reordered, and when the whole body has already arrived. Claims the destination's socket for the duration (gss_txq_claim_socket(...)), which keeps its writer off of it, so only a send to the destination itself can hold it up.
+ *
+ * @param global
+ * @param t_index Index of the connection the frame came from.
+ * @param header The already-received header; its netstat is updated.
+ * @param splicer This RX thread's pipe.
+ * @param decoder Holds the frame if its footer is invalid (see gss_splice_forward(...)).
+ * @param t_tag Prefix for debug output.
+ * @return ssize_t Frame size if spliced, 0 if not eligible (the caller should receive the body and use gss_route_frame(...)), -404 if the origin closed the connection, or -1 on an origin error (errno is EBADMSG if the frame's footer is invalid, in which case it is in the decoder and receiving may continue from there).
+ */
+ssize_t gss_route_splice(global_data_t *global, int t_index, gss_frame_header_t *header, gss_splice_t *splicer, gss_frame_decoder_t *decoder, const char *t_tag);
+
+/**
+ * @brief Prints the frame pool and transmit queue counters.
+ *
+ * @param global
+ */
+void gss_print_stats(global_data_t *global);
+
+/**
+ * @brief Begins a graceful shutdown: stops accepting connections and receiving frames, but leaves every connection open so that what is already queued for it can still be sent (see gss_drain(...)), for up to global->drain_s from now. Safe to call from any thread, and more than once; never waits on a send.
+ *
+ * @param global
+ */
+void gss_shutdown(global_data_t *global);
+
+/**
+ * @brief Shuts down every connection once a graceful shutdown's deadline has passed, so that any thread still blocked sending or receiving on one returns and the shutdown can finish.
+ *
+ * @param global
+ */
+void gss_shutdown_expire(global_data_t *global);
+
+/**
+ * @brief Finishes a graceful shutdown once the RX threads or reactors have stopped: waits, until the deadline gss_shutdown(...) set, for every transmit queue to empty and its last frame to be sent, then closes every connection, cutting short any send still in progress.
+ *
+ * @param global
+ */
+void gss_drain(global_data_t *global);
+
 /**
  * @brief Generates a 16-bit CRC for the given data.
  * 
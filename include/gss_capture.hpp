@@ -0,0 +1,96 @@
+/**
+ * @file gss_capture.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Pass capture: a replayable recording of everything the server received.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Where the frame log (gss_log.hpp) records what the server routed, a capture records what it was given: every valid frame exactly as it arrived, and every connection and disconnection, each tagged with the connection and vertex it happened on and a CLOCK_MONOTONIC timestamp. bench/gss_replay feeds a capture back into a server, at the recorded pace or as fast as possible, so that a problem seen during a pass can be reproduced offline and a recorded pass can serve as a benchmark between builds.
+ *
+ * Captures are written by the frame log's writer into <directory>/gsscap_<start>_<sequence>.bin files. Each file is a gss_log_file_header_t with magic GSS_CAPTURE_MAGIC, followed by records, each a gss_capture_record_t followed by size bytes of frame. Like the log, a capture drops records rather than slow down forwarding if the disk falls behind, and says how many when it stops.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_CAPTURE_HPP
+#define GSS_CAPTURE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "gss_frame.hpp"
+#include "gss_pool.hpp"
+#include "gss_log.hpp"
+#include "gss_health.hpp"
+
+#define GSS_CAPTURE_MAGIC "GSSCAP01"
+#define GSS_CAPTURE_NAME "gsscap"
+
+enum GSS_CAPTURE_EVENT
+{
+    GSS_CAPTURE_FRAME = 0, // A frame received on the connection.
+    GSS_CAPTURE_CONNECT, // The connection was accepted.
+    GSS_CAPTURE_DISCONNECT // The connection was closed, by either side.
+};
+
+typedef struct __attribute__((packed))
+{
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC; only differences between records mean anything.
+    uint8_t event; // GSS_CAPTURE_EVENT
+    uint8_t vertex_id; // Of the connection's vertex, as written in frames.
+    uint16_t connection; // Which of the vertex's connections (0 unless it is the GUI client with several).
+    uint32_t size; // Bytes of frame following the record; 0 for connections and disconnections.
+} gss_capture_record_t;
+
+static_assert(sizeof(gss_capture_record_t) + GSS_FRAME_MAX_SIZE <= GSS_POOL_MAX_SIZE, "A record of a maximum size frame must fit in a pool buffer.");
+
+/**
+ * @brief Captures a frame received on a connection.
+ *
+ * @param capture NULL is ignored.
+ * @param vertex_id
+ * @param connection
+ * @param frame The whole frame, header through footer.
+ * @param frame_size
+ */
+static inline void gss_capture_frame(gss_log_t *capture, uint8_t vertex_id, int connection, const unsigned char *frame, size_t frame_size)
+{
+    if (capture == NULL)
+    {
+        return;
+    }
+
+    gss_capture_record_t record;
+    record.timestamp_ns = gss_health_now_ns();
+    record.event = GSS_CAPTURE_FRAME;
+    record.vertex_id = vertex_id;
+    record.connection = connection;
+    record.size = frame_size;
+    gss_log_record(capture, &record, sizeof(record), frame, frame_size);
+}
+
+/**
+ * @brief Captures a connection or disconnection.
+ *
+ * @param capture NULL is ignored.
+ * @param event GSS_CAPTURE_CONNECT or GSS_CAPTURE_DISCONNECT.
+ * @param vertex_id
+ * @param connection
+ */
+static inline void gss_capture_event(gss_log_t *capture, GSS_CAPTURE_EVENT event, uint8_t vertex_id, int connection)
+{
+    if (capture == NULL)
+    {
+        return;
+    }
+
+    gss_capture_record_t record;
+    record.timestamp_ns = gss_health_now_ns();
+    record.event = event;
+    record.vertex_id = vertex_id;
+    record.connection = connection;
+    record.size = 0;
+    gss_log_record(capture, &record, sizeof(record), NULL, 0);
+}
+
+#endif // GSS_CAPTURE_HPP
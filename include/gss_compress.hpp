@@ -0,0 +1,179 @@
+/**
+ * @file gss_compress.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Optional LZ4 compression of frames on the GUI client's connections.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * The link to the operator consoles is slower than the radios, so a GUI client may ask for the frames sent to it to be compressed. It does so by sending the server a NetType::CONFIG frame whose payload is "compress=lz4" (or "compress=none" to stop); the server answers with a NetType::CONFIG frame saying which it will do, "compress=lz4" or, if the server was started without -Z or the connection is not the GUI client's, "compress=none". The setting lasts until the connection closes.
+ *
+ * A compressed frame has GSS_FRAME_TYPE_COMPRESSED set in its type, and its payload is a gss_compress_header_t followed by the original payload as one LZ4 block (the format of LZ4_compress_default(...), decodable with LZ4_decompress_safe(...)). The CRCs cover the payload as sent; raw_crc is the original payload's, to check it once expanded. Any other frame on the connection is sent as is, so the client must accept both. A client which negotiated compression may send compressed frames too, which the server expands before routing.
+ *
+ * Each frame for the clients is compressed at most once, and the copy shared by every client that asked for it. Payloads shorter than -Z bytes are never compressed. Neither is a frame which would not shrink by at least 1/GSS_COMPRESS_MIN_SAVING: each origin's frames are tried, and after one does not compress the next GSS_COMPRESS_BACKOFF_MIN frames from that origin are sent as is without trying, doubling up to GSS_COMPRESS_BACKOFF_MAX while they keep failing. Already compressed data (images, say) therefore costs a trial now and then rather than every frame.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_COMPRESS_HPP
+#define GSS_COMPRESS_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <atomic>
+#include "gss_pool.hpp"
+
+#define GSS_COMPRESS_MAX_LINKS 32 // Connections are bits of a uint32_t.
+#define GSS_COMPRESS_MIN_SAVING 8 // A frame is sent compressed only if that saves at least 1/8 of its payload.
+#define GSS_COMPRESS_BACKOFF_MIN 16 // Frames from an origin sent without trying after one fails to compress.
+#define GSS_COMPRESS_BACKOFF_MAX 1024
+#define GSS_COMPRESS_REQUEST "compress="
+
+typedef struct __attribute__((packed))
+{
+    uint32_t raw_size; // Of the original payload.
+    uint16_t raw_crc; // The original crc1.
+} gss_compress_header_t;
+
+/**
+ * @brief A snapshot of one connection's counters.
+ *
+ */
+typedef struct
+{
+    bool enabled;
+    uint64_t compressed; // Frames sent compressed.
+    uint64_t bypassed; // Frames sent as is since compression was negotiated.
+    uint64_t raw_bytes; // Size those frames would have had uncompressed.
+    uint64_t wire_bytes; // Size they were sent at.
+    uint64_t compress_ns; // Time spent compressing frames sent on this connection, trials which failed included; shared frames are counted in full on every connection.
+    uint64_t expanded; // Compressed frames received.
+    uint64_t expand_ns;
+} gss_compress_stats_t;
+
+typedef struct
+{
+    std::atomic<uint64_t> compressed;
+    std::atomic<uint64_t> bypassed;
+    std::atomic<uint64_t> raw_bytes;
+    std::atomic<uint64_t> wire_bytes;
+    std::atomic<uint64_t> compress_ns;
+    std::atomic<uint64_t> expanded;
+    std::atomic<uint64_t> expand_ns;
+} gss_compress_link_t;
+
+typedef struct
+{
+    int min_size; // Payloads smaller than this are never compressed.
+    std::atomic<uint32_t> links; // Bit i is set while connection i has negotiated compression.
+    gss_compress_link_t link_stats[GSS_COMPRESS_MAX_LINKS];
+
+    // Per origin ID; racy updates only cost an extra or a skipped trial.
+    std::atomic<uint16_t> skip[256]; // Frames left to send without trying.
+    std::atomic<uint16_t> backoff[256]; // The last skip set; doubled by the next failed trial, cleared by a successful one.
+} gss_compress_t;
+
+/**
+ * @brief Compresses one block in the LZ4 block format.
+ *
+ * @param src
+ * @param src_size
+ * @param dst
+ * @param dst_capacity
+ * @return ssize_t Compressed size, or -1 if it would not fit in dst_capacity.
+ */
+ssize_t gss_lz4_compress(const unsigned char *src, size_t src_size, unsigned char *dst, size_t dst_capacity);
+
+/**
+ * @brief Expands one LZ4 block, checking every length and offset against both buffers.
+ *
+ * @param src
+ * @param src_size
+ * @param dst
+ * @param dst_capacity
+ * @return ssize_t Expanded size, or -1 if the block is malformed or does not fit.
+ */
+ssize_t gss_lz4_decompress(const unsigned char *src, size_t src_size, unsigned char *dst, size_t dst_capacity);
+
+/**
+ * @brief Enables compression negotiation.
+ *
+ * @param min_size Payloads shorter than this are never compressed.
+ * @return gss_compress_t*
+ */
+gss_compress_t *gss_compress_create(int min_size);
+
+/**
+ * @brief Frees the state.
+ *
+ * @param compress
+ */
+void gss_compress_destroy(gss_compress_t *compress);
+
+/**
+ * @brief Applies a connection's request.
+ *
+ * @param compress NULL answers every request with "none".
+ * @param link The connection.
+ * @param allowed Whether the connection may use compression at all.
+ * @param request The CONFIG frame's payload.
+ * @param request_size
+ * @return const char* The answer to send back, "compress=lz4" or "compress=none", or NULL if the payload is not a compression request.
+ */
+const char *gss_compress_negotiate(gss_compress_t *compress, int link, bool allowed, const unsigned char *request, int request_size);
+
+/**
+ * @brief Turns compression off for a connection which closed.
+ *
+ * @param compress NULL is ignored.
+ * @param link
+ */
+void gss_compress_reset(gss_compress_t *compress, int link);
+
+/**
+ * @brief Which connections currently want compressed frames.
+ *
+ * @param compress NULL is ignored.
+ * @return uint32_t Bit i for connection i.
+ */
+static inline uint32_t gss_compress_links(gss_compress_t *compress)
+{
+    return compress == NULL ? 0 : compress->links.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Compresses a frame for some connections, unless it is too small or its origin's payloads are not compressing, and counts the outcome against each of them.
+ *
+ * @param compress
+ * @param pool
+ * @param frame A complete frame, which is not changed.
+ * @param frame_size
+ * @param links The connections the frame is going to which negotiated compression.
+ * @param compressed_size Set to the compressed frame's size.
+ * @return unsigned char* A new pool buffer holding the compressed frame, carrying the original's stamp, or NULL to send the original.
+ */
+unsigned char *gss_compress_frame(gss_compress_t *compress, gss_pool_t *pool, const unsigned char *frame, size_t frame_size, uint32_t links, size_t *compressed_size);
+
+/**
+ * @brief Expands a compressed frame received on a connection which negotiated compression.
+ *
+ * @param compress NULL refuses every frame.
+ * @param pool
+ * @param link The connection it arrived on.
+ * @param frame A complete, validated frame with GSS_FRAME_TYPE_COMPRESSED set.
+ * @param frame_size Set to the expanded frame's size.
+ * @return unsigned char* A new pool buffer holding the original frame, or NULL if the connection did not negotiate compression or the payload does not expand to one matching raw_crc.
+ */
+unsigned char *gss_compress_expand(gss_compress_t *compress, gss_pool_t *pool, int link, const unsigned char *frame, size_t *frame_size);
+
+/**
+ * @brief Takes a snapshot of a connection's counters.
+ *
+ * @param compress
+ * @param link
+ * @param stats
+ */
+void gss_compress_get_stats(gss_compress_t *compress, int link, gss_compress_stats_t *stats);
+
+#endif // GSS_COMPRESS_HPP
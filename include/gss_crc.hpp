@@ -0,0 +1,70 @@
+/**
+ * @file gss_crc.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Fast implementations of crc16(...) with runtime dispatch.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Every implementation here is bit-exact with crc16(...) in gss.hpp (the on-board uhf_modem function), including its final inversion and byte swap, for every length crc16(...) accepts (0 through 65535 bytes).
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_CRC_HPP
+#define GSS_CRC_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Signature shared by every crc16 implementation.
+ *
+ */
+typedef uint16_t (*gss_crc16_fn)(const unsigned char *data, size_t length);
+
+/**
+ * @brief Slice-by-8 table-driven crc16, processes eight bytes per step. Always available.
+ *
+ * @param data
+ * @param length
+ * @return uint16_t
+ */
+uint16_t gss_crc16_table(const unsigned char *data, size_t length);
+
+/**
+ * @brief Carry-less multiplication folding crc16 (PCLMULQDQ on x86-64, PMULL on AArch64).
+ *
+ * Must only be called if gss_crc16_clmul_supported() returned true.
+ *
+ * @param data
+ * @param length
+ * @return uint16_t
+ */
+uint16_t gss_crc16_clmul(const unsigned char *data, size_t length);
+
+/**
+ * @brief Checks whether this build and this CPU can run gss_crc16_clmul(...).
+ *
+ * @return true
+ * @return false
+ */
+bool gss_crc16_clmul_supported();
+
+/**
+ * @brief Computes crc16 with the fastest implementation available on this CPU, chosen on first use.
+ *
+ * @param data
+ * @param length
+ * @return uint16_t
+ */
+uint16_t gss_crc16(const unsigned char *data, size_t length);
+
+/**
+ * @brief Name of the implementation gss_crc16(...) dispatches to.
+ *
+ * @return const char* "clmul", "pmull" or "slice-by-8".
+ */
+const char *gss_crc16_implementation();
+
+#endif // GSS_CRC_HPP
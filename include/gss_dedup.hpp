@@ -0,0 +1,93 @@
+/**
+ * @file gss_dedup.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Drops frames retransmitted within a time window, before they are forwarded.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Clients and radios retransmit a frame when its acknowledgement times out, so the same payload can cross the link to the GUI client, and land in the frame log, several times. Each origin vertex has a cache of the frames it recently sent: a fixed-size open-addressed table keyed by destination, type, crc1 and payload size. A frame whose key is already in the table, and was first seen less than the window ago, is a duplicate and is dropped instead of routed.
+ *
+ * crc1 is only 16 bits, so equal-size frames which differ (consecutive X-band chunks, say) share a key every 65536 frames or so. Each entry therefore also keeps a 64-bit hash of the whole payload, and a frame only counts as a duplicate if that matches too. Frames without a payload (polls, bare ACKs) carry nothing to compare and are never dropped.
+ *
+ * The window runs from a frame's first sighting, not its latest, so a frame legitimately repeated at an interval longer than the window is always forwarded. A full table overwrites its oldest entries, which at worst lets a duplicate through.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_DEDUP_HPP
+#define GSS_DEDUP_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+
+#define GSS_DEDUP_SLOTS 1024 // Entries per origin vertex; a power of two.
+#define GSS_DEDUP_PROBES 8 // Slots searched per lookup before the oldest of them is overwritten.
+
+/**
+ * @brief A snapshot of a cache's counters.
+ *
+ */
+typedef struct
+{
+    uint64_t hits; // Duplicates dropped.
+    uint64_t misses; // Frames seen for the first time within the window, and forwarded.
+} gss_dedup_stats_t;
+
+typedef struct
+{
+    uint64_t hash; // Of the payload.
+    uint64_t seen_ns; // 0 if the slot is unused.
+    uint32_t payload_size;
+    uint32_t type;
+    uint16_t crc1;
+    uint8_t destination;
+} gss_dedup_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock; // One origin's frames are usually routed by one thread, so this is rarely contended.
+    uint64_t window_ns;
+    gss_dedup_entry_t entries[GSS_DEDUP_SLOTS];
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+} gss_dedup_t;
+
+/**
+ * @brief Creates the cache for one origin vertex.
+ *
+ * @param window_ms How long after a frame is first seen an identical one is dropped.
+ * @return gss_dedup_t*
+ */
+gss_dedup_t *gss_dedup_create(int window_ms);
+
+/**
+ * @brief Frees the cache.
+ *
+ * @param dedup
+ */
+void gss_dedup_destroy(gss_dedup_t *dedup);
+
+/**
+ * @brief Checks whether a frame duplicates one seen within the window, and remembers it if not.
+ *
+ * @param dedup The frame's origin's cache.
+ * @param frame A complete, validated frame.
+ * @param now_ns gss_health_now_ns().
+ * @return true The frame is a duplicate and should be dropped.
+ * @return false The frame should be forwarded.
+ */
+bool gss_dedup_check(gss_dedup_t *dedup, const unsigned char *frame, uint64_t now_ns);
+
+/**
+ * @brief Takes a snapshot of the cache's counters.
+ *
+ * @param dedup
+ * @param stats
+ */
+void gss_dedup_get_stats(gss_dedup_t *dedup, gss_dedup_stats_t *stats);
+
+#endif // GSS_DEDUP_HPP
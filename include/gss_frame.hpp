@@ -0,0 +1,233 @@
+/**
+ * @file gss_frame.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Server-side view of the serialized NetFrame and an incremental decoder for it.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * The event-loop mode cannot use NetFrame::recvFrame(...), since it blocks until a whole frame has arrived. Instead, bytes are read off of the socket whenever they are available and frames are cut out of the accumulated stream here.
+ *
+ * A frame is only accepted once its GUID, payload size, termination, and both CRCs check out. Anything else is treated as corruption rather than as a reason to drop the connection: the receiver skips ahead to the next byte pair that could be a GUID (gss_frame_resync(...)) and carries on from there, so one garbled frame costs that frame, not a reconnect. A header whose GUID matched by chance can claim a payload which swallows the frames after it, so a rejected frame's bytes are searched for frames like any other invalid data, including when frames are received one at a time (gss_frame_decoder_recv(...)).
+ *
+ * The exception is a frame spliced straight from one socket to another (see gss_splice_forward(...)): its payload never enters user space, so its CRC1 is never checked against the payload, only its termination and CRC2 against CRC1.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_FRAME_HPP
+#define GSS_FRAME_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "network.hpp"
+#include "gss_pool.hpp"
+
+#define GSS_FRAME_GUID 0x1a1c
+#define GSS_FRAME_TERMINATION 0xaaaa
+#define GSS_FRAME_MAX_PAYLOAD_SIZE 0xffff // crc16(...) on the other end takes a 16-bit length, so anything larger is treated as a corrupted header.
+#define GSS_FRAME_TYPE_COMPRESSED 0x80000000u // Set in a frame's type when its payload is LZ4 compressed (see gss_compress.hpp).
+
+/**
+ * @brief The header of a serialized NetFrame, as written to the wire by NetFrame::sendFrame(...).
+ *
+ * The payload immediately follows the header, and the footer immediately follows the payload.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t guid;
+    uint16_t crc1;
+    uint32_t type;
+    uint8_t origin;
+    uint8_t destination;
+    int32_t payload_size;
+    uint8_t netstat;
+} gss_frame_header_t;
+
+/**
+ * @brief The footer of a serialized NetFrame.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t crc2;
+    uint16_t termination;
+} gss_frame_footer_t;
+
+#define GSS_FRAME_OVERHEAD (sizeof(gss_frame_header_t) + sizeof(gss_frame_footer_t))
+#define GSS_FRAME_MAX_SIZE (GSS_FRAME_OVERHEAD + GSS_FRAME_MAX_PAYLOAD_SIZE)
+
+/**
+ * @brief Accumulates bytes from one connection until they form complete frames.
+ *
+ */
+typedef struct
+{
+    unsigned char buffer[GSS_FRAME_MAX_SIZE];
+    size_t length;
+} gss_frame_decoder_t;
+
+/**
+ * @brief Resets a decoder, discarding any partially received frame.
+ *
+ * @param decoder
+ */
+void gss_frame_decoder_reset(gss_frame_decoder_t *decoder);
+
+/**
+ * @brief Like recv(...), but also collects the kernel's software receive timestamp, if the socket reports them (see gss_latency_configure_socket(...)).
+ *
+ * @param socket
+ * @param buffer
+ * @param size
+ * @param flags As for recv(...).
+ * @param kernel_ns Set to when the newest packet read arrived (CLOCK_REALTIME), or 0 if there is no timestamp; NULL makes this a plain recv(...).
+ * @return ssize_t As recv(...).
+ */
+ssize_t gss_frame_recv_stamped(int socket, unsigned char *buffer, size_t size, int flags, uint64_t *kernel_ns);
+
+/**
+ * @brief Reads whatever is available on the socket into the decoder without blocking.
+ *
+ * @param decoder
+ * @param socket
+ * @param kernel_ns As for gss_frame_recv_stamped(...); may be NULL.
+ * @return ssize_t Bytes read, 0 if nothing was available, -404 if the peer closed the connection, or -1 on error.
+ */
+ssize_t gss_frame_decoder_fill(gss_frame_decoder_t *decoder, int socket, uint64_t *kernel_ns);
+
+/**
+ * @brief Checks whether data begins with a complete, valid frame.
+ *
+ * @param data
+ * @param length Bytes available at data.
+ * @return ssize_t Size of the complete frame in bytes, 0 if more bytes are needed, or -1 if the data does not begin with a valid frame.
+ */
+ssize_t gss_frame_check(const unsigned char *data, size_t length);
+
+/**
+ * @brief Finds where the next frame might begin after data which gss_frame_check(...) rejected.
+ *
+ * @param data
+ * @param length
+ * @return size_t Bytes to discard: up to the next possible GUID after the first byte, or all of them if none could start one.
+ */
+size_t gss_frame_resync(const unsigned char *data, size_t length);
+
+/**
+ * @brief Checks whether a complete frame sits at the front of the decoder.
+ *
+ * @param decoder
+ * @return ssize_t Size of the complete frame in bytes, 0 if more bytes are needed, or -1 if the front of the decoder is not a valid frame (see gss_frame_decoder_resync(...)).
+ */
+ssize_t gss_frame_decoder_peek(gss_frame_decoder_t *decoder);
+
+/**
+ * @brief Removes the first size bytes from the decoder.
+ *
+ * @param decoder
+ * @param size
+ */
+void gss_frame_decoder_consume(gss_frame_decoder_t *decoder, size_t size);
+
+/**
+ * @brief Discards invalid data from the front of the decoder, up to where the next frame might begin.
+ *
+ * @param decoder
+ * @return size_t Bytes discarded.
+ */
+size_t gss_frame_decoder_resync(gss_frame_decoder_t *decoder);
+
+/**
+ * @brief Blocks until the decoder holds a complete frame at its front, reading nothing past its end, or until the decoder is empty.
+ *
+ * Receiving a frame at a time recovers from a rejected frame this way (see gss_frame_recv_body(...)): the bytes received for it are searched for the frames they hold, and once the decoder is empty the stream is in step again. Invalid data is discarded as by gss_frame_decoder_resync(...), and so is a partial frame whose remainder has not arrived by the receive timeout.
+ *
+ * @param decoder
+ * @param socket A blocking socket.
+ * @param skipped Set to the bytes discarded.
+ * @return ssize_t Size of the frame at the front of the decoder, which the caller then consumes (gss_frame_decoder_consume(...)), 0 once the decoder is empty, -404 if the peer closed the connection, or -1 on error.
+ */
+ssize_t gss_frame_decoder_recv(gss_frame_decoder_t *decoder, int socket, size_t *skipped);
+
+/**
+ * @brief Blocks until a valid frame header has been read from the socket, discarding anything before it which is not one.
+ *
+ * Together with gss_frame_recv_body(...), replaces NetFrame::recvFrame(...) in the RX threads; the frame is never deserialized, only validated.
+ *
+ * @param socket
+ * @param header
+ * @param skipped Set to the bytes discarded before the header; may be NULL.
+ * @param kernel_ns Set to when the packet the header began in arrived, as by gss_frame_recv_stamped(...); may be NULL.
+ * @return ssize_t Size of the header, -404 if the peer closed the connection, or -1 on error (errno is EAGAIN on a receive timeout).
+ */
+ssize_t gss_frame_recv_header(int socket, gss_frame_header_t *header, size_t *skipped, uint64_t *kernel_ns);
+
+/**
+ * @brief Blocks until the rest of the frame (payload and footer) has been read from the socket into a buffer from the pool.
+ *
+ * @param socket
+ * @param header As filled in by gss_frame_recv_header(...).
+ * @param pool
+ * @param frame Set to the pool buffer holding the whole frame on success, which the caller then owns.
+ * @param decoder On failure, holds what was received of the frame, header included, to resynchronize on (see gss_frame_decoder_recv(...)); may be NULL.
+ * @return ssize_t Size of the frame, -404 if the peer closed the connection, or -1 on error (errno is EBADMSG if the footer or a CRC is invalid, or EAGAIN if the rest of the frame did not arrive by the receive timeout; either way receiving may continue from the decoder).
+ */
+ssize_t gss_frame_recv_body(int socket, const gss_frame_header_t *header, gss_pool_t *pool, unsigned char **frame, gss_frame_decoder_t *decoder);
+
+/**
+ * @brief Reads and discards the rest of a frame (payload and footer), for a frame routed by its header alone (see gss_route_drops(...)).
+ *
+ * The frame is received into the decoder rather than a pool buffer, and checked like any other, so that if it is rejected the frames it may have swallowed can still be recovered.
+ *
+ * @param socket
+ * @param header As filled in by gss_frame_recv_header(...).
+ * @param decoder Must be empty. Empty again on success; on failure, as for gss_frame_recv_body(...).
+ * @return ssize_t As gss_frame_recv_body(...).
+ */
+ssize_t gss_frame_discard_body(int socket, const gss_frame_header_t *header, gss_frame_decoder_t *decoder);
+
+/**
+ * @brief Prints the header fields of a serialized frame, like NetFrame::print(...).
+ *
+ * @param frame
+ */
+void gss_frame_print(const unsigned char *frame);
+
+/**
+ * @brief Serializes a frame into the buffer, as NetFrame::sendFrame(...) would.
+ *
+ * @param buffer Must have room for GSS_FRAME_OVERHEAD + payload_size bytes.
+ * @param type
+ * @param origin
+ * @param destination
+ * @param netstat
+ * @param payload May be NULL if payload_size is 0.
+ * @param payload_size
+ * @return ssize_t Size of the serialized frame, or -1 if the payload is too large.
+ */
+ssize_t gss_frame_build(unsigned char *buffer, NetType type, NetVertex origin, NetVertex destination, uint8_t netstat, const unsigned char *payload, int payload_size);
+
+/**
+ * @brief Sends an already serialized frame, retrying on short writes.
+ *
+ * @param socket
+ * @param frame
+ * @param size
+ * @return ssize_t Bytes sent, or -1 on error.
+ */
+ssize_t gss_frame_send(int socket, const unsigned char *frame, size_t size);
+
+/**
+ * @brief Sends an already serialized frame like gss_frame_send(...), asking the kernel for a software transmit timestamp of each write, which it reports on the socket's error queue (see gss_latency_reap(...)).
+ *
+ * @param socket
+ * @param frame
+ * @param size
+ * @param stamps Set to the number of timestamps asked for, one per write.
+ * @return ssize_t Bytes sent, or -1 on error.
+ */
+ssize_t gss_frame_send_stamped(int socket, const unsigned char *frame, size_t size, int *stamps);
+
+#endif // GSS_FRAME_HPP
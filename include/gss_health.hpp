@@ -0,0 +1,82 @@
+/**
+ * @file gss_health.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Dead-peer detection: TCP keepalive, TCP_USER_TIMEOUT and application heartbeats.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Without these a peer which vanishes (power loss, cable pulled, NAT timeout) is only noticed once the topology's timeout_s passes, and until then frames routed to it are written into a dead socket.
+ *
+ * Keepalive and TCP_USER_TIMEOUT let the kernel fail the connection by itself: keepalive probes an idle connection, and TCP_USER_TIMEOUT bounds how long sent data may go unacknowledged. Heartbeats work above TCP: every interval the server sends each connected vertex a netstat (POLL) frame, and a vertex from which nothing at all (frames or polls) has arrived for heartbeat_misses intervals is disconnected. Peers using heartbeats should therefore poll the server at least once per interval.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_HEALTH_HPP
+#define GSS_HEALTH_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+#define GSS_HEALTH_DEFAULT_MISSES 3 // Silent heartbeat intervals before a vertex is declared dead.
+
+typedef struct
+{
+    int keepalive_idle_s; // Idle time before the first probe; 0 leaves keepalive off.
+    int keepalive_interval_s; // Time between probes.
+    int keepalive_count; // Unanswered probes before the kernel drops the connection.
+    int user_timeout_ms; // How long sent data may go unacknowledged; 0 leaves the kernel default.
+    int heartbeat_ms; // 0 disables heartbeats.
+    int heartbeat_misses;
+    std::atomic<bool> active; // Cleared to stop gss_health_thread(...).
+} gss_health_config_t;
+
+/**
+ * @brief Monotonic time, used for every liveness timestamp.
+ *
+ * @return uint64_t Nanoseconds.
+ */
+static inline uint64_t gss_health_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Parses "idle,interval,count" (seconds, seconds, probes) into the keepalive settings.
+ *
+ * @param arg
+ * @param config
+ * @return int 1 on success, -1 if malformed.
+ */
+int gss_health_parse_keepalive(const char *arg, gss_health_config_t *config);
+
+/**
+ * @brief Parses "interval_ms[,misses]" into the heartbeat settings.
+ *
+ * @param arg
+ * @param config
+ * @return int 1 on success, -1 if malformed.
+ */
+int gss_health_parse_heartbeat(const char *arg, gss_health_config_t *config);
+
+/**
+ * @brief Applies the keepalive and user timeout settings to a newly accepted connection.
+ *
+ * @param socket
+ * @param config
+ * @return int 1 on success, -1 if any option could not be set.
+ */
+int gss_health_configure_socket(int socket, const gss_health_config_t *config);
+
+/**
+ * @brief Thread which sends heartbeats and disconnects silent vertices. Only started if heartbeats are enabled.
+ *
+ * @return void* NULL
+ */
+void *gss_health_thread(void *);
+
+#endif // GSS_HEALTH_HPP
@@ -0,0 +1,300 @@
+/**
+ * @file gss_latency.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Where a sampled frame's time goes between the kernel receiving it and the kernel sending it on, optionally written out as a Chrome trace.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * One frame in every N received is sampled. Its pool buffer carries the time of each point it passes (gss_pool_times(...)) from the RX thread through the router, and each destination's writer completes a sample of its own, so a frame broadcast to three GUI clients gives three. A sample is split into five hops:
+ *
+ * kernel rx: from the kernel receiving the frame to the RX thread's receive returning it.
+ * parse: from there to the frame being received whole, validated, and handed to the router in a pool buffer.
+ * route: from there to the router handing it to the destination's transmit queue (a GUI client's compression counts toward the queue).
+ * queue: from there to the destination's writer taking it off the queue.
+ * kernel tx: from there to the kernel handing its last packet to the driver, or, without that timestamp, to send(...) returning.
+ *
+ * Both ends are the kernel's SO_TIMESTAMPING software timestamps, which are in CLOCK_REALTIME, so every point in between is read from CLOCK_REALTIME too. The receive timestamp is that of the packet the frame's header arrived in when RX threads receive a frame at a time, and of the newest packet read when frames are received in batches or by a reactor, so for all but the last frame of a read the kernel rx hop is a lower bound. The io_uring engine's receives carry no timestamp, so its samples start at the RX thread. Hardware timestamps would need the NIC set up with SIOCSHWTSTAMP and its clock kept in step with CLOCK_REALTIME, so they are not used.
+ *
+ * A writer asks for a transmit timestamp (gss_frame_send_stamped(...)) for one sampled frame at a time, and reads it off the socket's error queue (gss_latency_reap(...)); frames sampled while it waits end at send(...) returning. Reactors (-r) take anything on a socket's error queue for a failed connection, so under them no transmit timestamps are asked for at all. Spliced frames never reach user space and are never sampled.
+ *
+ * Completed samples are summed per hop, for kill -USR1 and the metrics, and, with a trace file, queued for a writer thread which appends each as nested async events in the Chrome trace event format. chrome://tracing and ui.perfetto.dev open the file as it is, even if the server died before closing it.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_LATENCY_HPP
+#define GSS_LATENCY_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <semaphore.h>
+#include <atomic>
+#include "gss_ring.hpp"
+#include "gss_pool.hpp"
+#include "gss_topology.hpp"
+
+#define GSS_LATENCY_QUEUE_CAPACITY 4096 // Samples waiting for the trace writer before new ones are dropped.
+#define GSS_LATENCY_TX_TIMEOUT_MS 1000 // How long a writer waits for a transmit timestamp before completing the sample without one.
+
+/**
+ * @brief The points a sampled frame passes, in order. The first GSS_POOL_NUM_TIMES travel with the frame's buffer.
+ *
+ */
+enum GSS_LATENCY_POINT
+{
+    GSS_LATENCY_KERNEL_RX = 0, // The kernel received it.
+    GSS_LATENCY_RECEIVED, // The RX thread's receive returned with it. Non-zero marks a buffer as sampled.
+    GSS_LATENCY_PARSED, // Validated and handed to the router.
+    GSS_LATENCY_ROUTED, // Handed to the destination's transmit queue.
+    GSS_LATENCY_DEQUEUED, // Taken off the queue by the destination's writer.
+    GSS_LATENCY_SENT, // send(...) returned.
+    GSS_LATENCY_KERNEL_TX, // The kernel handed its last packet to the driver.
+    GSS_LATENCY_NUM_POINTS
+};
+
+static_assert(GSS_LATENCY_ROUTED < GSS_POOL_NUM_TIMES, "The points up to the writer are carried by the frame's buffer.");
+
+enum GSS_LATENCY_HOP
+{
+    GSS_LATENCY_HOP_KERNEL_RX = 0,
+    GSS_LATENCY_HOP_PARSE,
+    GSS_LATENCY_HOP_ROUTE,
+    GSS_LATENCY_HOP_QUEUE,
+    GSS_LATENCY_HOP_KERNEL_TX,
+    GSS_LATENCY_NUM_HOPS
+};
+
+/**
+ * @brief One frame's trip to one destination. Lives in a pool buffer.
+ *
+ */
+typedef struct
+{
+    uint64_t times[GSS_LATENCY_NUM_POINTS]; // CLOCK_REALTIME, 0 where unknown.
+    uint64_t id;
+    uint32_t type;
+    uint32_t frame_size;
+    uint8_t origin;
+    uint8_t destination;
+    int connection; // The destination connection.
+} gss_latency_sample_t;
+
+/**
+ * @brief A writer's sample waiting for its transmit timestamps. Only touched by that writer.
+ *
+ */
+typedef struct
+{
+    unsigned char *sample; // NULL if none is waiting.
+    int expected; // Timestamps asked for, one per write.
+    int received;
+} gss_latency_pending_t;
+
+/**
+ * @brief A snapshot of the counters.
+ *
+ */
+typedef struct
+{
+    uint64_t samples;
+    uint64_t kernel_rx; // Samples with a receive timestamp.
+    uint64_t kernel_tx; // Samples with a transmit timestamp.
+    uint64_t traced; // Samples written to the trace file.
+    uint64_t dropped; // Samples lost for want of a buffer, or because the trace writer fell behind.
+    uint64_t hop_count[GSS_LATENCY_NUM_HOPS];
+    uint64_t hop_ns[GSS_LATENCY_NUM_HOPS];
+    uint64_t total_ns; // From the first point known to the last, summed over samples.
+} gss_latency_stats_t;
+
+typedef struct
+{
+    int every; // Sample one frame in this many.
+    bool kernel_tx; // Writers may ask for transmit timestamps.
+    const gss_topology_t *topology; // To name vertices in the trace.
+    gss_pool_t *pool;
+
+    // The trace file, if any; only the trace writer touches it.
+    FILE *file;
+    uint64_t start_ns; // Trace time 0, CLOCK_REALTIME.
+    bool written; // Any event written yet, so the next needs a separating comma.
+    gss_ring_t ring;
+    alignas(64) sem_t samples; // Wake-up hint for the trace writer, as in gss_txq_t.
+    std::atomic<bool> active;
+
+    std::atomic<uint64_t> next_id;
+    std::atomic<uint64_t> samples_done;
+    std::atomic<uint64_t> kernel_rx;
+    std::atomic<uint64_t> kernel_tx_done;
+    std::atomic<uint64_t> traced;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> hop_count[GSS_LATENCY_NUM_HOPS];
+    std::atomic<uint64_t> hop_ns[GSS_LATENCY_NUM_HOPS];
+    std::atomic<uint64_t> total_ns;
+} gss_latency_t;
+
+/**
+ * @brief Begins sampling. The trace writer thread, if tracing to a file, must be started separately.
+ *
+ * @param every Sample one frame in this many (1 for every frame).
+ * @param path Chrome trace file to write, or NULL to only sum the hops.
+ * @param kernel_tx Whether writers may ask for transmit timestamps (false under reactors).
+ * @param topology
+ * @param pool Samples are allocated from, and returned to, this pool.
+ * @return gss_latency_t* NULL if the file could not be opened.
+ */
+gss_latency_t *gss_latency_create(int every, const char *path, bool kernel_tx, const gss_topology_t *topology, gss_pool_t *pool);
+
+/**
+ * @brief Closes the trace file and frees the state. The trace writer must have been joined.
+ *
+ * @param latency
+ */
+void gss_latency_destroy(gss_latency_t *latency);
+
+/**
+ * @brief Parses "N[,file]". The file is kept as a pointer into arg.
+ *
+ * @param arg
+ * @param every Set to N, which must be positive.
+ * @param path Set to the file, or NULL if there is none.
+ * @return int 1 on success, -1 on error.
+ */
+int gss_latency_parse(char *arg, int *every, const char **path);
+
+/**
+ * @brief Has a newly accepted connection report software receive timestamps, and transmit timestamps for the writes which ask for them.
+ *
+ * @param socket
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_latency_configure_socket(int socket);
+
+/**
+ * @brief The clock every point is read from.
+ *
+ * @return uint64_t
+ */
+static inline uint64_t gss_latency_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Whether the frame the calling RX thread is receiving should be sampled. Counted per thread, so it costs no shared write.
+ *
+ * @param latency NULL never samples.
+ * @return bool
+ */
+static inline bool gss_latency_due(gss_latency_t *latency)
+{
+    static thread_local int countdown = 0;
+
+    if (latency == NULL || --countdown > 0)
+    {
+        return false;
+    }
+    countdown = latency->every;
+    return true;
+}
+
+/**
+ * @brief Marks a frame's buffer as sampled, from when it was received, now that it is about to be routed.
+ *
+ * @param frame
+ * @param kernel_ns The kernel's receive timestamp, or 0 if there is none.
+ * @param received_ns When the RX thread's receive returned (gss_latency_now_ns()).
+ */
+static inline void gss_latency_begin(unsigned char *frame, uint64_t kernel_ns, uint64_t received_ns)
+{
+    uint64_t *times = gss_pool_times(frame);
+    times[GSS_LATENCY_KERNEL_RX] = kernel_ns;
+    times[GSS_LATENCY_RECEIVED] = received_ns;
+    times[GSS_LATENCY_PARSED] = gss_latency_now_ns();
+}
+
+/**
+ * @brief Records when a sampled frame passed a point; does nothing to a frame which is not sampled.
+ *
+ * @param frame
+ * @param point Up to GSS_LATENCY_ROUTED.
+ */
+static inline void gss_latency_mark(unsigned char *frame, int point)
+{
+    uint64_t *times = gss_pool_times(frame);
+    if (times[GSS_LATENCY_RECEIVED] != 0)
+    {
+        times[point] = gss_latency_now_ns();
+    }
+}
+
+/**
+ * @brief Starts a destination's sample of a frame its writer has just taken off the queue.
+ *
+ * @param latency NULL is ignored.
+ * @param frame
+ * @param frame_size
+ * @param connection The destination connection.
+ * @return unsigned char* The sample, or NULL if the frame is not sampled (or there is no buffer for it).
+ */
+unsigned char *gss_latency_dequeued(gss_latency_t *latency, const unsigned char *frame, size_t frame_size, int connection);
+
+/**
+ * @brief Whether the writer should ask for transmit timestamps for its sampled frame.
+ *
+ * @param latency
+ * @param pending
+ * @return bool
+ */
+static inline bool gss_latency_may_stamp(gss_latency_t *latency, const gss_latency_pending_t *pending)
+{
+    return latency->kernel_tx && pending->sample == NULL;
+}
+
+/**
+ * @brief Records that a sampled frame was sent, and completes its sample unless transmit timestamps are to follow.
+ *
+ * @param latency
+ * @param pending Where the sample waits for them.
+ * @param sample From gss_latency_dequeued(...).
+ * @param stamps Transmit timestamps asked for (gss_frame_send_stamped(...)), 0 if none.
+ */
+void gss_latency_sent(gss_latency_t *latency, gss_latency_pending_t *pending, unsigned char *sample, int stamps);
+
+/**
+ * @brief Reads any transmit timestamps off the socket's error queue, completing the waiting sample once all have arrived, or once it has waited GSS_LATENCY_TX_TIMEOUT_MS.
+ *
+ * @param latency NULL is ignored.
+ * @param pending
+ * @param socket -1 if the connection is gone, which completes the sample without them.
+ */
+void gss_latency_reap(gss_latency_t *latency, gss_latency_pending_t *pending, int socket);
+
+/**
+ * @brief Takes a snapshot of the counters.
+ *
+ * @param latency
+ * @param stats
+ */
+void gss_latency_get_stats(gss_latency_t *latency, gss_latency_stats_t *stats);
+
+/**
+ * @brief Names a hop, for stats and metrics.
+ *
+ * @param hop
+ * @return const char*
+ */
+const char *gss_latency_hop_name(int hop);
+
+/**
+ * @brief Trace writer thread which appends completed samples to the trace file. Writes whatever is queued once latency->active is cleared.
+ *
+ * @return void* NULL
+ */
+void *gss_latency_writer_thread(void *);
+
+#endif // GSS_LATENCY_HPP
@@ -0,0 +1,146 @@
+/**
+ * @file gss_log.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Asynchronous binary log of every routed frame.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Routing threads copy each frame into a record and push it onto a lock-free ring; a dedicated writer thread drains the ring and writes records in batches with writev(2), rotating to a new file once the current one reaches the size limit. Nothing on the forwarding path ever waits for the disk: if the writer falls behind, records are dropped and counted.
+ *
+ * A log file is a gss_log_file_header_t followed by records, each a gss_log_record_t followed by payload_size bytes of payload (none, though payload_size is still the frame's, if GSS_LOG_FLAG_NO_PAYLOAD is set). All fields are little-endian. tools/gss_logdump decodes and filters them.
+ *
+ * The same writer also records pass captures (see gss_capture.hpp), whose files have their own name, magic and records.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_LOG_HPP
+#define GSS_LOG_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <atomic>
+#include "gss_ring.hpp"
+#include "gss_pool.hpp"
+
+#define GSS_LOG_MAGIC "GSSLOG01"
+#define GSS_LOG_DEFAULT_ROTATE_SIZE 256000000 // Bytes per log file.
+#define GSS_LOG_QUEUE_CAPACITY 4096 // Records waiting for the writer before new ones are dropped.
+#define GSS_LOG_BATCH_SIZE 64 // Records per writev(2).
+
+#define GSS_LOG_FLAG_NO_PAYLOAD 0x1 // The payload was spliced through the kernel and never seen by the server.
+#define GSS_LOG_FLAG_NOT_FORWARDED 0x2 // The destination was not connected, so the frame was dropped.
+#define GSS_LOG_FLAG_SPOOLED 0x4 // The destination was not connected, so the frame was spooled until it reconnects.
+
+typedef struct __attribute__((packed))
+{
+    char magic[8]; // GSS_LOG_MAGIC
+    uint64_t created_ns; // CLOCK_REALTIME when the file was opened.
+    uint32_t sequence; // Rotation number, counting from 0 for each server run.
+    uint32_t reserved;
+} gss_log_file_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint64_t timestamp_ns; // CLOCK_REALTIME when the frame was routed.
+    uint8_t origin;
+    uint8_t destination;
+    uint8_t netstat;
+    uint8_t flags;
+    uint32_t type;
+    uint32_t payload_size;
+} gss_log_record_t;
+
+/**
+ * @brief A snapshot of the log's counters.
+ *
+ */
+typedef struct
+{
+    uint64_t logged;
+    uint64_t dropped;
+    uint64_t bytes_written;
+    uint64_t write_calls;
+    uint64_t rotations;
+} gss_log_stats_t;
+
+typedef struct
+{
+    gss_ring_t ring;
+    alignas(64) sem_t records; // Wake-up hint for the writer, as in gss_txq_t.
+    gss_pool_t *pool;
+    std::atomic<bool> active;
+
+    char directory[256];
+    char name[16]; // Files are <name>_<start>_<sequence>.bin.
+    char magic[8];
+    uint64_t rotate_size;
+    uint64_t start_ns;
+    uint32_t sequence;
+    int fd;
+    uint64_t file_size;
+
+    std::atomic<uint64_t> logged;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> bytes_written;
+    std::atomic<uint64_t> write_calls;
+    std::atomic<uint64_t> rotations;
+} gss_log_t;
+
+/**
+ * @brief Creates a log which writes into the given directory. The writer thread must be started separately.
+ *
+ * @param directory Created if it does not exist.
+ * @param name Prefix of the files' names, e.g. "gsslog".
+ * @param magic Eight characters at the start of each file, e.g. GSS_LOG_MAGIC.
+ * @param rotate_size Bytes per file before rotating.
+ * @param pool Records are allocated from, and returned to, this pool.
+ * @return gss_log_t* The log, or NULL if the directory could not be created.
+ */
+gss_log_t *gss_log_create(const char *directory, const char *name, const char *magic, uint64_t rotate_size, gss_pool_t *pool);
+
+/**
+ * @brief Frees the log. The writer must have been joined.
+ *
+ * @param log
+ */
+void gss_log_destroy(gss_log_t *log);
+
+/**
+ * @brief Queues a record of a serialized frame. Never blocks; drops the record if the writer has fallen behind.
+ *
+ * @param log NULL is ignored, so callers need not check whether logging is enabled.
+ * @param frame A serialized frame (at least its header, if GSS_LOG_FLAG_NO_PAYLOAD is set).
+ * @param flags GSS_LOG_FLAG_*
+ */
+void gss_log_frame(gss_log_t *log, const unsigned char *frame, uint8_t flags);
+
+/**
+ * @brief Queues a record made of a fixed-size head followed by data. Never blocks; drops the record if the writer has fallen behind.
+ *
+ * @param log
+ * @param head
+ * @param head_size
+ * @param data
+ * @param data_size
+ */
+void gss_log_record(gss_log_t *log, const void *head, size_t head_size, const unsigned char *data, size_t data_size);
+
+/**
+ * @brief Takes a snapshot of the log's counters.
+ *
+ * @param log
+ * @param stats
+ */
+void gss_log_get_stats(gss_log_t *log, gss_log_stats_t *stats);
+
+/**
+ * @brief Writer thread which drains the log's ring into files. Flushes whatever is queued once log->active is cleared.
+ *
+ * @return void* NULL
+ */
+void *gss_log_writer_thread(void *);
+
+#endif // GSS_LOG_HPP
@@ -0,0 +1,272 @@
+/**
+ * @file gss_metrics.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief In-process metrics registry, scraped over HTTP in the Prometheus text format.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Every thread which counts something claims its own shard on first use and only ever adds to that shard, so counting is an uncontended relaxed atomic add on a cache line no other thread writes. A scrape sums the shards; it never stops or slows the forwarding threads.
+ *
+ * Forwarding latency runs from when the router first sees a frame (gss_route_frame(...)) to when the destination's writer has sent it, and is recorded per route (origin and destination vertex, as written in the frame) and per transmit queue priority class (GSS_TXQ_CLASS) in power-of-two microsecond buckets.
+ *
+ * Counters are indexed by vertex index in the topology, with the server after the last vertex.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_METRICS_HPP
+#define GSS_METRICS_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "gss_frame.hpp"
+#include "gss_topology.hpp"
+
+#define GSS_METRICS_NUM_VERTICES (GSS_MAX_VERTICES + 1) // Every vertex, then the server.
+#define GSS_METRICS_NUM_BUCKETS 22 // Latency buckets of at most 1, 2, 4, ... 2^20 us (about 1 s), then everything slower.
+#define GSS_METRICS_MAX_SHARDS 64 // Threads beyond this share the last shard, which is still correct, just contended.
+#define GSS_METRICS_NUM_CLASSES 3 // GSS_TXQ_NUM_CLASSES, which gss_txq.hpp checks.
+
+/**
+ * @brief Why a frame did not reach its destination.
+ *
+ */
+enum GSS_METRICS_FAILURE
+{
+    GSS_METRICS_SEND_FAILED = 0, // The destination's socket returned an error.
+    GSS_METRICS_NOT_READY, // The destination was not connected.
+    GSS_METRICS_NUM_FAILURES
+};
+
+/**
+ * @brief Counters owned by one thread.
+ *
+ */
+typedef struct
+{
+    alignas(64) std::atomic<uint64_t> frames_in[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> bytes_in[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> frames_out[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> bytes_out[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> failures[GSS_METRICS_NUM_VERTICES][GSS_METRICS_NUM_FAILURES];
+    std::atomic<uint64_t> reconnects[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> corrupt[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> resync_bytes[GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> latency_count[GSS_METRICS_NUM_VERTICES][GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> latency_sum_ns[GSS_METRICS_NUM_VERTICES][GSS_METRICS_NUM_VERTICES];
+    std::atomic<uint64_t> latency_buckets[GSS_METRICS_NUM_VERTICES][GSS_METRICS_NUM_VERTICES][GSS_METRICS_NUM_BUCKETS];
+    std::atomic<uint64_t> class_latency_count[GSS_METRICS_NUM_CLASSES];
+    std::atomic<uint64_t> class_latency_sum_ns[GSS_METRICS_NUM_CLASSES];
+    std::atomic<uint64_t> class_latency_buckets[GSS_METRICS_NUM_CLASSES][GSS_METRICS_NUM_BUCKETS];
+} gss_metrics_shard_t;
+
+typedef struct
+{
+    gss_metrics_shard_t shards[GSS_METRICS_MAX_SHARDS];
+    std::atomic<int> num_shards;
+    std::atomic<bool> active; // Cleared to stop gss_metrics_thread(...).
+    int port; // Scrapes are served on 127.0.0.1:port.
+    int listening_socket; // From gss_metrics_listen(...).
+    const gss_topology_t *topology; // Maps the vertex IDs in frames to indices, and names them.
+} gss_metrics_t;
+
+/**
+ * @brief Claims this thread's shard on its first call.
+ *
+ * @param metrics
+ * @return gss_metrics_shard_t*
+ */
+gss_metrics_shard_t *gss_metrics_shard_claim(gss_metrics_t *metrics);
+
+extern thread_local gss_metrics_shard_t *gss_metrics_local_shard;
+
+static inline gss_metrics_shard_t *gss_metrics_shard(gss_metrics_t *metrics)
+{
+    return gss_metrics_local_shard != NULL ? gss_metrics_local_shard : gss_metrics_shard_claim(metrics);
+}
+
+static inline void gss_metrics_add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Maps a vertex ID, as written in a frame, to its counters' index.
+ *
+ * @return int Vertex index, num_vertices for the server, or -1 if no vertex has the ID.
+ */
+static inline int gss_metrics_index(const gss_topology_t *topology, uint8_t id)
+{
+    int index = gss_topology_route(topology, id);
+    return index == GSS_ROUTE_SERVER ? topology->num_vertices : index;
+}
+
+/**
+ * @brief Chooses a latency's power-of-two microsecond bucket.
+ *
+ * @param latency_ns
+ * @return int 0 through GSS_METRICS_NUM_BUCKETS - 1.
+ */
+static inline int gss_metrics_bucket(uint64_t latency_ns)
+{
+    uint64_t latency_us = latency_ns / 1000;
+    int bucket = latency_us <= 1 ? 0 : 64 - __builtin_clzll(latency_us - 1);
+    return bucket < GSS_METRICS_NUM_BUCKETS - 1 ? bucket : GSS_METRICS_NUM_BUCKETS - 1;
+}
+
+/**
+ * @brief Counts a frame received from a vertex.
+ *
+ * @param metrics NULL is ignored, so callers need not check whether metrics are enabled.
+ * @param vertex
+ * @param frame_size
+ */
+static inline void gss_metrics_received(gss_metrics_t *metrics, int vertex, size_t frame_size)
+{
+    if (metrics == NULL || vertex < 0 || vertex >= GSS_METRICS_NUM_VERTICES)
+    {
+        return;
+    }
+
+    gss_metrics_shard_t *shard = gss_metrics_shard(metrics);
+    gss_metrics_add(shard->frames_in[vertex], 1);
+    gss_metrics_add(shard->bytes_in[vertex], frame_size);
+}
+
+/**
+ * @brief Counts a frame sent to its destination and, if it was stamped, records its forwarding latency.
+ *
+ * @param metrics NULL is ignored.
+ * @param frame A serialized frame (at least its header).
+ * @param frame_size
+ * @param tx_class The transmit queue priority class it was sent from.
+ * @param stamp_ns When the router first saw the frame (gss_health_now_ns()), or 0 if unknown.
+ * @param now_ns
+ */
+static inline void gss_metrics_sent(gss_metrics_t *metrics, const unsigned char *frame, size_t frame_size, int tx_class, uint64_t stamp_ns, uint64_t now_ns)
+{
+    if (metrics == NULL)
+    {
+        return;
+    }
+
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    int origin = gss_metrics_index(metrics->topology, header->origin);
+    int destination = gss_metrics_index(metrics->topology, header->destination);
+    if (origin < 0 || destination < 0)
+    {
+        return;
+    }
+
+    gss_metrics_shard_t *shard = gss_metrics_shard(metrics);
+    gss_metrics_add(shard->frames_out[destination], 1);
+    gss_metrics_add(shard->bytes_out[destination], frame_size);
+
+    if (stamp_ns == 0 || now_ns < stamp_ns)
+    {
+        return;
+    }
+
+    uint64_t latency_ns = now_ns - stamp_ns;
+    int bucket = gss_metrics_bucket(latency_ns);
+
+    gss_metrics_add(shard->latency_count[origin][destination], 1);
+    gss_metrics_add(shard->latency_sum_ns[origin][destination], latency_ns);
+    gss_metrics_add(shard->latency_buckets[origin][destination][bucket], 1);
+
+    if (tx_class >= 0 && tx_class < GSS_METRICS_NUM_CLASSES)
+    {
+        gss_metrics_add(shard->class_latency_count[tx_class], 1);
+        gss_metrics_add(shard->class_latency_sum_ns[tx_class], latency_ns);
+        gss_metrics_add(shard->class_latency_buckets[tx_class][bucket], 1);
+    }
+}
+
+/**
+ * @brief Counts a frame which could not be delivered to a vertex.
+ *
+ * @param metrics NULL is ignored.
+ * @param vertex The destination.
+ * @param reason
+ */
+static inline void gss_metrics_failed(gss_metrics_t *metrics, int vertex, GSS_METRICS_FAILURE reason)
+{
+    if (metrics == NULL || vertex < 0 || vertex >= GSS_METRICS_NUM_VERTICES)
+    {
+        return;
+    }
+
+    gss_metrics_add(gss_metrics_shard(metrics)->failures[vertex][reason], 1);
+}
+
+/**
+ * @brief Counts a new connection from a vertex.
+ *
+ * @param metrics NULL is ignored.
+ * @param vertex
+ */
+static inline void gss_metrics_reconnected(gss_metrics_t *metrics, int vertex)
+{
+    if (metrics == NULL || vertex < 0 || vertex >= GSS_METRICS_NUM_VERTICES)
+    {
+        return;
+    }
+
+    gss_metrics_add(gss_metrics_shard(metrics)->reconnects[vertex], 1);
+}
+
+/**
+ * @brief Counts invalid data discarded from a vertex's stream while resynchronizing to the next frame.
+ *
+ * @param metrics NULL is ignored.
+ * @param vertex
+ * @param skipped Bytes discarded.
+ */
+static inline void gss_metrics_corrupt(gss_metrics_t *metrics, int vertex, size_t skipped)
+{
+    if (metrics == NULL || vertex < 0 || vertex >= GSS_METRICS_NUM_VERTICES)
+    {
+        return;
+    }
+
+    gss_metrics_shard_t *shard = gss_metrics_shard(metrics);
+    gss_metrics_add(shard->corrupt[vertex], 1);
+    gss_metrics_add(shard->resync_bytes[vertex], skipped);
+}
+
+/**
+ * @brief Creates a registry with every counter at zero. The scrape socket must be bound (gss_metrics_listen(...)) and the scrape thread started separately.
+ *
+ * @param port Local TCP port to serve scrapes on.
+ * @param topology Must outlive the registry.
+ * @return gss_metrics_t*
+ */
+gss_metrics_t *gss_metrics_create(int port, const gss_topology_t *topology);
+
+/**
+ * @brief Creates, binds, and begins listening on the scrape socket, or takes over the previous instance's after a hot restart. Must be called before the scrape thread starts.
+ *
+ * @param metrics
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_metrics_listen(gss_metrics_t *metrics);
+
+/**
+ * @brief Frees the registry. The scrape thread and every thread which counts must have been joined.
+ *
+ * @param metrics
+ */
+void gss_metrics_destroy(gss_metrics_t *metrics);
+
+/**
+ * @brief Thread which serves the Prometheus text format to HTTP requests on 127.0.0.1:port, summing the shards on each scrape.
+ *
+ * Runs until global->metrics->active is cleared.
+ *
+ * @return void* NULL
+ */
+void *gss_metrics_thread(void *);
+
+#endif // GSS_METRICS_HPP
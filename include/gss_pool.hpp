@@ -0,0 +1,130 @@
+/**
+ * @file gss_pool.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Pool of reusable serialized-frame buffers.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * A frame buffer is taken from the pool by whoever receives the frame, travels through the router and the destination's transmit queue, and is handed back by the writer once it has been sent (or by whoever drops it). Buffers come in a few size classes and are only ever malloc'd when a class's free list is empty, so steady-state forwarding does not touch the heap.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_POOL_HPP
+#define GSS_POOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "gss_ring.hpp"
+
+#define GSS_POOL_NUM_CLASSES 5
+#define GSS_POOL_CLASS_CAPACITY 1024 // How many idle buffers each size class keeps before freeing returned ones.
+#define GSS_POOL_MAX_SIZE (GSS_FRAME_MAX_SIZE + 64) // Largest buffer handed out; the slack fits a maximum payload behind a header larger than a frame's (e.g. a gss_log_record_t).
+#define GSS_POOL_NUM_TIMES 4 // Timestamps each buffer carries for latency tracing (see gss_latency.hpp).
+
+/**
+ * @brief A snapshot of the pool's counters.
+ *
+ */
+typedef struct
+{
+    uint64_t gets; // One per frame received or generated.
+    uint64_t puts;
+    uint64_t heap_allocations; // Buffers malloc'd because a free list was empty.
+    uint64_t heap_frees; // Buffers freed because a free list was full.
+    uint64_t outstanding; // Buffers currently in use.
+    uint64_t high_water; // Most buffers ever in use at once.
+} gss_pool_stats_t;
+
+typedef struct
+{
+    gss_ring_t free_list[GSS_POOL_NUM_CLASSES];
+    std::atomic<uint64_t> gets;
+    std::atomic<uint64_t> puts;
+    std::atomic<uint64_t> heap_allocations;
+    std::atomic<uint64_t> heap_frees;
+    std::atomic<uint64_t> high_water;
+} gss_pool_t;
+
+/**
+ * @brief Creates an empty pool; buffers are allocated on first use.
+ *
+ * @return gss_pool_t*
+ */
+gss_pool_t *gss_pool_create();
+
+/**
+ * @brief Frees the pool and every idle buffer. Buffers still in use are not tracked and must be returned first.
+ *
+ * @param pool
+ */
+void gss_pool_destroy(gss_pool_t *pool);
+
+/**
+ * @brief Takes a buffer with room for at least size bytes.
+ *
+ * @param pool
+ * @param size At most GSS_FRAME_MAX_SIZE.
+ * @return unsigned char* The buffer, or NULL if size is too large or the heap is exhausted.
+ */
+unsigned char *gss_pool_get(gss_pool_t *pool, size_t size);
+
+/**
+ * @brief Returns a buffer obtained from gss_pool_get(...), or drops one reference to a shared buffer. May be called from any thread.
+ *
+ * @param pool
+ * @param buffer NULL is ignored.
+ */
+void gss_pool_put(gss_pool_t *pool, unsigned char *buffer);
+
+/**
+ * @brief Adds references to a buffer so several owners (e.g. the transmit queues of every GUI client) can hold it at once. The buffer goes back to the pool when the last owner puts it, so it must not be modified once shared.
+ *
+ * @param buffer A buffer from gss_pool_get(...), which starts with one reference.
+ * @param count References to add.
+ */
+void gss_pool_share(unsigned char *buffer, uint32_t count);
+
+/**
+ * @brief Records when a buffer's frame entered the server, for the metrics' forwarding latency. Stored alongside the buffer, so it travels with the frame through every queue.
+ *
+ * @param buffer A buffer from gss_pool_get(...), whose stamp starts at 0.
+ * @param stamp_ns
+ */
+void gss_pool_set_stamp(unsigned char *buffer, uint64_t stamp_ns);
+
+/**
+ * @brief Reads the stamp set by gss_pool_set_stamp(...).
+ *
+ * @param buffer
+ * @return uint64_t The stamp, or 0 if none was set.
+ */
+uint64_t gss_pool_stamp(const unsigned char *buffer);
+
+/**
+ * @brief The timestamps stored alongside a buffer for latency tracing (gss_latency.hpp), which like the stamp travel with the frame.
+ *
+ * @param buffer A buffer from gss_pool_get(...), whose times start at 0.
+ * @return uint64_t* GSS_POOL_NUM_TIMES timestamps.
+ */
+uint64_t *gss_pool_times(const unsigned char *buffer);
+
+/**
+ * @brief Gives a buffer holding a copy of a frame (e.g. compressed or expanded) the stamp and times of the original.
+ *
+ * @param buffer
+ * @param original
+ */
+void gss_pool_copy_stamp(unsigned char *buffer, const unsigned char *original);
+
+/**
+ * @brief Takes a snapshot of the pool's counters.
+ *
+ * @param pool
+ * @param stats
+ */
+void gss_pool_get_stats(gss_pool_t *pool, gss_pool_stats_t *stats);
+
+#endif // GSS_POOL_HPP
@@ -0,0 +1,42 @@
+/**
+ * @file gss_reactor.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Event-loop (epoll) alternative to the per-port RX threads.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Each reactor thread owns the listening and accepted sockets of every vertex whose index is congruent to its own reactor index (all of the GUI client's connections go with the client's), so one reactor handles all five ports and N reactors split them round-robin. Routing is identical to gss_network_rx_thread(...).
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_REACTOR_HPP
+#define GSS_REACTOR_HPP
+
+#include "gss.hpp"
+
+#define GSS_REACTOR_MAX_EVENTS 16
+#define GSS_REACTOR_TICK_MS 500 // How often a reactor wakes up to check for shutdown and idle connections.
+
+/**
+ * @brief Arguments passed to each reactor thread.
+ *
+ */
+typedef struct
+{
+    global_data_t *global;
+    int reactor_index;
+    int num_reactors;
+} gss_reactor_args_t;
+
+/**
+ * @brief Event loop which listens for, accepts, receives from, and routes for every vertex assigned to this reactor.
+ *
+ * Runs until recv_active is cleared for all of its vertices.
+ *
+ * @return void* NULL
+ */
+void *gss_reactor_thread(void *);
+
+#endif // GSS_REACTOR_HPP
@@ -0,0 +1,137 @@
+/**
+ * @file gss_recv.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Batched receive engines for the RX threads.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * By default an RX thread makes two blocking recv(...) calls per frame, one for the header and one for the rest. The engines here instead read as much of the stream as is available into a gss_frame_decoder_t and hand back every complete frame in it before reading again, so a burst of small frames costs one receive instead of two per frame.
+ *
+ * The batch engine does so with a blocking recv(...) into the decoder. The io_uring engine keeps one multishot receive armed on the connection, which the kernel completes into one of a set of provided buffers whenever data arrives, so while frames keep arriving the thread only enters the kernel to reap completions, and each completion usually carries several frames. It is driven with the raw system calls rather than liburing, and falls back to the batch engine if the kernel does not support multishot receives (Linux 6.0 and newer). Buffers are handed back with IORING_OP_PROVIDE_BUFFERS submissions, which ride along with the next io_uring_enter(...), rather than through a registered buffer ring, which not every kernel that has one handles reliably.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_RECV_HPP
+#define GSS_RECV_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <linux/io_uring.h>
+#include "gss_frame.hpp"
+
+#define GSS_RECV_URING_BUFFERS 32 // Provided buffers per RX thread.
+#define GSS_RECV_URING_BUFFER_SIZE 16384
+
+enum GSS_RECV_ENGINE
+{
+    GSS_RECV_FRAME = 0, // Header and body, one frame at a time (gss_frame_recv_header(...)).
+    GSS_RECV_BATCH, // recv(...) as much as is available, then parse every frame in it.
+    GSS_RECV_URING // A multishot io_uring receive into registered buffers.
+};
+
+/**
+ * @brief One RX thread's receive engine and the stream it has read but not yet handed out.
+ *
+ */
+typedef struct
+{
+    GSS_RECV_ENGINE engine;
+    int socket;
+    gss_frame_decoder_t decoder;
+    size_t offset; // Bytes at the front of the decoder already handed out by gss_recv_next(...).
+    size_t skipped; // Bytes discarded by the last gss_recv_next(...) which returned -1.
+
+    // io_uring state, only used by GSS_RECV_URING.
+    int ring_fd;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    uint32_t *sq_tail;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t *sq_array;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned char *buffers; // GSS_RECV_URING_BUFFERS provided buffers, back to back.
+    bool armed; // The multishot receive may still post completions.
+    uint32_t to_submit;
+    int chunk_bid; // Provided buffer still holding bytes which did not fit in the decoder, or -1.
+    size_t chunk_offset;
+    size_t chunk_size;
+
+    bool stamped; // Collect the kernel's receive timestamps (batch engine only; see gss_latency.hpp). Set after gss_recv_init(...).
+    uint64_t kernel_ns; // When the newest packet the last gss_recv_fill(...) read arrived, or 0 if unknown.
+
+    uint64_t syscalls; // Receive system calls (recv(...) or io_uring_enter(...)) since gss_recv_start(...).
+    uint64_t frames;
+} gss_recv_t;
+
+/**
+ * @brief Prepares an RX thread's receive engine. GSS_RECV_URING falls back to GSS_RECV_BATCH, with a warning, if io_uring is unavailable.
+ *
+ * @param receiver
+ * @param engine Must not be GSS_RECV_FRAME, which needs no state.
+ * @param t_tag Prefix for debug output.
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_recv_init(gss_recv_t *receiver, GSS_RECV_ENGINE engine, const char *t_tag);
+
+/**
+ * @brief Begins receiving on a newly accepted connection.
+ *
+ * @param receiver
+ * @param socket
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_recv_start(gss_recv_t *receiver, int socket);
+
+/**
+ * @brief Waits for more of the stream and appends it to the decoder.
+ *
+ * @param receiver
+ * @param timeout_s How long to wait for anything to arrive; the batch engine relies on the socket's SO_RCVTIMEO instead.
+ * @return ssize_t Bytes added, -404 if the peer closed the connection, or -1 on error (errno is EAGAIN on a timeout).
+ */
+ssize_t gss_recv_fill(gss_recv_t *receiver, int timeout_s);
+
+/**
+ * @brief Hands out the next complete frame already received. The frame stays valid until the next gss_recv_fill(...).
+ *
+ * @param receiver
+ * @param frame Set to the frame within the decoder.
+ * @return ssize_t Size of the frame, 0 if more bytes are needed, or -1 if invalid data was discarded (receiver->skipped bytes of it), in which case it should be called again.
+ */
+ssize_t gss_recv_next(gss_recv_t *receiver, unsigned char **frame);
+
+/**
+ * @brief Stops receiving on the current connection, before its socket is closed. Any multishot receive is cancelled.
+ *
+ * @param receiver
+ */
+void gss_recv_stop(gss_recv_t *receiver);
+
+/**
+ * @brief Releases the engine's ring and buffers.
+ *
+ * @param receiver
+ */
+void gss_recv_close(gss_recv_t *receiver);
+
+/**
+ * @brief Parses a receive engine name (frame, batch, uring).
+ *
+ * @param name
+ * @param engine
+ * @return int 1 on success, -1 if the name is not recognized.
+ */
+int gss_recv_parse_engine(const char *name, GSS_RECV_ENGINE *engine);
+
+#endif // GSS_RECV_HPP
@@ -0,0 +1,67 @@
+/**
+ * @file gss_reload.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Hot restart: handing the listening sockets to a new server instance.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * On SIGHUP the server starts a new instance of itself (the binary now at the path it was started from, so a deployment only has to replace the file), with the same arguments, and lets it inherit every listening socket instead of binding its own. The ports therefore never close, and connection attempts made during the restart wait in the sockets' backlog rather than being refused. Once the new instance is listening on every port it says so over a pipe, and only then does the old one stop accepting, drain its transmit queues, and exit; its vertices reconnect to the new instance straight away.
+ *
+ * The sockets are passed as inherited file descriptors, listed in the GSS_LISTEN_FDS environment variable as port:fd pairs. If the new instance does not become ready in time the old one kills it and carries on serving.
+ *
+ * Every instance, restarted or not, binds all of its ports before any worker starts, and says it is ready as soon as the last one is listening: to a service manager over NOTIFY_SOCKET, as sd_notify(3) would (READY=1 and MAINPID, so a Type=notify unit with NotifyAccess=all follows a hot restart), and, if asked, by writing its PID to a ready file, which it removes when it exits.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_RELOAD_HPP
+#define GSS_RELOAD_HPP
+
+#include "gss_topology.hpp"
+
+#define GSS_RELOAD_FDS_ENV "GSS_LISTEN_FDS" // port:fd,port:fd,... of the listening sockets inherited from the previous instance.
+#define GSS_RELOAD_READY_ENV "GSS_READY_FD" // Pipe to the previous instance, written to once every port is listening.
+#define GSS_RELOAD_NOTIFY_ENV "NOTIFY_SOCKET" // The service manager's socket, as set by systemd for Type=notify units.
+#define GSS_RELOAD_MAX_SOCKETS (GSS_MAX_VERTICES + 1) // Every vertex's port and the metrics port.
+#define GSS_RELOAD_READY_TIMEOUT_S 30 // How long the old instance waits for the new one.
+
+/**
+ * @brief Records how to start a new instance, and how many listening sockets this one will have once it is ready.
+ *
+ * @param argv main(...)'s, which must stay valid.
+ * @param num_sockets Listening sockets to expect gss_reload_listening(...) for.
+ * @param ready_path File to write this instance's PID to once it is ready, or NULL. Must stay valid.
+ */
+void gss_reload_init(char *const argv[], int num_sockets, const char *ready_path);
+
+/**
+ * @brief Takes over the listening socket for a port from the previous instance, if it handed one down.
+ *
+ * @param port
+ * @return int The listening socket, or -1 if the caller should create one.
+ */
+int gss_reload_inherit(int port);
+
+/**
+ * @brief Records a socket listening on a port, so it can be handed down. Once every expected socket is listening, tells the previous instance (if any), the service manager (if any), and the ready file (if any) that this one is ready, and closes any inherited sockets nothing took.
+ *
+ * @param port
+ * @param socket
+ */
+void gss_reload_listening(int port, int socket);
+
+/**
+ * @brief Starts a new instance which inherits every listening socket, and waits for it to be listening.
+ *
+ * @return int 1 once the new instance is ready (this one should now drain and exit), -1 if it could not be started or did not become ready (this one should carry on).
+ */
+int gss_reload_spawn();
+
+/**
+ * @brief Removes the ready file, unless a new instance has taken it over.
+ *
+ */
+void gss_reload_exit();
+
+#endif // GSS_RELOAD_HPP
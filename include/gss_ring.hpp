@@ -0,0 +1,168 @@
+/**
+ * @file gss_ring.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Bounded lock-free MPMC ring of buffer pointers (Vyukov's bounded queue).
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Backs both the per-destination transmit queues and the frame buffer pool's free lists. Sequence numbers per cell make it immune to ABA, so buffers may be pushed and popped from any thread.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_RING_HPP
+#define GSS_RING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+typedef struct
+{
+    std::atomic<size_t> sequence;
+    unsigned char *data;
+    size_t size;
+} gss_ring_cell_t;
+
+typedef struct
+{
+    gss_ring_cell_t *cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+} gss_ring_t;
+
+/**
+ * @brief Allocates the ring's cells.
+ *
+ * @param ring
+ * @param capacity Rounded up to a power of two.
+ */
+static inline void gss_ring_init(gss_ring_t *ring, size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    ring->cells = new gss_ring_cell_t[size];
+    ring->mask = size - 1;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        ring->cells[i].sequence.store(i, std::memory_order_relaxed);
+        ring->cells[i].data = NULL;
+        ring->cells[i].size = 0;
+    }
+
+    ring->enqueue_pos.store(0);
+    ring->dequeue_pos.store(0);
+}
+
+/**
+ * @brief Frees the ring's cells. Does not touch whatever the cells point to.
+ *
+ * @param ring
+ */
+static inline void gss_ring_free(gss_ring_t *ring)
+{
+    delete[] ring->cells;
+    ring->cells = NULL;
+}
+
+/**
+ * @brief Appends an entry.
+ *
+ * @return true Queued.
+ * @return false The ring is full.
+ */
+static inline bool gss_ring_push(gss_ring_t *ring, unsigned char *data, size_t size)
+{
+    size_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    gss_ring_cell_t *cell;
+
+    while (true)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (ring->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = data;
+    cell->size = size;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief Removes the oldest entry.
+ *
+ * @return true An entry was removed.
+ * @return false The ring is empty.
+ */
+static inline bool gss_ring_pop(gss_ring_t *ring, unsigned char **data, size_t *size)
+{
+    size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    gss_ring_cell_t *cell;
+
+    while (true)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (ring->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    *data = cell->data;
+    *size = cell->size;
+    cell->sequence.store(pos + ring->mask + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief Approximate number of entries; exact when no push or pop is in progress.
+ *
+ */
+static inline size_t gss_ring_depth(gss_ring_t *ring)
+{
+    size_t enqueue_pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    size_t dequeue_pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+}
+
+#endif // GSS_RING_HPP
@@ -0,0 +1,59 @@
+/**
+ * @file gss_splice.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Zero-copy forwarding of frame bodies from one socket to another with splice(2).
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Once an RX thread has read and validated a frame's header, the payload can be moved from the origin's socket to the destination's socket through a pipe without ever being copied into user space. The payload waits in the pipe until the footer has been read and checked, unless it does not fit.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_SPLICE_HPP
+#define GSS_SPLICE_HPP
+
+#include <sys/types.h>
+#include "gss_frame.hpp"
+
+/**
+ * @brief The pipe one RX thread splices through.
+ *
+ */
+typedef struct
+{
+    int pipe_fds[2];
+    size_t pipe_size;
+} gss_splice_t;
+
+/**
+ * @brief Creates the pipe and grows it to hold a whole frame if the system allows.
+ *
+ * @param splicer
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_splice_init(gss_splice_t *splicer);
+
+/**
+ * @brief Closes the pipe.
+ *
+ * @param splicer
+ */
+void gss_splice_close(gss_splice_t *splicer);
+
+/**
+ * @brief Moves a frame's payload from src into the pipe and reads its footer, then, if the footer is valid, sends the (patched) header, the payload and the footer to dst.
+ *
+ * Only the footer's termination and CRC2 can be checked, since the payload never enters user space. A payload which does not fit in the pipe is forwarded as it arrives instead, before its footer is seen; if the footer then turns out invalid, or dst fails part of the way through a frame, dst is shut down, since whatever was sent on it next would be out of step.
+ *
+ * @param splicer
+ * @param src
+ * @param dst
+ * @param header The frame's header, already read from src.
+ * @param decoder If the footer is invalid and nothing was sent to dst, set to hold the whole frame, to resynchronize on (see gss_frame_decoder_recv(...)).
+ * @return ssize_t Frame size if the whole frame reached dst, 0 if dst was shut down part of the way through it (the frame was consumed from src regardless), -404 if src was closed, or -1 on error (errno is EBADMSG if the footer is invalid); nothing was sent to dst in either case.
+ */
+ssize_t gss_splice_forward(gss_splice_t *splicer, int src, int dst, const gss_frame_header_t *header, gss_frame_decoder_t *decoder);
+
+#endif // GSS_SPLICE_HPP
@@ -0,0 +1,158 @@
+/**
+ * @file gss_spool.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Store-and-forward spool for frames whose destination vertex is offline.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Instead of dropping a frame for a disconnected vertex, the router hands it to that vertex's spool. Frames are kept in memory up to a frame limit and then, if an overflow directory is configured, in a memory-mapped segment file, so a long outage costs page cache rather than heap. When the vertex reconnects its writer sends everything spooled, oldest first, before anything queued since, so a short outage costs latency instead of data.
+ *
+ * Frames older than the TTL are discarded rather than sent, and once both the memory ring and the segment are full the oldest frame makes room for the newest. The segment is scratch space for the current run, not a durable queue: it is recreated on startup and removed on shutdown.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_SPOOL_HPP
+#define GSS_SPOOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+#include "gss_pool.hpp"
+
+#define GSS_SPOOL_DEFAULT_CAPACITY 1024 // Frames kept in memory per vertex before overflowing to disk.
+#define GSS_SPOOL_DEFAULT_SEGMENT_MB 64 // Size of each vertex's overflow segment.
+
+typedef struct
+{
+    int ttl_s; // 0 leaves spooling off.
+    int capacity;
+    const char *directory; // Where overflow segments go; NULL keeps the spool in memory only.
+    int segment_mb;
+} gss_spool_config_t;
+
+/**
+ * @brief A snapshot of a spool's counters.
+ *
+ */
+typedef struct
+{
+    size_t depth; // Frames currently spooled, in memory and on disk.
+    size_t on_disk;
+    uint64_t spooled;
+    uint64_t flushed; // Handed to the writer once the vertex reconnected.
+    uint64_t expired; // Older than the TTL by the time the vertex reconnected.
+    uint64_t evicted; // Discarded to make room for newer frames.
+} gss_spool_stats_t;
+
+typedef struct
+{
+    unsigned char *frame;
+    size_t frame_size;
+    uint64_t spooled_ns;
+} gss_spool_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock; // Spooling only happens while a vertex is offline, so a lock costs the forwarding path nothing.
+    gss_pool_t *pool;
+    uint64_t ttl_ns;
+
+    // In-memory ring of pool buffers; holds the oldest frames, and is kept full while the segment is not empty.
+    gss_spool_entry_t *entries;
+    size_t capacity;
+    size_t head;
+    size_t count;
+
+    // Memory-mapped overflow segment, a circular log of records; holds everything newer than the ring while non-empty.
+    char path[300];
+    int fd;
+    unsigned char *segment;
+    size_t segment_size;
+    size_t segment_head;
+    size_t segment_tail;
+    size_t segment_used;
+    size_t segment_frames;
+
+    std::atomic<size_t> depth; // Read without the lock to skip empty spools.
+    std::atomic<uint64_t> spooled;
+    std::atomic<uint64_t> flushed;
+    std::atomic<uint64_t> expired;
+    std::atomic<uint64_t> evicted;
+} gss_spool_t;
+
+/**
+ * @brief Creates the spool for one vertex.
+ *
+ * @param vertex Used to name the overflow segment.
+ * @param config
+ * @param pool Spooled frames are pool buffers, and frames read back from disk are copied into new ones.
+ * @return gss_spool_t* The spool, or NULL if the overflow segment could not be created.
+ */
+gss_spool_t *gss_spool_create(int vertex, const gss_spool_config_t *config, gss_pool_t *pool);
+
+/**
+ * @brief Returns every spooled frame to the pool, removes the overflow segment, and frees the spool.
+ *
+ * @param spool
+ */
+void gss_spool_destroy(gss_spool_t *spool);
+
+/**
+ * @brief Spools a frame. Takes ownership of it either way.
+ *
+ * @param spool
+ * @param frame A buffer from the spool's pool.
+ * @param frame_size
+ */
+void gss_spool_push(gss_spool_t *spool, unsigned char *frame, size_t frame_size);
+
+/**
+ * @brief Takes the oldest unexpired frame out of the spool.
+ *
+ * @param spool
+ * @param frame_size Set to the frame's size.
+ * @return unsigned char* A pool buffer the caller now owns, or NULL if the spool is empty.
+ */
+unsigned char *gss_spool_pop(gss_spool_t *spool, size_t *frame_size);
+
+/**
+ * @brief Number of frames spooled; exact when no push or pop is in progress.
+ *
+ * @param spool
+ * @return size_t
+ */
+static inline size_t gss_spool_depth(gss_spool_t *spool)
+{
+    return spool->depth.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Takes a snapshot of the spool's counters.
+ *
+ * @param spool
+ * @param stats
+ */
+void gss_spool_get_stats(gss_spool_t *spool, gss_spool_stats_t *stats);
+
+/**
+ * @brief Parses "ttl_s[,frames]" into the spool settings.
+ *
+ * @param arg
+ * @param config
+ * @return int 1 on success, -1 if malformed.
+ */
+int gss_spool_parse(const char *arg, gss_spool_config_t *config);
+
+/**
+ * @brief Parses "directory[,segment_mb]" into the overflow settings. The directory is kept as a pointer into arg.
+ *
+ * @param arg Modified in place.
+ * @param config
+ * @return int 1 on success, -1 if malformed.
+ */
+int gss_spool_parse_overflow(char *arg, gss_spool_config_t *config);
+
+#endif // GSS_SPOOL_HPP
@@ -0,0 +1,116 @@
+/**
+ * @file gss_topology.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief The set of vertices the server routes between, loaded at startup.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Each vertex (the GUI client, an antenna, a ground station) has an ID, which is what frames carry in their origin and destination, a name, and a port it connects to. Internally vertices are referred to by their index in the topology, and gss_topology_t::route maps every possible ID to an index in one load, so routing a frame costs the same however many vertices there are.
+ *
+ * Without a configuration file the topology is the original one: the client and the four radios on ports 54200 through 54240 (see gss.conf). The netstat byte only has room for vertices with IDs below 8; others are routed normally but never appear in it.
+ *
+ * Each vertex may also say where its threads run, so that the server can be kept off the cores the SDR demodulators use: a set of CPUs (or a NUMA node's CPUs) for its receive and transmit threads, a SCHED_FIFO priority for them, and a SO_BUSY_POLL time for its connections. The threads are created with these attributes rather than changed once running, so their stacks and everything they allocate on their first run are placed on the right node.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_TOPOLOGY_HPP
+#define GSS_TOPOLOGY_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define GSS_MAX_VERTICES 16 // Vertices a topology may define, the GUI client included.
+#define GSS_TOPOLOGY_NAME_SIZE 24
+#define GSS_ROUTE_NONE -1 // No vertex has this ID.
+#define GSS_ROUTE_SERVER -2 // The server's own ID.
+#define GSS_TOPOLOGY_DEFAULT_TIMEOUT_S 20 // How long a connection may go without receiving anything.
+
+typedef struct
+{
+    uint8_t id; // As written in frame headers.
+    char name[GSS_TOPOLOGY_NAME_SIZE];
+    int port;
+    cpu_set_t cpus; // CPUs the vertex's receive and transmit threads may run on.
+    int num_cpus; // 0 leaves them unpinned.
+    int priority; // SCHED_FIFO priority (1-99) of the vertex's threads; 0 leaves them SCHED_OTHER.
+    int busy_poll_us; // SO_BUSY_POLL of the vertex's connections; 0 leaves it off.
+    uint8_t netstat_bit; // 0x80 >> id, or 0 if the ID does not fit in the netstat byte.
+} gss_vertex_config_t;
+
+typedef struct
+{
+    gss_vertex_config_t vertices[GSS_MAX_VERTICES];
+    int num_vertices;
+    int client; // Index of the GUI client vertex, which accepts several connections and whose frames are broadcast.
+    uint8_t server_id;
+    int8_t route[256]; // Vertex ID to vertex index, GSS_ROUTE_SERVER, or GSS_ROUTE_NONE.
+    int max_clients; // 0 leaves the command line default.
+    int txq_capacity; // 0 leaves the command line default.
+    int socket_buffer_kb; // SO_RCVBUF and SO_SNDBUF of every connection; 0 leaves the kernel default.
+    int timeout_s;
+} gss_topology_t;
+
+/**
+ * @brief Fills in the original topology: the client and the four radios, on ports 54200 through 54240.
+ *
+ * @param topology
+ */
+void gss_topology_default(gss_topology_t *topology);
+
+/**
+ * @brief Loads a topology from a configuration file (see gss.conf for the format).
+ *
+ * Anything the file leaves out keeps its default, except that the first vertex line replaces the default vertices.
+ *
+ * @param path
+ * @param topology
+ * @return int 1 on success, -1 if the file could not be read or is invalid (the reason is printed).
+ */
+int gss_topology_load(const char *path, gss_topology_t *topology);
+
+/**
+ * @brief Maps a vertex ID to its index.
+ *
+ * @param topology
+ * @param id
+ * @return int Vertex index, GSS_ROUTE_SERVER, or GSS_ROUTE_NONE.
+ */
+static inline int gss_topology_route(const gss_topology_t *topology, uint8_t id)
+{
+    return topology->route[id];
+}
+
+/**
+ * @brief Applies the socket buffer sizes, and the vertex's busy polling, to a newly accepted connection.
+ *
+ * @param socket
+ * @param topology
+ * @param vertex Index of the vertex the connection belongs to.
+ * @return int 1 on success, -1 if any option could not be set.
+ */
+int gss_topology_configure_socket(int socket, const gss_topology_t *topology, int vertex);
+
+/**
+ * @brief Starts a thread for a vertex on the vertex's CPUs, at its priority. If the priority is not permitted (SCHED_FIFO needs CAP_SYS_NICE or an RLIMIT_RTPRIO), warns and starts the thread at normal priority instead.
+ *
+ * @param thread
+ * @param vertex
+ * @param routine
+ * @param arg
+ * @return int 1 on success, -1 if the thread could not be started.
+ */
+int gss_topology_create_thread(pthread_t *thread, const gss_vertex_config_t *vertex, void *(*routine)(void *), void *arg);
+
+/**
+ * @brief Parses a CPU list ("2", "2-3,6") or a NUMA node ("node1", all of its CPUs).
+ *
+ * @param text
+ * @param cpus
+ * @return int The number of CPUs, or -1 if malformed or the node does not exist.
+ */
+int gss_topology_parse_cpus(const char *text, cpu_set_t *cpus);
+
+#endif // GSS_TOPOLOGY_HPP
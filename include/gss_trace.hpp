@@ -0,0 +1,276 @@
+/**
+ * @file gss_trace.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Leveled debug logger with compile-time elimination and deferred formatting.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Drop-in replacements for dbprintlf(...) at four levels: dberrorlf, dbwarnlf, dbinfolf and dbdebuglf. Levels above GSS_TRACE_COMPILE_LEVEL compile to nothing; the rest are checked against a runtime level with one relaxed load.
+ *
+ * An enabled message does not format anything or make any syscall on the calling thread. Its arguments are copied (strings by value) into a per-thread ring along with a pointer to its call site, and a flusher thread formats whole batches and writes them to stderr with a single write(2). If a thread's ring fills up faster than it is flushed, messages are dropped and counted rather than blocking the thread.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_TRACE_HPP
+#define GSS_TRACE_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <tuple>
+
+#define GSS_TRACE_ERROR 0
+#define GSS_TRACE_WARN 1
+#define GSS_TRACE_INFO 2
+#define GSS_TRACE_DEBUG 3
+
+#ifndef GSS_TRACE_COMPILE_LEVEL
+#define GSS_TRACE_COMPILE_LEVEL GSS_TRACE_DEBUG // Messages above this level are not compiled in at all.
+#endif
+
+#define GSS_TRACE_DEFAULT_LEVEL GSS_TRACE_INFO // Runtime level until gss_trace_set_level(...) is called.
+#define GSS_TRACE_RING_SIZE 65536 // Bytes of pending messages per thread.
+#define GSS_TRACE_MAX_STRING 255 // Longer string arguments are truncated.
+#define GSS_TRACE_FLUSH_MS 50 // How often the flusher drains the rings.
+
+typedef int (*gss_trace_format_fn)(char *out, size_t out_size, const char *format, const unsigned char *args);
+
+/**
+ * @brief Everything about a message known at compile time. One static instance per call site.
+ *
+ */
+typedef struct
+{
+    int level;
+    const char *file;
+    int line;
+    const char *func;
+    const char *format;
+} gss_trace_site_t;
+
+/**
+ * @brief Prefix of every message in a ring, followed by its captured arguments.
+ *
+ */
+typedef struct
+{
+    const gss_trace_site_t *site; // NULL marks padding up to the end of the ring.
+    gss_trace_format_fn formatter;
+    uint32_t size; // Including this header, rounded up to 8 bytes.
+} gss_trace_record_t;
+
+extern std::atomic<int> gss_trace_level;
+
+/**
+ * @brief Checks whether messages at a level are currently logged.
+ *
+ * @param level GSS_TRACE_*
+ * @return true
+ * @return false
+ */
+static inline bool gss_trace_enabled(int level)
+{
+    return level <= GSS_TRACE_COMPILE_LEVEL && level <= gss_trace_level.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sets the runtime level. Messages above it are skipped after a single load.
+ *
+ * @param level GSS_TRACE_* (clamped to GSS_TRACE_COMPILE_LEVEL).
+ */
+void gss_trace_set_level(int level);
+
+/**
+ * @brief Starts the flusher thread and flushes any remaining messages at exit. Messages logged before this are held in their rings until then.
+ *
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_trace_start();
+
+/**
+ * @brief Formats and writes every pending message now. Safe to call from any thread.
+ *
+ */
+void gss_trace_flush();
+
+/**
+ * @brief Reserves room for a record in the calling thread's ring.
+ *
+ * @param size Rounded-up record size.
+ * @return unsigned char* Where to write the record, or NULL if the ring is full (the message is counted as dropped).
+ */
+unsigned char *gss_trace_reserve(size_t size);
+
+/**
+ * @brief Publishes the record most recently reserved by this thread.
+ *
+ * @param size The size passed to gss_trace_reserve(...).
+ */
+void gss_trace_commit(size_t size);
+
+/**
+ * @brief How each argument type is captured into, and read back out of, a record. Anything trivially copyable is captured by value.
+ *
+ */
+template <typename T>
+struct gss_trace_arg
+{
+    static size_t size(T) { return sizeof(T); }
+
+    static unsigned char *store(unsigned char *p, T value)
+    {
+        memcpy(p, &value, sizeof(T));
+        return p + sizeof(T);
+    }
+
+    static T load(const unsigned char *&p)
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+};
+
+/**
+ * @brief Strings are copied, since the caller's buffer may be gone by the time the message is formatted.
+ *
+ */
+template <>
+struct gss_trace_arg<const char *>
+{
+    static size_t length(const char *value)
+    {
+        if (value == NULL)
+        {
+            return 6;
+        }
+        size_t n = 0;
+        while (n < GSS_TRACE_MAX_STRING && value[n] != '\0')
+        {
+            n++;
+        }
+        return n;
+    }
+
+    static size_t size(const char *value) { return 1 + length(value) + 1; }
+
+    static unsigned char *store(unsigned char *p, const char *value)
+    {
+        size_t n = length(value);
+        *p = (unsigned char)n;
+        memcpy(p + 1, value == NULL ? "(null)" : value, n);
+        p[1 + n] = '\0';
+        return p + 1 + n + 1;
+    }
+
+    static const char *load(const unsigned char *&p)
+    {
+        const char *value = (const char *)p + 1;
+        p += 1 + *p + 1;
+        return value;
+    }
+};
+
+template <>
+struct gss_trace_arg<char *> : gss_trace_arg<const char *>
+{
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+/**
+ * @brief Reads back the arguments captured for Args... and formats the message. Runs on the flusher thread.
+ *
+ */
+template <typename... Args>
+static int gss_trace_format(char *out, size_t out_size, const char *format, const unsigned char *args)
+{
+    // Braced initialization evaluates left to right, so the arguments are read back in the order they were stored.
+    std::tuple<decltype(gss_trace_arg<Args>::load(args))...> values{gss_trace_arg<Args>::load(args)...};
+    return std::apply([&](auto... value) { return snprintf(out, out_size, format, value...); }, values);
+}
+#pragma GCC diagnostic pop
+
+/**
+ * @brief Captures a message's arguments into the calling thread's ring.
+ *
+ */
+template <typename... Args>
+static inline void gss_trace_write(const gss_trace_site_t *site, Args... args)
+{
+    size_t size = sizeof(gss_trace_record_t);
+    ((size += gss_trace_arg<Args>::size(args)), ...);
+    size = (size + 7) & ~(size_t)7;
+
+    unsigned char *p = gss_trace_reserve(size);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    gss_trace_record_t *record = (gss_trace_record_t *)p;
+    record->site = site;
+    record->formatter = gss_trace_format<Args...>;
+    record->size = size;
+
+    p += sizeof(gss_trace_record_t);
+    ((p = gss_trace_arg<Args>::store(p, args)), ...);
+
+    gss_trace_commit(size);
+}
+
+/**
+ * @brief Logs a message at a level, if enabled. gss_trace_disabled(...) keeps -Wformat checking the call.
+ *
+ */
+#define gss_trace(level, format, ...)                                                                    \
+    do                                                                                                   \
+    {                                                                                                    \
+        if (gss_trace_enabled(level))                                                                    \
+        {                                                                                                \
+            static const gss_trace_site_t gss_trace_site_ = {level, __FILE__, __LINE__, __func__, format}; \
+            gss_trace_write(&gss_trace_site_, ##__VA_ARGS__);                                            \
+        }                                                                                                \
+        gss_trace_disabled(format, ##__VA_ARGS__);                                                       \
+    } while (0)
+
+/**
+ * @brief What a compiled-out level expands to: nothing at runtime, but the call is still type-checked and its arguments still count as used.
+ *
+ */
+#define gss_trace_disabled(format, ...)            \
+    do                                             \
+    {                                              \
+        if (false)                                 \
+        {                                          \
+            fprintf(stderr, format, ##__VA_ARGS__); \
+        }                                          \
+    } while (0)
+
+#define dberrorlf(format, ...) gss_trace(GSS_TRACE_ERROR, format, ##__VA_ARGS__)
+
+#if GSS_TRACE_COMPILE_LEVEL >= GSS_TRACE_WARN
+#define dbwarnlf(format, ...) gss_trace(GSS_TRACE_WARN, format, ##__VA_ARGS__)
+#else
+#define dbwarnlf(format, ...) gss_trace_disabled(format, ##__VA_ARGS__)
+#endif
+
+#if GSS_TRACE_COMPILE_LEVEL >= GSS_TRACE_INFO
+#define dbinfolf(format, ...) gss_trace(GSS_TRACE_INFO, format, ##__VA_ARGS__)
+#else
+#define dbinfolf(format, ...) gss_trace_disabled(format, ##__VA_ARGS__)
+#endif
+
+#if GSS_TRACE_COMPILE_LEVEL >= GSS_TRACE_DEBUG
+#define dbdebuglf(format, ...) gss_trace(GSS_TRACE_DEBUG, format, ##__VA_ARGS__)
+#else
+#define dbdebuglf(format, ...) gss_trace_disabled(format, ##__VA_ARGS__)
+#endif
+
+#endif // GSS_TRACE_HPP
@@ -0,0 +1,333 @@
+/**
+ * @file gss_txq.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Bounded lock-free per-destination transmit queues, each drained by a single writer thread.
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Any RX thread (or reactor) may push serialized frames into any vertex's queue without ever touching that vertex's socket. Only the queue's writer thread writes to the socket, so a backed-up destination no longer stalls the origin's receive loop and two threads can no longer interleave writes on one socket.
+ *
+ * The ring (gss_ring.hpp) is multi-consumer safe; the second consumer is only ever a producer evicting the oldest entry under GSS_TXQ_DROP_OLDEST. Queued frames are gss_pool buffers, owned by the queue until the writer (or an eviction) hands them back to the pool.
+ *
+ * Each queue is split into priority classes (GSS_TXQ_CLASS), one ring each, chosen from the frame's NetType and destination, so a backlog of bulk downlink data does not hold up polls, acknowledgements and commands queued behind it. The writer serves the classes in strict priority order by default, or in weighted round robin (so many frames of each class per round) to guarantee bulk data a share. Only the queue is reordered, so each connection's socket is limited to GSS_TXQ_NOTSENT_LOWAT unsent bytes (gss_txq_configure_socket(...)); otherwise a slow client's send buffer fills with megabytes of bulk data which an urgent frame must still wait behind.
+ *
+ * Each writer also measures its own wake-up latency: how long after a push finds it asleep it actually runs. This is the scheduling jitter the forwarding path suffers, and what CPU pinning and real-time priority (see gss_topology.hpp) are meant to bound.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GSS_TXQ_HPP
+#define GSS_TXQ_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <atomic>
+#include "network.hpp"
+#include "gss_ring.hpp"
+#include "gss_pool.hpp"
+#include "gss_metrics.hpp"
+#include "gss_spool.hpp"
+#include "gss_latency.hpp"
+
+#define GSS_TXQ_DEFAULT_CAPACITY 256 // Rounded up to a power of two.
+#define GSS_TXQ_BACKPRESSURE_TIMEOUT_MS 1000 // How long a producer waits for room before dropping the frame anyway.
+#define GSS_TXQ_NOTSENT_LOWAT 16384 // Unsent bytes the kernel may hold for a connection; frames beyond that wait in the queue, where their class still counts.
+
+/**
+ * @brief What to do with a frame when the destination's queue is full.
+ *
+ */
+enum GSS_TXQ_POLICY
+{
+    GSS_TXQ_DROP_OLDEST = 0, // Evict the oldest queued frame to make room.
+    GSS_TXQ_DROP_NEWEST, // Discard the frame being pushed.
+    GSS_TXQ_BACKPRESSURE // Block the producer until there is room (up to GSS_TXQ_BACKPRESSURE_TIMEOUT_MS).
+};
+
+/**
+ * @brief Priority classes within a transmit queue, most urgent first.
+ *
+ */
+enum GSS_TXQ_CLASS
+{
+    GSS_TXQ_CONTROL = 0, // POLL, ACK and NACK, and everything the server itself sends (poll responses, netstat pushes, heartbeats).
+    GSS_TXQ_COMMAND, // Configuration and commands, and data uplinked to a radio.
+    GSS_TXQ_BULK, // Data downlinked to the GUI clients.
+    GSS_TXQ_NUM_CLASSES
+};
+
+static_assert(GSS_TXQ_NUM_CLASSES == GSS_METRICS_NUM_CLASSES, "The metrics keep a latency histogram per class.");
+
+/**
+ * @brief A snapshot of a queue's counters.
+ *
+ */
+typedef struct
+{
+    size_t depth;
+    size_t high_water;
+    uint64_t enqueued;
+    uint64_t dropped_oldest;
+    uint64_t dropped_newest;
+    uint64_t backpressured;
+    uint64_t sent;
+    uint64_t send_failed;
+    uint64_t spliced; // Frames which bypassed the queue (gss_route_splice(...)).
+    uint64_t spliced_bytes;
+    size_t class_depth[GSS_TXQ_NUM_CLASSES];
+    uint64_t class_sent[GSS_TXQ_NUM_CLASSES]; // Frames sent which the router had stamped (gss_pool_stamp(...)).
+    uint64_t class_latency_ns[GSS_TXQ_NUM_CLASSES]; // Summed over class_sent, from the router first seeing each frame to it being sent.
+    uint64_t wakeups; // Times a push woke the sleeping writer.
+    uint64_t wakeup_ns; // Summed over wakeups, from the push to the writer running.
+    uint64_t wakeup_max_ns;
+    uint64_t wakeup_buckets[GSS_METRICS_NUM_BUCKETS]; // See gss_metrics_bucket(...).
+} gss_txq_stats_t;
+
+typedef struct
+{
+    gss_ring_t rings[GSS_TXQ_NUM_CLASSES];
+    alignas(64) sem_t items; // Counts queued frames so the writer can sleep while the queue is empty.
+    gss_pool_t *pool;
+
+    GSS_TXQ_POLICY policy;
+    std::atomic<bool> active;
+
+    // Classification and scheduling; set before starting the writer.
+    uint8_t server_id; // Frames from the server are GSS_TXQ_CONTROL.
+    bool to_client; // The destination is a GUI client, so data is bulk downlink rather than an uplink command.
+    int weights[GSS_TXQ_NUM_CLASSES]; // Frames of each class per round robin round; all 0 (the default) for strict priority.
+    int round_class; // Writer only: the class being served this round, and how many more frames it may send.
+    int round_credit;
+
+    // The destination this queue drains into.
+    int t_index;
+    NetDataServer *network_data;
+    const std::atomic<uint32_t> *connected; // Bit t_index is set while the destination is connected (see gss_set_connected(...)).
+    pthread_mutex_t *tx_lock; // Guards network_data->socket and the three fields below; only ever held briefly, never across a send.
+    int socket_in_use; // The socket a send (the writer's, or a splice) is in progress on, -1 if none.
+    bool close_in_use; // socket_in_use was closed during the send, and is to be closed once the send returns.
+    int failed_socket; // A socket a send failed part way through on, and which was shut down, so nothing more is sent on it; -1 if none. Cleared when the socket is replaced or closed.
+    gss_metrics_t *metrics; // NULL (the default) disables; set before starting the writer.
+    int vertex; // Index of the destination's vertex, for metrics; set with metrics.
+    gss_spool_t *spool; // Frames for the destination while it was offline, sent before the ring once it reconnects. NULL (the default) disables.
+    bool spool_unsent; // Also spool frames still queued when the connection drops. Off where the spool is shared by several connections (the GUI clients), since the others may already have sent them.
+    gss_latency_t *latency; // Completes the samples of sampled frames (see gss_latency.hpp). NULL (the default) disables; set before starting the writer.
+    gss_latency_pending_t latency_pending; // Writer only.
+
+    std::atomic<size_t> high_water;
+    std::atomic<uint64_t> enqueued;
+    std::atomic<uint64_t> dropped_oldest;
+    std::atomic<uint64_t> dropped_newest;
+    std::atomic<uint64_t> backpressured;
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> send_failed;
+    std::atomic<uint64_t> spliced;
+    std::atomic<uint64_t> spliced_bytes;
+    std::atomic<uint64_t> class_sent[GSS_TXQ_NUM_CLASSES];
+    std::atomic<uint64_t> class_latency_ns[GSS_TXQ_NUM_CLASSES];
+
+    alignas(64) std::atomic<bool> sleeping; // The writer is waiting on items.
+    std::atomic<uint64_t> posted_ns; // When a push first found the writer asleep, 0 if none has since it went to sleep.
+    std::atomic<uint64_t> wakeups;
+    std::atomic<uint64_t> wakeup_ns;
+    std::atomic<uint64_t> wakeup_max_ns;
+    std::atomic<uint64_t> wakeup_buckets[GSS_METRICS_NUM_BUCKETS];
+} gss_txq_t;
+
+/**
+ * @brief Allocates a transmit queue for one destination.
+ *
+ * @param capacity Maximum number of queued frames in each class, rounded up to a power of two.
+ * @param policy Overflow policy.
+ * @param t_index Index of the destination connection.
+ * @param network_data The destination's connection.
+ * @param connected Which connections are up, one bit per t_index.
+ * @param tx_lock Guards the destination's socket (see gss_txq_claim_socket(...)).
+ * @param pool Where sent and dropped frames are returned.
+ * @return gss_txq_t* The queue, or NULL on failure.
+ */
+gss_txq_t *gss_txq_create(size_t capacity, GSS_TXQ_POLICY policy, int t_index, NetDataServer *network_data, const std::atomic<uint32_t> *connected, pthread_mutex_t *tx_lock, gss_pool_t *pool);
+
+/**
+ * @brief Frees a queue and any frames still in it. The writer must have been joined.
+ *
+ * @param txq
+ */
+void gss_txq_destroy(gss_txq_t *txq);
+
+/**
+ * @brief Chooses a frame's priority class from its type and origin, and the queue's destination.
+ *
+ * @param txq
+ * @param frame A serialized frame (at least its header).
+ * @return GSS_TXQ_CLASS
+ */
+GSS_TXQ_CLASS gss_txq_classify(const gss_txq_t *txq, const unsigned char *frame);
+
+/**
+ * @brief Frames waiting in every class of the queue.
+ *
+ * @param txq
+ * @return size_t
+ */
+static inline size_t gss_txq_depth(gss_txq_t *txq)
+{
+    size_t depth = 0;
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        depth += gss_ring_depth(&txq->rings[c]);
+    }
+    return depth;
+}
+
+/**
+ * @brief Publishes a newly accepted, already configured socket as the destination's, for its writer and anyone closing it.
+ *
+ * @param txq
+ * @param socket
+ */
+void gss_txq_set_socket(gss_txq_t *txq, int socket);
+
+/**
+ * @brief Marks the destination's socket as in use by a send, so that closing it meanwhile (gss_txq_close_socket(...)) only shuts it down, which wakes the send, and leaves the close to gss_txq_release_socket(...). Call with tx_lock held.
+ *
+ * @param txq
+ * @return int The socket, or -1 if there is none, a send is already in progress on it, or one failed on it (see gss_txq_fail_socket(...)).
+ */
+int gss_txq_claim_socket(gss_txq_t *txq);
+
+/**
+ * @brief Shuts down the socket claimed for a send which failed, and keeps anything more from being sent on it. The send may have been partial, so the peer would otherwise see the next frame begin in the middle of this one; the receiving side notices the shutdown and closes the connection.
+ *
+ * @param txq
+ */
+void gss_txq_fail_socket(gss_txq_t *txq);
+
+/**
+ * @brief Ends a send begun with gss_txq_claim_socket(...), closing the socket if it was closed during the send.
+ *
+ * @param txq
+ */
+void gss_txq_release_socket(gss_txq_t *txq);
+
+/**
+ * @brief Closes the destination's socket without waiting for a send in progress on it (see gss_txq_claim_socket(...)).
+ *
+ * @param txq
+ */
+void gss_txq_close_socket(gss_txq_t *txq);
+
+/**
+ * @brief Shuts down the destination's socket, if it has one, without waiting for a send in progress on it. A blocked send is woken with an error.
+ *
+ * @param txq
+ * @param how SHUT_RD, SHUT_WR or SHUT_RDWR.
+ */
+void gss_txq_shutdown_socket(gss_txq_t *txq, int how);
+
+/**
+ * @brief Whether nothing is queued for the destination, nor being sent to it.
+ *
+ * @param txq
+ * @return bool
+ */
+bool gss_txq_idle(gss_txq_t *txq);
+
+/**
+ * @brief Limits a newly accepted connection's unsent bytes (TCP_NOTSENT_LOWAT) so that backlogs stay in its queue, and bounds how long a send to a backed-up peer may block its writer (SO_SNDTIMEO).
+ *
+ * @param socket
+ * @param send_timeout_s Seconds a single send may block before it fails.
+ * @return int 1 on success, -1 on failure.
+ */
+int gss_txq_configure_socket(int socket, int send_timeout_s);
+
+/**
+ * @brief Hands a serialized frame to the queue. Safe to call from any number of threads.
+ *
+ * The frame joins the back of its class (gss_txq_classify(...)), and the overflow policy applies to that class alone. The queue takes ownership of the frame either way; if it is dropped it goes straight back to the pool.
+ *
+ * @param txq
+ * @param frame A buffer from txq->pool.
+ * @param frame_size
+ * @return int 1 if queued, 0 if the frame was dropped due to the overflow policy.
+ */
+int gss_txq_push(gss_txq_t *txq, unsigned char *frame, size_t frame_size);
+
+/**
+ * @brief Like gss_txq_push(...), but never waits for room: under GSS_TXQ_BACKPRESSURE a full class drops the frame at once, as under GSS_TXQ_DROP_NEWEST. For callers holding a lock other threads need.
+ *
+ * @param txq
+ * @param frame A buffer from txq->pool.
+ * @param frame_size
+ * @return int 1 if queued, 0 if the frame was dropped.
+ */
+int gss_txq_try_push(gss_txq_t *txq, unsigned char *frame, size_t frame_size);
+
+/**
+ * @brief Takes a snapshot of the queue's counters.
+ *
+ * @param txq
+ * @param stats
+ */
+void gss_txq_get_stats(gss_txq_t *txq, gss_txq_stats_t *stats);
+
+/**
+ * @brief Estimates a percentile of a queue's writer wake-up latency from its buckets.
+ *
+ * @param stats
+ * @param fraction e.g. 0.99.
+ * @return uint64_t The upper bound of the bucket holding the percentile, in microseconds; 0 if the writer was never woken.
+ */
+static inline uint64_t gss_txq_wakeup_percentile_us(const gss_txq_stats_t *stats, double fraction)
+{
+    uint64_t cumulative = 0;
+    for (int b = 0; b < GSS_METRICS_NUM_BUCKETS && stats->wakeups > 0; b++)
+    {
+        cumulative += stats->wakeup_buckets[b];
+        if (cumulative >= fraction * stats->wakeups)
+        {
+            return b < GSS_METRICS_NUM_BUCKETS - 1 ? 1ULL << b : stats->wakeup_max_ns / 1000;
+        }
+    }
+    return stats->wakeups > 0 ? stats->wakeup_max_ns / 1000 : 0;
+}
+
+/**
+ * @brief Parses an overflow policy name (oldest, newest, block).
+ *
+ * @param name
+ * @param policy
+ * @return int 1 on success, -1 if the name is not recognized.
+ */
+int gss_txq_parse_policy(const char *name, GSS_TXQ_POLICY *policy);
+
+/**
+ * @brief Parses a scheduling discipline: strict, or control,command,bulk weights (all positive) for weighted round robin.
+ *
+ * @param text
+ * @param weights Set to all 0 for strict.
+ * @return int 1 on success, -1 on error.
+ */
+int gss_txq_parse_weights(const char *text, int weights[GSS_TXQ_NUM_CLASSES]);
+
+/**
+ * @brief Names a priority class, for stats and metrics.
+ *
+ * @param tx_class
+ * @return const char*
+ */
+const char *gss_txq_class_name(int tx_class);
+
+/**
+ * @brief Writer thread which drains one queue into its destination's socket.
+ *
+ * Runs until txq->active is cleared.
+ *
+ * @return void* NULL
+ */
+void *gss_txq_writer_thread(void *);
+
+#endif // GSS_TXQ_HPP
@@ -10,110 +10,773 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <ifaddrs.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
 #include "network.hpp"
 #include "gss.hpp"
+#include "gss_frame.hpp"
+#include "gss_txq.hpp"
+#include "gss_pool.hpp"
+#include "gss_log.hpp"
+#include "gss_metrics.hpp"
+#include "gss_spool.hpp"
+#include "gss_dedup.hpp"
+#include "gss_compress.hpp"
+#include "gss_latency.hpp"
+#include "gss_reload.hpp"
+#include "gss_trace.hpp"
 #include "meb_debug.hpp"
 
-void *gss_network_rx_thread(void *global_vp)
+/**
+ * @brief Checks whether a GUI client connection may send frames to the radios under global->uplink_policy.
+ *
+ */
+static bool gss_uplink_allowed(global_data_t *global, int t_index)
 {
-    global_data_t *global = (global_data_t *)global_vp;
+    if (gss_vertex(global, t_index) != global->topology.client || global->uplink_policy == GSS_UPLINK_ANY)
+    {
+        return true;
+    }
+
+    // Uplink commands are rare, so taking the lock here costs nothing worth avoiding.
+    pthread_mutex_lock(&global->netstat_lock);
+    uint32_t clients = global->connected.load(std::memory_order_relaxed) & global->vertex_connections[global->topology.client];
+    bool allowed = true;
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        if (i != t_index && (clients & (1u << i)) &&
+            (global->connected_ns[i] < global->connected_ns[t_index] || (global->connected_ns[i] == global->connected_ns[t_index] && i < t_index)))
+        {
+            allowed = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&global->netstat_lock);
 
-    LISTEN_FOR listen_for = LF_ERROR;
-    int t_index = -1;
-    pthread_t thread_id = pthread_self();
+    return allowed;
+}
 
-    for (int i = 0; i < NUM_PORTS; i++)
+/**
+ * @brief Which of its vertex's connections a connection is: 0, or for the GUI client's additional connections, 1 and up.
+ *
+ */
+static inline int gss_connection_number(global_data_t *global, int t_index)
+{
+    return t_index < global->topology.num_vertices ? 0 : t_index - global->topology.num_vertices + 1;
+}
+
+void gss_set_connected(global_data_t *global, int t_index, bool connected)
+{
+    if (connected)
     {
-        if (thread_id == global->pid[i])
+        global->last_rx_ns[t_index].store(gss_health_now_ns(), std::memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&global->netstat_lock);
+
+    uint32_t previous_connections = global->connected.load(std::memory_order_relaxed);
+    uint32_t connections = connected ? (previous_connections | (1u << t_index)) : (previous_connections & ~(1u << t_index));
+    if (connections != previous_connections)
+    {
+        // Under the lock, so the capture has connection changes in the order they happened.
+        gss_capture_event(global->capture, connected ? GSS_CAPTURE_CONNECT : GSS_CAPTURE_DISCONNECT, (uint8_t)gss_vertex_id(global, t_index), gss_connection_number(global, t_index));
+
+        // Every connection starts out uncompressed until it asks.
+        gss_compress_reset(global->compress, t_index);
+    }
+    if (connected && !(previous_connections & (1u << t_index)))
+    {
+        global->connected_ns[t_index] = gss_health_now_ns();
+        gss_metrics_reconnected(global->metrics, gss_vertex(global, t_index));
+
+        // Wake the writer now rather than on its next tick, so it flushes whatever was spooled.
+        gss_spool_t *spool = global->txq[t_index]->spool;
+        if (spool != NULL && gss_spool_depth(spool) > 0)
         {
-            listen_for = (LISTEN_FOR)i;
-            t_index = i;
+            sem_post(&global->txq[t_index]->items);
         }
     }
+    global->connected.store(connections, std::memory_order_release);
+
+    // A vertex is connected while any of its connections is.
+    int vertex = gss_vertex(global, t_index);
+    uint32_t vertex_connections = global->vertex_connections[vertex];
+    bool vertex_connected = (connections & vertex_connections) != 0;
 
-    char t_tag[32];
+    uint8_t netstat_bit = global->topology.vertices[vertex].netstat_bit;
+    uint8_t previous = gss_netstat(global);
+    uint8_t netstat = vertex_connected ? (previous | netstat_bit) : (previous & ~netstat_bit);
+    global->netstat.store(netstat, std::memory_order_release);
 
-    switch (listen_for)
+    if (vertex_connected != ((previous_connections & vertex_connections) != 0))
     {
-    case LF_CLIENT:
+        dbinfolf("NETSTAT 0x%02x (%s, ID:%d %s).", netstat, global->topology.vertices[vertex].name, global->topology.vertices[vertex].id, vertex_connected ? "connected" : "disconnected");
+
+        // Same frame as a poll response, so the client needs nothing new to handle it.
+        int client = global->topology.client;
+        if (global->netstat_push && netstat != previous && (connections & global->vertex_connections[client]))
+        {
+            unsigned char *netstat_frame = gss_pool_get(global->pool, GSS_FRAME_OVERHEAD);
+            ssize_t netstat_frame_size = -1;
+            if (netstat_frame != NULL)
+            {
+                netstat_frame_size = gss_frame_build(netstat_frame, NetType::POLL, (NetVertex)global->topology.server_id, (NetVertex)global->topology.vertices[client].id, netstat, NULL, 0);
+            }
+
+            if (netstat_frame_size < 0)
+            {
+                gss_pool_put(global->pool, netstat_frame);
+                dbwarnlf(RED_FG "NetStat notification to the clients failed.");
+            }
+            else
+            {
+                // Never waits on a client's queue, since netstat_lock holds up every connection change (and the uplink policy) meanwhile.
+                gss_broadcast_clients(global, netstat_frame, netstat_frame_size, false);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&global->netstat_lock);
+}
+
+int gss_broadcast_clients(global_data_t *global, unsigned char *frame, size_t frame_size, bool may_wait)
+{
+    uint32_t clients = global->connected.load(std::memory_order_acquire) & global->vertex_connections[global->topology.client];
+    int num_clients = __builtin_popcount(clients);
+
+    if (num_clients == 0)
     {
-        strcpy(t_tag, "[RXT_GUICLIENT] ");
-        dbprintlf("%sThread (id:%lu) listening for GUI Client.", t_tag, (unsigned long)thread_id);
+        gss_pool_put(global->pool, frame);
+        return 0;
+    }
 
-        break;
+    // Clients which asked for compression share one compressed copy, unless the frame is not worth compressing.
+    uint32_t compressing = clients & gss_compress_links(global->compress);
+    unsigned char *compressed = NULL;
+    size_t compressed_size = 0;
+    if (compressing != 0)
+    {
+        compressed = gss_compress_frame(global->compress, global->pool, frame, frame_size, compressing, &compressed_size);
     }
-    case LF_ROOF_UHF:
+    if (compressed == NULL)
     {
-        strcpy(t_tag, "[RXT_ROOFUHF] ");
-        dbprintlf("%sThread (id:%lu) listening for Roof UHF.", t_tag, (unsigned long)thread_id);
+        compressing = 0;
+    }
 
-        break;
+    // Every queue holds its own reference before any writer can send the frame and put one back.
+    int num_raw = __builtin_popcount(clients & ~compressing);
+    if (num_raw == 0)
+    {
+        gss_pool_put(global->pool, frame);
+    }
+    else
+    {
+        gss_pool_share(frame, num_raw - 1);
     }
-    case LF_ROOF_XBAND:
+    if (compressed != NULL)
     {
-        strcpy(t_tag, "[RXT_ROOFXBAND] ");
-        dbprintlf("%sThread (id:%lu) listening for Roof X-Band.", t_tag, (unsigned long)thread_id);
+        gss_pool_share(compressed, __builtin_popcount(compressing) - 1);
+    }
 
-        break;
+    int queued = 0;
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        if (!(clients & (1u << i)))
+        {
+            continue;
+        }
+
+        unsigned char *copy = (compressing & (1u << i)) ? compressed : frame;
+        size_t copy_size = (compressing & (1u << i)) ? compressed_size : frame_size;
+        bool queued_frame = (may_wait ? gss_txq_push(global->txq[i], copy, copy_size) : gss_txq_try_push(global->txq[i], copy, copy_size)) > 0;
+        if (queued_frame)
+        {
+            queued++;
+        }
     }
-    case LF_HAYSTACK:
+
+    return queued;
+}
+
+int gss_parse_uplink_policy(const char *name, GSS_UPLINK_POLICY *policy)
+{
+    if (strcmp(name, "any") == 0)
+    {
+        *policy = GSS_UPLINK_ANY;
+    }
+    else if (strcmp(name, "first") == 0)
     {
-        strcpy(t_tag, "[RXT_HAYSTACK] ");
-        dbprintlf("%sThread (id:%lu) listening for Haystack.", t_tag, (unsigned long)thread_id);
+        *policy = GSS_UPLINK_FIRST;
+    }
+    else
+    {
+        return -1;
+    }
 
-        break;
+    return 1;
+}
+
+/**
+ * @brief Says why a frame for a vertex is being dropped, and counts it against the destination if it was not connected.
+ *
+ */
+static void gss_route_refuse(global_data_t *global, int t_index, const gss_frame_header_t *header, int destination, bool not_ready, const char *t_tag)
+{
+    if (not_ready)
+    {
+        dbwarnlf(RED_FG "%sCannot pass frame from ID:%d to ID:%d since the connection is not ready.", t_tag, (int)header->origin, (int)header->destination);
+        gss_metrics_failed(global->metrics, destination, GSS_METRICS_NOT_READY);
     }
-    case LF_TRACK:
+    else
     {
-        strcpy(t_tag, "[RXT_TRACK] ");
-        dbprintlf("%sThread (id:%lu) listening for Track.", t_tag, (unsigned long)thread_id);
+        dbwarnlf(RED_FG "%sDropping frame from ID:%d to ID:%d since another client holds the uplink.", t_tag, t_index, (int)header->destination);
+    }
+}
 
-        break;
+bool gss_route_drops(global_data_t *global, int t_index, const gss_frame_header_t *header)
+{
+    if (global->log != NULL || global->capture != NULL)
+    {
+        return false;
     }
-    case LF_ERROR:
-    default:
+
+    int destination = gss_topology_route(&global->topology, header->destination);
+    if (destination == GSS_ROUTE_NONE)
     {
-        dbprintlf(FATAL "[RXT_ERROR] Thread (id:%lu) not listening for any valid sender (%d).", (unsigned long)thread_id, t_index);
-        return NULL;
+        return true;
     }
+    else if (destination == GSS_ROUTE_SERVER)
+    {
+        return false;
     }
 
-    // Makes my life easier.
-    NetDataServer *network_data = global->network_data[t_index];
+    // Connectivity first: checking the uplink may take a lock.
+    if (!gss_vertex_connected(global, destination))
+    {
+        return global->spool[destination] == NULL;
+    }
+    return destination != global->topology.client && !gss_uplink_allowed(global, t_index);
+}
+
+void gss_route_dropped(global_data_t *global, int t_index, const gss_frame_header_t *header, size_t frame_size, const char *t_tag)
+{
+    if (global->health.heartbeat_ms > 0)
+    {
+        global->last_rx_ns[t_index].store(gss_health_now_ns(), std::memory_order_relaxed);
+    }
+    gss_metrics_received(global->metrics, gss_vertex(global, t_index), frame_size);
+
+    int destination = gss_topology_route(&global->topology, header->destination);
+    if (destination >= 0)
+    {
+        gss_route_refuse(global, t_index, header, destination, !gss_vertex_connected(global, destination), t_tag);
+    }
+}
+
+void gss_route_frame(global_data_t *global, int t_index, unsigned char *frame, size_t frame_size, const char *t_tag)
+{
+    gss_frame_header_t *header = (gss_frame_header_t *)frame;
+
+    // Captured as received, before anything below patches or drops it.
+    gss_capture_frame(global->capture, (uint8_t)gss_vertex_id(global, t_index), gss_connection_number(global, t_index), frame, frame_size);
+
+    // Everything below sees a compressed frame as it was before the client compressed it.
+    if (header->type & GSS_FRAME_TYPE_COMPRESSED)
+    {
+        size_t compressed_size = frame_size;
+        unsigned char *expanded = gss_compress_expand(global->compress, global->pool, t_index, frame, &frame_size);
+        gss_pool_put(global->pool, frame);
+        if (expanded == NULL)
+        {
+            dbwarnlf(RED_FG "%sDiscarding compressed frame from ID:%d which could not be expanded.", t_tag, t_index);
+            gss_report_corrupt(global, t_index, compressed_size, t_tag);
+            return;
+        }
+        frame = expanded;
+        header = (gss_frame_header_t *)frame;
+    }
+
+    if (global->health.heartbeat_ms > 0)
+    {
+        global->last_rx_ns[t_index].store(gss_health_now_ns(), std::memory_order_relaxed);
+    }
+
+    // Forwarding latency is measured from here to the destination's writer.
+    uint64_t stamp_ns = 0;
+    if (global->metrics != NULL)
+    {
+        stamp_ns = gss_health_now_ns();
+        gss_pool_set_stamp(frame, stamp_ns);
+        gss_metrics_received(global->metrics, gss_vertex(global, t_index), frame_size);
+    }
+
+    if (gss_trace_enabled(GSS_TRACE_DEBUG))
+    {
+        dbdebuglf("Received the following NetFrame:");
+        gss_frame_print(frame);
+    }
+
+    // One table load finds the destination, however many vertices there are.
+    int destination = gss_topology_route(&global->topology, header->destination);
+
+    // A retransmission goes no further, not even into the log. Frames without a payload have nothing to tell them apart, so they always pass.
+    gss_dedup_t *dedup = global->dedup[gss_vertex(global, t_index)];
+    if (dedup != NULL && destination >= 0 && header->payload_size > 0 && gss_dedup_check(dedup, frame, stamp_ns ? stamp_ns : gss_health_now_ns()))
+    {
+        dbdebuglf("%sDropping duplicate frame from ID:%d to ID:%d.", t_tag, (int)header->origin, (int)header->destination);
+        gss_pool_put(global->pool, frame);
+        return;
+    }
+
+    if (destination == GSS_ROUTE_SERVER)
+    {
+        // Ride ends here, at the server.
+        // NOTE: Parse and do something. maybe, we'll see.
+        dbdebuglf(CYAN_FG "Received a packet for the server from ID:%d!", t_index);
+        if ((NetType)header->type == NetType::POLL)
+        {
+            dbdebuglf("Received a status polling packet, responding.");
+
+            uint8_t netstat = gss_netstat(global);
+
+            dbdebuglf("%sNETSTAT 0x%02x", t_tag, netstat);
+
+            // Queue the null frame for whomever asked for it.
+            unsigned char *netstat_frame = gss_pool_get(global->pool, GSS_FRAME_OVERHEAD);
+            ssize_t netstat_frame_size = -1;
+            if (netstat_frame != NULL)
+            {
+                netstat_frame_size = gss_frame_build(netstat_frame, NetType::POLL, (NetVertex)global->topology.server_id, gss_vertex_id(global, t_index), netstat, NULL, 0);
+                gss_pool_set_stamp(netstat_frame, stamp_ns);
+            }
+
+            if (netstat_frame_size < 0 || gss_txq_push(global->txq[t_index], netstat_frame, netstat_frame_size) <= 0)
+            {
+                dbwarnlf(RED_FG "%sNetStat frame send to %d failed.", t_tag, t_index);
+            }
+        }
+        else if ((NetType)header->type == NetType::CONFIG)
+        {
+            // Only the GUI client's link is slow enough to be worth compressing.
+            const char *answer = gss_compress_negotiate(global->compress, t_index, gss_vertex(global, t_index) == global->topology.client, frame + sizeof(gss_frame_header_t), header->payload_size);
+            if (answer == NULL)
+            {
+                dbwarnlf(RED_FG "%sConfiguration frame addressed to server was not understood.", t_tag);
+            }
+            else
+            {
+                dbinfolf("%sConnection %d asked for %.*s, answering %s.", t_tag, t_index, header->payload_size, (const char *)frame + sizeof(gss_frame_header_t), answer);
+
+                unsigned char *answer_frame = gss_pool_get(global->pool, GSS_FRAME_OVERHEAD + strlen(answer));
+                ssize_t answer_frame_size = -1;
+                if (answer_frame != NULL)
+                {
+                    answer_frame_size = gss_frame_build(answer_frame, NetType::CONFIG, (NetVertex)global->topology.server_id, gss_vertex_id(global, t_index), gss_netstat(global), (const unsigned char *)answer, strlen(answer));
+                    gss_pool_set_stamp(answer_frame, stamp_ns);
+                }
+
+                if (answer_frame_size < 0 || gss_txq_push(global->txq[t_index], answer_frame, answer_frame_size) <= 0)
+                {
+                    dbwarnlf(RED_FG "%sConfiguration answer to %d failed.", t_tag, t_index);
+                }
+            }
+        }
+        else
+        {
+            dbwarnlf(RED_FG "%sFrame addressed to server but was not a polling status frame.", t_tag);
+        }
+    }
+    else if (destination != GSS_ROUTE_NONE)
+    {
+        bool to_client = destination == global->topology.client;
+
+        if (!to_client && !gss_uplink_allowed(global, t_index))
+        {
+            gss_route_refuse(global, t_index, header, destination, false, t_tag);
+            gss_log_frame(global->log, frame, GSS_LOG_FLAG_NOT_FORWARDED);
+        }
+        else if (gss_vertex_connected(global, destination))
+        {
+            dbdebuglf("%sPassing along frame.", t_tag);
+
+            // The netstat byte is not covered by either CRC, so it can be patched in place.
+            uint8_t netstat = gss_netstat(global);
+            header->netstat = netstat;
+
+            dbdebuglf("%sNETSTAT 0x%02x", t_tag, netstat);
+
+            gss_log_frame(global->log, frame, 0);
+
+            if (global->latency != NULL)
+            {
+                gss_latency_mark(frame, GSS_LATENCY_ROUTED);
+            }
+
+            // Every GUI client gets the same buffer, serialized once.
+            if (to_client)
+            {
+                if (gss_broadcast_clients(global, frame, frame_size, true) <= 0)
+                {
+                    dbwarnlf(RED_FG "%sSend failed (from %d to every client).", t_tag, (int)header->origin);
+                }
+                return;
+            }
+
+            // Hand the frame to the destination's writer, so a slow destination cannot stall this thread.
+            if (gss_txq_push(global->txq[destination], frame, frame_size) <= 0)
+            {
+                dbwarnlf(RED_FG "%sSend failed (from %d to %d).", t_tag, (int)header->origin, (int)header->destination);
+            }
+            return;
+        }
+        else if (global->spool[destination] != NULL)
+        {
+            dbdebuglf("%sSpooling frame from ID:%d for ID:%d until it reconnects.", t_tag, (int)header->origin, (int)header->destination);
+
+            // Stamped now, so the netstat the destination eventually sees says who was connected when the frame arrived.
+            header->netstat = gss_netstat(global);
+            gss_log_frame(global->log, frame, GSS_LOG_FLAG_SPOOLED);
+            if (global->latency != NULL)
+            {
+                gss_latency_mark(frame, GSS_LATENCY_ROUTED);
+            }
+            gss_spool_push(global->spool[destination], frame, frame_size);
+            return;
+        }
+        else
+        {
+            gss_route_refuse(global, t_index, header, destination, true, t_tag);
+            gss_log_frame(global->log, frame, GSS_LOG_FLAG_NOT_FORWARDED);
+        }
+    }
+    // Otherwise no vertex has that ID (or probably nothing was received).
+
+    gss_pool_put(global->pool, frame);
+}
+
+void gss_shutdown(global_data_t *global)
+{
+    // Before stopping, which is what the threads gss_drain(...) follows on from watch for.
+    uint64_t unset = 0;
+    global->drain_deadline_ns.compare_exchange_strong(unset, gss_health_now_ns() + (uint64_t)global->drain_s * 1000000000);
+    if (global->stopping.exchange(true))
+    {
+        return;
+    }
+
+    dbinfolf(CYAN_FG "Shutting down: no longer accepting connections or receiving frames.");
+
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        global->network_data[i]->recv_active = false;
+    }
+
+    // With nothing being received every connection would soon look dead to the heartbeat thread, and heartbeats would keep the queues from emptying.
+    global->health.active = false;
+
+    // Wakes RX threads blocked in a receive, which then see end-of-stream; sending is unaffected.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_txq_shutdown_socket(global->txq[i], SHUT_RD);
+    }
+}
+
+void gss_shutdown_expire(global_data_t *global)
+{
+    dbwarnlf(YELLOW_FG "Still shutting down after %d seconds, closing every connection.", global->drain_s);
+
+    // Not closed yet, since their RX threads may still be using them; gss_drain(...) does that.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_txq_shutdown_socket(global->txq[i], SHUT_RDWR);
+    }
+}
+
+void gss_drain(global_data_t *global)
+{
+    uint64_t deadline_ns = global->drain_deadline_ns.load();
+    size_t queued;
+
+    while (true)
+    {
+        // A frame a writer has already taken off of its queue counts until it has been sent.
+        queued = 0;
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            queued += gss_txq_idle(global->txq[i]) ? 0 : gss_txq_depth(global->txq[i]) + 1;
+        }
+
+        if (queued == 0 || gss_health_now_ns() >= deadline_ns)
+        {
+            break;
+        }
+        usleep(10000);
+    }
+
+    if (queued > 0)
+    {
+        dbwarnlf(YELLOW_FG "%lu frames were still queued after %d seconds, dropping them.", (unsigned long)queued, global->drain_s);
+    }
+    else
+    {
+        dbinfolf(CYAN_FG "Transmit queues drained.");
+    }
+
+    // A send still in progress past the deadline is cut short rather than waited for.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_txq_close_socket(global->txq[i]);
+    }
+}
+
+void gss_report_corrupt(global_data_t *global, int t_index, size_t skipped, const char *t_tag)
+{
+    dbwarnlf(YELLOW_FG "%sDiscarded %lu bytes of invalid data from ID:%d, resynchronizing.", t_tag, (unsigned long)skipped, t_index);
+    gss_metrics_corrupt(global->metrics, gss_vertex(global, t_index), skipped);
+}
+
+ssize_t gss_route_splice(global_data_t *global, int t_index, gss_frame_header_t *header, gss_splice_t *splicer, gss_frame_decoder_t *decoder, const char *t_tag)
+{
+    int destination = gss_topology_route(&global->topology, header->destination);
+    if (destination < 0 || (header->type & GSS_FRAME_TYPE_COMPRESSED))
+    {
+        // A compressed frame must be expanded first.
+        return 0;
+    }
+
+    if (destination == global->topology.client)
+    {
+        // Only a lone client can be spliced to; broadcasts go through the queues.
+        uint32_t clients = global->connected.load(std::memory_order_acquire) & global->vertex_connections[destination];
+        if (__builtin_popcount(clients) != 1 || (clients & gss_compress_links(global->compress)))
+        {
+            // Nor to one which wants its frames compressed.
+            return 0;
+        }
+        destination = __builtin_ctz(clients);
+    }
+    else if (!gss_uplink_allowed(global, t_index))
+    {
+        // gss_route_frame(...) drops it.
+        return 0;
+    }
+
+    // The destination's writer is kept off of its socket while the body is spliced, so the body must already have arrived; a stalled origin would otherwise hold up the destination too.
+    size_t frame_size = GSS_FRAME_OVERHEAD + header->payload_size;
+    int available = 0;
+    if (ioctl(global->network_data[t_index]->socket, FIONREAD, &available) < 0 || (size_t)available < frame_size - sizeof(gss_frame_header_t))
+    {
+        return 0;
+    }
+
+    NetDataServer *destination_data = global->network_data[destination];
+    gss_txq_t *txq = global->txq[destination];
+
+    pthread_mutex_lock(&global->tx_lock[destination]);
+
+    // Anything still queued for this destination must go out first; the writer pops and claims the socket under one hold of tx_lock, so an empty queue and an unclaimed socket mean nothing is in flight.
+    uint8_t netstat = gss_netstat(global);
+    int destination_socket = -1;
+    if (!gss_is_connected(global, destination) || destination_data->socket < 0 || gss_txq_depth(txq) > 0 || (txq->spool != NULL && gss_spool_depth(txq->spool) > 0) ||
+        (destination_socket = gss_txq_claim_socket(txq)) < 0)
+    {
+        pthread_mutex_unlock(&global->tx_lock[destination]);
+        return 0;
+    }
+    pthread_mutex_unlock(&global->tx_lock[destination]);
+
+    dbdebuglf("%sSplicing %d byte frame from ID:%d to ID:%d.", t_tag, header->payload_size, t_index, destination);
+
+    // The netstat byte is not covered by either CRC, so it can be patched in place.
+    header->netstat = netstat;
+
+    ssize_t retval = gss_splice_forward(splicer, global->network_data[t_index]->socket, destination_socket, header, decoder);
+    int error = errno;
+
+    if (retval >= 0)
+    {
+        // The payload never enters user space, so only the header is logged.
+        gss_log_frame(global->log, (unsigned char *)header, GSS_LOG_FLAG_NO_PAYLOAD);
+    }
+
+    if (retval > 0)
+    {
+        global->last_rx_ns[t_index].store(gss_health_now_ns(), std::memory_order_relaxed);
+        txq->spliced++;
+        txq->spliced_bytes += frame_size;
+        gss_metrics_received(global->metrics, gss_vertex(global, t_index), frame_size);
+        gss_metrics_sent(global->metrics, (unsigned char *)header, frame_size, gss_txq_classify(txq, (unsigned char *)header), 0, 0);
+    }
+    else if (retval == 0)
+    {
+        // The destination was left part of the way through the frame and has been shut down; its writer must not send on it either.
+        gss_txq_fail_socket(txq);
+        txq->send_failed++;
+        gss_metrics_received(global->metrics, gss_vertex(global, t_index), frame_size);
+        gss_metrics_failed(global->metrics, gss_vertex(global, destination), GSS_METRICS_SEND_FAILED);
+        dbwarnlf(RED_FG "%sSplice cut short (from %d to %d), shutting down the destination's connection.", t_tag, (int)header->origin, destination);
+    }
+
+    gss_txq_release_socket(txq);
+
+    // The writer backs off while the socket is claimed; wake it for whatever was queued meanwhile.
+    if (gss_txq_depth(txq) > 0)
+    {
+        sem_post(&txq->items);
+    }
+
+    // The frame was consumed from the origin either way, unless the origin itself failed or the frame was invalid.
+    errno = error;
+    return retval < 0 ? retval : (ssize_t)frame_size;
+}
+
+void gss_print_stats(global_data_t *global)
+{
+    gss_pool_stats_t pool_stats;
+    gss_pool_get_stats(global->pool, &pool_stats);
+    dbinfolf("Frame pool: %lu frames, %lu heap allocations (%.4f per frame), %lu frees, high-water %lu buffers, %lu outstanding.",
+             pool_stats.gets, pool_stats.heap_allocations, pool_stats.gets ? (double)pool_stats.heap_allocations / pool_stats.gets : 0.0,
+             pool_stats.heap_frees, pool_stats.high_water, pool_stats.outstanding);
+
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_txq_stats_t txq_stats;
+        gss_txq_get_stats(global->txq[i], &txq_stats);
+        dbinfolf("TX queue %d: depth %lu, high-water %lu, enqueued %lu, dropped %lu/%lu, backpressured %lu, sent %lu, failed %lu, spliced %lu (%lu bytes).", i,
+                 txq_stats.depth, txq_stats.high_water, txq_stats.enqueued, txq_stats.dropped_oldest, txq_stats.dropped_newest,
+                 txq_stats.backpressured, txq_stats.sent, txq_stats.send_failed, txq_stats.spliced, txq_stats.spliced_bytes);
+
+        // Mean forwarding latency per priority class, to show whether urgent frames are being held up.
+        char classes[192];
+        int length = 0;
+        for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+        {
+            length += snprintf(classes + length, sizeof(classes) - length, "%s%s depth %lu, sent %lu, mean %.1f us", c > 0 ? "; " : "", gss_txq_class_name(c),
+                               txq_stats.class_depth[c], txq_stats.class_sent[c], txq_stats.class_sent[c] ? txq_stats.class_latency_ns[c] / 1e3 / txq_stats.class_sent[c] : 0.0);
+        }
+        dbinfolf("TX queue %d by class: %s.", i, classes);
+
+        // Scheduling jitter: how long the writer took to run once there was something to send.
+        if (txq_stats.wakeups > 0)
+        {
+            dbinfolf("TX queue %d wake-ups: %lu, mean %.1f us, p99 <= %lu us, max %.1f us.", i, txq_stats.wakeups, txq_stats.wakeup_ns / 1e3 / txq_stats.wakeups,
+                     gss_txq_wakeup_percentile_us(&txq_stats, 0.99), txq_stats.wakeup_max_ns / 1e3);
+        }
+    }
+
+    for (int i = 0; i < global->topology.num_vertices; i++)
+    {
+        if (global->spool[i] != NULL)
+        {
+            gss_spool_stats_t spool_stats;
+            gss_spool_get_stats(global->spool[i], &spool_stats);
+            dbinfolf("Spool %s: depth %lu (%lu on disk), spooled %lu, flushed %lu, expired %lu, evicted %lu.", global->topology.vertices[i].name,
+                     spool_stats.depth, spool_stats.on_disk, spool_stats.spooled, spool_stats.flushed, spool_stats.expired, spool_stats.evicted);
+        }
+        if (global->dedup[i] != NULL)
+        {
+            gss_dedup_stats_t dedup_stats;
+            gss_dedup_get_stats(global->dedup[i], &dedup_stats);
+            dbinfolf("Dedup %s: %lu duplicates dropped, %lu frames forwarded.", global->topology.vertices[i].name, dedup_stats.hits, dedup_stats.misses);
+        }
+    }
 
-    // Socket prep.
-    int listening_socket, socket_size;
-    struct sockaddr_in listening_address, accepted_address;
-    int buffer_size = sizeof(NetFrame) + 16;
-    unsigned char buffer[buffer_size + 1];
-    memset(buffer, 0x0, buffer_size);
+    for (int i = 0; global->compress != NULL && i < global->num_connections; i++)
+    {
+        if (gss_vertex(global, i) != global->topology.client)
+        {
+            continue;
+        }
 
-    // Create socket.
-    listening_socket = socket(AF_INET, SOCK_STREAM, 0);
+        // The ratio is of bytes sent to bytes that would have been sent uncompressed.
+        gss_compress_stats_t compress_stats;
+        gss_compress_get_stats(global->compress, i, &compress_stats);
+        dbinfolf("Compression %d (%s): %lu frames compressed, %lu sent as is, %lu -> %lu bytes (ratio %.3f), %.3f ms compressing, %lu frames expanded in %.3f ms.", i,
+                 compress_stats.enabled ? "on" : "off", compress_stats.compressed, compress_stats.bypassed, compress_stats.raw_bytes, compress_stats.wire_bytes,
+                 compress_stats.raw_bytes ? (double)compress_stats.wire_bytes / compress_stats.raw_bytes : 1.0, compress_stats.compress_ns / 1e6,
+                 compress_stats.expanded, compress_stats.expand_ns / 1e6);
+    }
+
+    if (global->latency != NULL)
+    {
+        // Mean time per hop over the samples which have both of its ends.
+        gss_latency_stats_t latency_stats;
+        gss_latency_get_stats(global->latency, &latency_stats);
+        char hops[256];
+        int length = 0;
+        for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+        {
+            length += snprintf(hops + length, sizeof(hops) - length, "%s %.1f us, ", gss_latency_hop_name(h),
+                               latency_stats.hop_count[h] ? latency_stats.hop_ns[h] / 1e3 / latency_stats.hop_count[h] : 0.0);
+        }
+        dbinfolf("Latency: %lu samples (%lu with kernel RX, %lu with kernel TX timestamps), %stotal %.1f us; %lu traced, %lu dropped.", latency_stats.samples, latency_stats.kernel_rx,
+                 latency_stats.kernel_tx, hops, latency_stats.samples ? latency_stats.total_ns / 1e3 / latency_stats.samples : 0.0, latency_stats.traced, latency_stats.dropped);
+    }
+
+    if (global->log != NULL)
+    {
+        gss_log_stats_t log_stats;
+        gss_log_get_stats(global->log, &log_stats);
+        dbinfolf("Frame log: logged %lu, dropped %lu, %lu bytes in %lu writes, %lu rotations.",
+                 log_stats.logged, log_stats.dropped, log_stats.bytes_written, log_stats.write_calls, log_stats.rotations);
+    }
+
+    if (global->capture != NULL)
+    {
+        gss_log_stats_t capture_stats;
+        gss_log_get_stats(global->capture, &capture_stats);
+        dbinfolf("Capture: recorded %lu, dropped %lu, %lu bytes in %lu writes, %lu rotations.",
+                 capture_stats.logged, capture_stats.dropped, capture_stats.bytes_written, capture_stats.write_calls, capture_stats.rotations);
+    }
+}
+
+int gss_network_listen(global_data_t *global, int vertex)
+{
+    NetDataServer *network_data = global->network_data[vertex];
+    const char *name = global->topology.vertices[vertex].name;
+
+    int listening_socket;
+    struct sockaddr_in listening_address;
+
+    network_data->listening_port = global->topology.vertices[vertex].port;
+
+    // After a hot restart the previous instance's socket is already bound and listening, with connection attempts waiting in its backlog; it may have been a blocking one.
+    listening_socket = gss_reload_inherit(network_data->listening_port);
+    if (listening_socket >= 0)
+    {
+        fcntl(listening_socket, F_SETFL, fcntl(listening_socket, F_GETFL) | O_NONBLOCK);
+        dbinfolf(GREEN_FG "Inherited listening socket for %s on port %d.", name, network_data->listening_port);
+        gss_reload_listening(network_data->listening_port, listening_socket);
+        return listening_socket;
+    }
+
+    // Create socket. Non-blocking, so that whichever RX thread or reactor loses a race for a connection is not stuck in accept(...).
+    listening_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (listening_socket == -1)
     {
-        dbprintlf(FATAL "%sCould not create socket.", t_tag);
-        return NULL;
+        dberrorlf(FATAL "Could not create socket for %s.", name);
+        return -1;
     }
-    dbprintlf(GREEN_FG "%sSocket created.", t_tag);
 
+    memset(&listening_address, 0x0, sizeof(listening_address));
     listening_address.sin_family = AF_INET;
     // Its fine to accept just any address.
     listening_address.sin_addr.s_addr = INADDR_ANY;
 
-    // Calculate and set port.
-    network_data->listening_port = (int)NetPort::CLIENT + (10 * t_index);
     listening_address.sin_port = htons(network_data->listening_port);
 
-    // Set the timeout for recv, which will allow us to reconnect to poorly disconnected clients.
+    // Set the timeout for recv, which will allow us to reconnect to poorly disconnected clients. Accepted connections inherit it.
     struct timeval timeout;
-    timeout.tv_sec = LISTENING_SOCKET_TIMEOUT;
+    timeout.tv_sec = global->topology.timeout_s;
     timeout.tv_usec = 0;
     setsockopt(listening_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
 
@@ -121,275 +784,411 @@ void *gss_network_rx_thread(void *global_vp)
     int enable = 1;
     setsockopt(listening_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
 
-    // Bind.
+    // Bind. Only a port another process still holds (e.g. a previous instance which is still exiting) is worth trying again.
+    int retry_ms = GSS_BIND_RETRY_MS;
+    uint64_t deadline_ns = gss_health_now_ns() + GSS_BIND_TIMEOUT_S * 1000000000ULL;
     while (bind(listening_socket, (struct sockaddr *)&listening_address, sizeof(listening_address)) < 0)
     {
-        dbprintlf(RED_FG "%sError: Port binding failed.", t_tag);
-        dbprintf(YELLOW_FG "%s>>> ", t_tag);
-        perror("bind");
-        sleep(5);
+        if (errno != EADDRINUSE || gss_health_now_ns() >= deadline_ns)
+        {
+            dberrorlf(FATAL "Could not bind port %d for %s: %s", network_data->listening_port, name, strerror(errno));
+            close(listening_socket);
+            return -1;
+        }
+        dbwarnlf(YELLOW_FG "Port %d for %s is in use, trying again in %d ms.", network_data->listening_port, name, retry_ms);
+        usleep(retry_ms * 1000);
+        retry_ms = retry_ms * 2 < GSS_BIND_RETRY_MAX_MS ? retry_ms * 2 : GSS_BIND_RETRY_MAX_MS;
+    }
+
+    // Listen. Every GUI client connection accepts from this one backlog.
+    if (listen(listening_socket, GSS_LISTEN_BACKLOG) < 0)
+    {
+        dberrorlf(FATAL "Could not listen on port %d for %s: %s", network_data->listening_port, name, strerror(errno));
+        close(listening_socket);
+        return -1;
     }
-    dbprintlf(GREEN_FG "%sBound to port %d.", t_tag, network_data->listening_port);
+    dbinfolf(GREEN_FG "Listening for %s on port %d.", name, network_data->listening_port);
+    gss_reload_listening(network_data->listening_port, listening_socket);
 
-    // Listen.
-    listen(listening_socket, 3);
+    return listening_socket;
+}
+
+/**
+ * @brief Waits up to the topology's timeout for a connection on a listening socket, in short slices so that a shutdown is noticed promptly.
+ *
+ * Waiting in poll(...) rather than a blocking accept(...) also copes with a listening socket inherited from a reactor, which is non-blocking.
+ *
+ * @return int The accepted connection, or -1 on error (errno is EAGAIN on a timeout).
+ */
+static int gss_network_accept(global_data_t *global, int t_index, int listening_socket)
+{
+    NetDataServer *network_data = global->network_data[t_index];
+    struct sockaddr_in accepted_address;
+    socklen_t socket_size = sizeof(accepted_address);
+
+    for (int waited_ms = 0; waited_ms < global->topology.timeout_s * 1000 && network_data->recv_active; waited_ms += GSS_ACCEPT_SLICE_MS)
+    {
+        struct pollfd listening;
+        listening.fd = listening_socket;
+        listening.events = POLLIN;
+        int retval = poll(&listening, 1, GSS_ACCEPT_SLICE_MS);
+
+        if (retval < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+        else if (retval > 0)
+        {
+            // Another GUI client connection's thread, or another instance during a hot restart, may have taken it first (EAGAIN).
+            return accept4(listening_socket, (struct sockaddr *)&accepted_address, &socket_size, SOCK_CLOEXEC);
+        }
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * @brief Receives on an accepted connection with a batched engine, routing every frame in each batch, until the connection ends.
+ *
+ * @return ssize_t -404 if the peer closed the connection, -1 on error (errno is EAGAIN on a timeout), or 0 if receiving was deactivated.
+ */
+static ssize_t gss_network_recv_batches(global_data_t *global, int t_index, gss_recv_t *receiver, const char *t_tag)
+{
+    NetDataServer *network_data = global->network_data[t_index];
+    ssize_t read_size = 0;
+
+    gss_recv_start(receiver, network_data->socket);
 
     while (network_data->recv_active)
     {
-        int read_size = 0;
+        read_size = gss_recv_fill(receiver, global->topology.timeout_s);
+
+        if (read_size < 0)
+        {
+            break;
+        }
+
+        uint64_t received_ns = global->latency != NULL ? gss_latency_now_ns() : 0;
+
+        unsigned char *data;
+        ssize_t frame_size;
+        while ((frame_size = gss_recv_next(receiver, &data)) != 0)
+        {
+            if (frame_size < 0)
+            {
+                gss_report_corrupt(global, t_index, receiver->skipped, t_tag);
+                continue;
+            }
+
+            if (gss_route_drops(global, t_index, (gss_frame_header_t *)data))
+            {
+                gss_route_dropped(global, t_index, (gss_frame_header_t *)data, frame_size, t_tag);
+                continue;
+            }
+
+            // The router owns what it is given, so move the frame out of the decoder into a pool buffer.
+            unsigned char *frame = gss_pool_get(global->pool, frame_size);
+            if (frame == NULL)
+            {
+                dbwarnlf(RED_FG "%sOut of frame buffers, dropping frame.", t_tag);
+                continue;
+            }
+            memcpy(frame, data, frame_size);
+            if (gss_latency_due(global->latency))
+            {
+                gss_latency_begin(frame, receiver->kernel_ns, received_ns);
+            }
+            gss_route_frame(global, t_index, frame, frame_size, t_tag);
+        }
+
+        read_size = 0;
+    }
+
+    int error = errno;
+    gss_recv_stop(receiver);
+    dbinfolf("%sReceived %llu frames in %llu receive calls.", t_tag, (unsigned long long)receiver->frames, (unsigned long long)receiver->syscalls);
+    errno = error;
+
+    return read_size;
+}
+
+/**
+ * @brief Resumes receiving a frame at a time after a frame was rejected: routes every frame found in what was received for it, and any frame which began in it, until the stream is in step again (see gss_frame_decoder_recv(...)).
+ *
+ * @return ssize_t 0 once in step, -404 if the peer closed the connection, or -1 on error.
+ */
+static ssize_t gss_network_recv_resync(global_data_t *global, int t_index, gss_frame_decoder_t *decoder, const char *t_tag)
+{
+    NetDataServer *network_data = global->network_data[t_index];
+
+    // The rejected frame's GUID goes first.
+    gss_report_corrupt(global, t_index, gss_frame_decoder_resync(decoder), t_tag);
+
+    while (true)
+    {
+        size_t skipped;
+        ssize_t frame_size = gss_frame_decoder_recv(decoder, network_data->socket, &skipped);
+
+        if (skipped > 0)
+        {
+            gss_report_corrupt(global, t_index, skipped, t_tag);
+        }
+
+        if (frame_size <= 0)
+        {
+            return frame_size;
+        }
+
+        if (gss_route_drops(global, t_index, (gss_frame_header_t *)decoder->buffer))
+        {
+            gss_route_dropped(global, t_index, (gss_frame_header_t *)decoder->buffer, frame_size, t_tag);
+        }
+        else
+        {
+            // The router owns what it is given, so move the frame out of the decoder into a pool buffer.
+            unsigned char *frame = gss_pool_get(global->pool, frame_size);
+            if (frame == NULL)
+            {
+                dbwarnlf(RED_FG "%sOut of frame buffers, dropping frame.", t_tag);
+            }
+            else
+            {
+                memcpy(frame, decoder->buffer, frame_size);
+                gss_route_frame(global, t_index, frame, frame_size, t_tag);
+            }
+        }
+        gss_frame_decoder_consume(decoder, frame_size);
+    }
+}
+
+void *gss_network_rx_thread(void *args_vp)
+{
+    gss_rx_args_t *args = (gss_rx_args_t *)args_vp;
+    global_data_t *global = args->global;
+    int t_index = args->t_index;
+    int vertex = gss_vertex(global, t_index);
+    const char *name = global->topology.vertices[vertex].name;
+
+    // Tags read e.g. [RXT_ROOF_UHF], or [RXT_CLIENT_1] for the client's additional connections.
+    char t_tag[48];
+    int tag_size = snprintf(t_tag, sizeof(t_tag), "[RXT_");
+    for (int i = 0; name[i] != '\0' && tag_size < (int)sizeof(t_tag) - 8; i++)
+    {
+        t_tag[tag_size++] = toupper(name[i]);
+    }
+    if (t_index >= global->topology.num_vertices)
+    {
+        snprintf(t_tag + tag_size, sizeof(t_tag) - tag_size, "_%d] ", t_index - global->topology.num_vertices + 1);
+    }
+    else
+    {
+        snprintf(t_tag + tag_size, sizeof(t_tag) - tag_size, "] ");
+    }
+
+    dbinfolf("%sThread (id:%lu) listening for %s (ID:%d).", t_tag, (unsigned long)pthread_self(), name, global->topology.vertices[vertex].id);
+
+    // Makes my life easier.
+    NetDataServer *network_data = global->network_data[t_index];
 
-        // Accept an incoming connection.
-        socket_size = sizeof(struct sockaddr_in);
+    // Bound before this thread started; the client's additional connections share the client's.
+    int listening_socket = global->listening_socket[vertex];
+    network_data->listening_port = global->network_data[vertex]->listening_port;
+
+    // Large frames may be spliced straight through to their destination.
+    gss_splice_t splicer;
+    bool splicing = false;
+    if (global->splice_threshold > 0)
+    {
+        splicing = gss_splice_init(&splicer) > 0;
+        if (!splicing)
+        {
+            dbwarnlf(YELLOW_FG "%sCould not create splice pipe, forwarding by copy.", t_tag);
+        }
+    }
+
+    // Or frames may be received in batches (see gss_recv.hpp).
+    gss_recv_t *receiver = NULL;
+    if (global->recv_engine != GSS_RECV_FRAME)
+    {
+        receiver = new gss_recv_t;
+        gss_recv_init(receiver, global->recv_engine, t_tag);
+        receiver->stamped = global->latency != NULL;
+    }
+
+    // Otherwise, what was received of a rejected frame is searched for the frames it may have swallowed.
+    gss_frame_decoder_t *decoder = NULL;
+    if (receiver == NULL)
+    {
+        decoder = new gss_frame_decoder_t;
+    }
+
+    while (network_data->recv_active)
+    {
+        int read_size = 0;
 
         // Accept connection from an incoming client.
-        network_data->socket = accept(listening_socket, (struct sockaddr *)&accepted_address, (socklen_t *)&socket_size);
-        if (network_data->socket < 0)
+        int accepted_socket = gss_network_accept(global, t_index, listening_socket);
+        if (accepted_socket < 0)
         {
-            if (errno == EAGAIN)
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
             {
                 // Waiting for connection timed-out.
-                dbprintlf("%sTimed out (NETSTAT %d %d %d %d %d).", t_tag,
-                          global->network_data[LF_CLIENT]->connection_ready ? 1 : 0,
-                          global->network_data[LF_ROOF_UHF]->connection_ready ? 1 : 0,
-                          global->network_data[LF_ROOF_XBAND]->connection_ready ? 1 : 0,
-                          global->network_data[LF_HAYSTACK]->connection_ready ? 1 : 0,
-                          global->network_data[LF_TRACK]->connection_ready ? 1 : 0);
-                network_data->connection_ready = false;
+                dbdebuglf("%sTimed out (NETSTAT 0x%02x).", t_tag, gss_netstat(global));
+                gss_set_connected(global, t_index, false);
                 continue;
             }
             else
             {
-                dbprintlf(YELLOW_FG "%s>>> ", t_tag);
-                perror("accept failed");
+                dbwarnlf(YELLOW_FG "%s>>> accept failed: %s", t_tag, strerror(errno));
                 continue;
             }
         }
-        dbprintlf(CYAN_FG "%sConnection accepted.", t_tag);
+        dbinfolf(CYAN_FG "%sConnection accepted.", t_tag);
+
+        gss_health_configure_socket(accepted_socket, &global->health);
+        gss_topology_configure_socket(accepted_socket, &global->topology, gss_vertex(global, t_index));
+        gss_txq_configure_socket(accepted_socket, global->topology.timeout_s);
+        if (global->latency != NULL)
+        {
+            gss_latency_configure_socket(accepted_socket);
+        }
+        gss_txq_set_socket(global->txq[t_index], accepted_socket);
 
         // We are now connected.
-        network_data->connection_ready = true;
+        gss_set_connected(global, t_index, true);
 
         // Read from the socket.
 
-        while (read_size >= 0 && network_data->recv_active)
+        if (receiver != NULL)
+        {
+            read_size = gss_network_recv_batches(global, t_index, receiver, t_tag);
+        }
+        else
+        {
+            gss_frame_decoder_reset(decoder);
+        }
+
+        while (receiver == NULL && read_size >= 0 && network_data->recv_active)
         {
-            dbprintlf("%sBeginning recv... (last read: %d bytes of payload)", t_tag, read_size);
+            dbdebuglf("%sBeginning recv... (last read: %d byte frame)", t_tag, read_size);
 
-            NetFrame *netframe = new NetFrame();
-            read_size = netframe->recvFrame(network_data);
+            gss_frame_header_t header;
+            size_t skipped;
+            // Decided before receiving, so that frames which are not sampled are received no differently.
+            bool sampled = gss_latency_due(global->latency);
+            uint64_t kernel_ns = 0;
+            read_size = gss_frame_recv_header(network_data->socket, &header, &skipped, sampled ? &kernel_ns : NULL);
+            uint64_t received_ns = sampled ? gss_latency_now_ns() : 0;
 
-            if (read_size >= 0)
+            if (skipped > 0)
             {
-                dbprintlf("Received the following NetFrame:");
-                netframe->print();
+                gss_report_corrupt(global, t_index, skipped, t_tag);
+            }
 
-                switch (netframe->getDestination())
-                {
-                case NetVertex::SERVER:
+            if (read_size < 0)
+            {
+                break;
+            }
+
+            bool drops = gss_route_drops(global, t_index, &header);
+
+            if (!drops && splicing && header.payload_size >= global->splice_threshold)
+            {
+                read_size = gss_route_splice(global, t_index, &header, &splicer, decoder, t_tag);
+
+                if (read_size < 0 && errno == EBADMSG)
                 {
-                    // Ride ends here, at the server.
-                    // NOTE: Parse and do something. maybe, we'll see.
-                    dbprintlf(CYAN_FG "Received a packet for the server from ID:%d!", t_index);
-                    if (netframe->getType() == NetType::POLL)
-                    {
-                        dbprintlf("Received a status polling packet, responding.");
-
-                        // Send the null frame to whomever asked for it.
-                        NetFrame *netstat_frame = new NetFrame(NULL, 0, NetType::POLL, (NetVertex)t_index);
-
-                        uint8_t netstat = 0x0;
-                        netstat |= 0x80 * (global->network_data[LF_CLIENT]->connection_ready);
-                        netstat |= 0x40 * (global->network_data[LF_ROOF_UHF]->connection_ready);
-                        netstat |= 0x20 * (global->network_data[LF_ROOF_XBAND]->connection_ready);
-                        netstat |= 0x10 * (global->network_data[LF_HAYSTACK]->connection_ready);
-                        netstat |= 0x8 * (global->network_data[LF_TRACK]->connection_ready);
-
-                        netstat_frame->setNetstat(netstat);
-
-                        dbprintlf("%sNETSTAT %d %d %d %d %d (%d)", t_tag,
-                                  global->network_data[LF_CLIENT]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_ROOF_UHF]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_ROOF_XBAND]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_HAYSTACK]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_TRACK]->connection_ready ? 1 : 0, netstat);
-
-                        // Transmit the clientserver_frame, sending the network_data for the connection down which we would like it to be sent.
-                        if (netstat_frame->sendFrame(global->network_data[t_index]) < 0)
-                        {
-                            dbprintlf(RED_FG "%sNetStat frame send to %d failed.", t_tag, t_index);
-                        }
-                    }
-                    else
-                    {
-                        dbprintlf(RED_FG "%sFrame addressed to server but was not a polling status frame.", t_tag);
-                    }
-                    break;
+                    read_size = gss_network_recv_resync(global, t_index, decoder, t_tag);
+                    continue;
                 }
-                case NetVertex::CLIENT:
-                case NetVertex::ROOFUHF:
-                case NetVertex::ROOFXBAND:
-                case NetVertex::HAYSTACK:
-                case NetVertex::TRACK:
+                else if (read_size < 0)
                 {
-                    if (global->network_data[(int)netframe->getDestination()]->connection_ready)
-                    {
-                        dbprintlf("%sPassing along frame.", t_tag);
-                        uint8_t netstat = 0x0;
-                        netstat |= 0x80 * (global->network_data[LF_CLIENT]->connection_ready);
-                        netstat |= 0x40 * (global->network_data[LF_ROOF_UHF]->connection_ready);
-                        netstat |= 0x20 * (global->network_data[LF_ROOF_XBAND]->connection_ready);
-                        netstat |= 0x10 * (global->network_data[LF_HAYSTACK]->connection_ready);
-                        netstat |= 0x8 * (global->network_data[LF_TRACK]->connection_ready);
-
-                        netframe->setNetstat(netstat);
-
-                        dbprintlf("%sNETSTAT %d %d %d %d %d", t_tag,
-                                  global->network_data[LF_CLIENT]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_ROOF_UHF]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_ROOF_XBAND]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_HAYSTACK]->connection_ready ? 1 : 0,
-                                  global->network_data[LF_TRACK]->connection_ready ? 1 : 0);
-                        
-                        // ///
-                        // // Log the data being sent and whether or not it was sent successfully.
-                        // static int log_file_num = 0;
-                        // static int log_entry_num = 0;
-                        // static int log_size = 0;
-                        // char log_num_name[256] = {0};
-                        // char log_name[256] = {0};
-                        // FILE *log_num_fp = NULL;
-                        // FILE *log_fp = NULL;
-
-                        // snprintf(log_num_name, 256, "logs/t_index#%d/log_num.txt", t_index);
-
-                        // if (access(log_num_name, F_OK) != 0)
-                        // {
-                        //     log_num_fp = fopen(log_num_name, "w");
-                        //     if (log_num_fp == NULL)
-                        //     {
-                        //         dbprintlf(RED_FG "Failed to create log_num file.");
-                        //     }
-                        //     else
-                        //     {
-                        //         fprintf(log_num_fp, "0");
-                        //         fclose(log_num_fp);
-                        //     }
-                        // }
-
-                        // log_num_fp = fopen(log_num_name, "r");
-                        // if (log_num_fp == NULL)
-                        // {
-                        //     dbprintlf(RED_FG "Failed to open log number file (%s)! Logging failed.", log_num_name);
-                        // }
-                        // else
-                        // {
-                        //     fscanf(log_num_fp, "%d", &log_file_num);
-                        //     fscanf(log_num_fp, "%d", &log_entry_num);
-                        //     dbprintlf(GREEN_FG "Closing log_num_fp");
-                        //     fclose(log_num_fp);
-                        //     log_num_fp = NULL;
-
-                        //     snprintf(log_name, 256, "logs/t_index#%d/log#%d.txt", t_index, log_file_num);
-                        //     log_fp = fopen(log_name, "a");
-                        //     if (log_fp == NULL)
-                        //     {
-                        //         dbprintlf(RED_FG "Failed to open log file (%s)! Logging failed.", log_name);
-                        //     }
-                        //     else
-                        //     {
-                        //         fprintf(log_fp, "__DATA LOG ENTRY #%d__\n", log_entry_num);
-                        //         fprintf(log_fp, "T_TAG %s", t_tag);
-                        //         fprintf(log_fp, "T_INDEX %d", t_index);
-                        //         fprintf(log_fp, "BEGIN PACKET INFO");
-                        //         fprintf(log_fp, "Type %d", (int)netframe->getType());
-                        //         fprintf(log_fp, "Origin %d", (int)netframe->getOrigin());
-                        //         fprintf(log_fp, "Destination %d", (int)netframe->getDestination());
-                        //         fprintf(log_fp, "Payload Size %d", netframe->getPayloadSize());
-                        //         fprintf(log_fp, "Frame Size %d", netframe->getFrameSize());
-                        //         fprintf(log_fp, "Netstat %d", netframe->getNetstat());
-                        //         fprintf(log_fp, "Payload (HEX)");
-                        //         for (int i = 0; i < netframe->getPayloadSize(); i++)
-                        //         {
-                        //             fprintf(log_fp, "%02x", netframe[i]);
-                        //         }
-                        //         fprintf(log_fp, "\n");
-                        //         fprintf(log_fp, "END PACKET INFO");
-                        //         fprintf(log_fp, "__DATA LOG ENTRY END__");
-
-                        //         fseek(log_fp, 0, SEEK_END);
-                        //         log_size = ftell(log_fp);
-                        //         dbprintlf(GREEN_FG "Closing log_fp");
-                        //         fclose(log_fp);
-                        //         log_fp = NULL;
-
-                        //         log_num_fp = fopen(log_num_name, "w");
-                        //         if (log_num_fp == NULL)
-                        //         {
-                        //             dbprintlf(RED_FG "Failed to open log number file (%s)! Number updating failed.", log_num_name);
-                        //         }
-                        //         else
-                        //         {
-                        //             if (log_size > 256000000)
-                        //             {
-                        //                 log_file_num++;
-                        //             }
-                                    
-                        //             fprintf(log_num_fp, "%d %d", log_file_num, log_entry_num + 1);
-                        //             dbprintlf(GREEN_FG "Closing log_num_fp");
-                        //             fclose(log_num_fp);
-                        //             log_num_fp = NULL;
-                        //         }
-                        //     }
-                        // }
-
-                        // ///
-
-                        // Transmit the NetFrame, sending the network_data for the connection down which we would like it to be sent.
-                        if (netframe->sendFrame(global->network_data[(int)netframe->getDestination()]) < 0)
-                        {
-                            dbprintlf(RED_FG "%sSend failed (from %d to %d).", t_tag, (int)netframe->getOrigin(), (int)netframe->getDestination());
-                        }
-                    }
-                    else
-                    {
-                        dbprintlf(RED_FG "%sCannot pass frame from ID:%d to ID:%d since the connection is not ready.", t_tag, (int)netframe->getOrigin(), (int)netframe->getDestination());
-                    }
-
                     break;
                 }
-                default:
+                else if (read_size > 0)
                 {
-                    // Probably received nothing.
-                    break;
-                }
+                    continue;
                 }
             }
+
+            // A frame going nowhere is received into the decoder, not into a pool buffer.
+            unsigned char *frame = NULL;
+            if (drops)
+            {
+                read_size = gss_frame_discard_body(network_data->socket, &header, decoder);
+            }
             else
+            {
+                read_size = gss_frame_recv_body(network_data->socket, &header, global->pool, &frame, decoder);
+            }
+
+            if (read_size < 0 && (errno == EBADMSG || errno == EAGAIN))
+            {
+                // Its GUID may have matched by chance, or its payload size been corrupt, in which case it swallowed the frames after it.
+                read_size = gss_network_recv_resync(global, t_index, decoder, t_tag);
+                continue;
+            }
+            else if (read_size < 0)
             {
                 break;
             }
 
-            delete netframe;
+            if (drops)
+            {
+                gss_route_dropped(global, t_index, &header, read_size, t_tag);
+                continue;
+            }
+
+            if (sampled)
+            {
+                gss_latency_begin(frame, kernel_ns, received_ns);
+            }
+
+            // The router takes ownership of the frame and hands it back to the pool once it has been sent or dropped.
+            gss_route_frame(global, t_index, frame, read_size, t_tag);
+        }
 
+        if (!network_data->recv_active)
+        {
+            // Shutting down: the connection stays open until its transmit queue has drained (see gss_drain(...)).
+            break;
         }
+
         if (read_size == -404)
         {
-            dbprintlf(CYAN_BG "%sClient closed connection.", t_tag);
-            network_data->connection_ready = false;
-            continue;
+            dbinfolf(CYAN_BG "%sClient closed connection.", t_tag);
         }
         else if (errno == EAGAIN)
         {
-            dbprintlf(YELLOW_BG "%sActive connection timed-out (%d).", t_tag, read_size);
-            network_data->connection_ready = false;
-            continue;
+            dbwarnlf(YELLOW_BG "%sActive connection timed-out (%d).", t_tag, read_size);
         }
+        else if (read_size < 0)
+        {
+            // E.g. ETIMEDOUT once keepalive or TCP_USER_TIMEOUT gives up on the peer.
+            dbwarnlf(YELLOW_BG "%sConnection failed: %s", t_tag, strerror(errno));
+        }
+
+        gss_set_connected(global, t_index, false);
+        gss_txq_close_socket(global->txq[t_index]);
     }
 
     if (!global->network_data[t_index]->recv_active)
     {
-        dbprintlf(YELLOW_FG "%sReceive deactivated.", t_tag);
+        dbwarnlf(YELLOW_FG "%sReceive deactivated.", t_tag);
+    }
+
+    if (splicing)
+    {
+        gss_splice_close(&splicer);
+    }
+
+    if (receiver != NULL)
+    {
+        gss_recv_close(receiver);
+        delete receiver;
     }
+    delete decoder;
 
     return NULL;
 }
\ No newline at end of file
@@ -0,0 +1,500 @@
+/**
+ * @file gss_compress.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <string.h>
+#include "gss_compress.hpp"
+#include "gss_frame.hpp"
+#include "gss_crc.hpp"
+#include "gss_health.hpp"
+
+#define GSS_LZ4_MIN_MATCH 4
+#define GSS_LZ4_LAST_LITERALS 5 // The format requires a block to end with at least this many literals...
+#define GSS_LZ4_MF_LIMIT 12 // ...and its last match to start at least this far from its end.
+#define GSS_LZ4_MAX_OFFSET 65535
+#define GSS_LZ4_HASH_BITS 12
+#define GSS_LZ4_SKIP_TRIGGER 6 // Every 2^6 positions without a match, the search steps one byte further, so incompressible data is skimmed rather than searched.
+
+static inline uint32_t gss_lz4_read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t gss_lz4_read64(const unsigned char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t gss_lz4_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - GSS_LZ4_HASH_BITS);
+}
+
+/**
+ * @brief Writes the 255-byte continuation of a length which did not fit in its token's four bits.
+ *
+ */
+static inline unsigned char *gss_lz4_write_length(unsigned char *op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+ssize_t gss_lz4_compress(const unsigned char *src, size_t src_size, unsigned char *dst, size_t dst_capacity)
+{
+    uint32_t table[1 << GSS_LZ4_HASH_BITS]; // Last position each hashed sequence was seen at.
+    memset(table, 0, sizeof(table));
+
+    const unsigned char *ip = src;
+    const unsigned char *anchor = src;
+    const unsigned char *iend = src + src_size;
+    unsigned char *op = dst;
+    unsigned char *oend = dst + dst_capacity;
+
+    if (src_size > GSS_LZ4_MF_LIMIT)
+    {
+        const unsigned char *mflimit = iend - GSS_LZ4_MF_LIMIT;
+        const unsigned char *matchlimit = iend - GSS_LZ4_LAST_LITERALS;
+        unsigned searched = 1 << GSS_LZ4_SKIP_TRIGGER;
+
+        while (ip <= mflimit)
+        {
+            uint32_t sequence = gss_lz4_read32(ip);
+            uint32_t hash = gss_lz4_hash(sequence);
+            const unsigned char *match = src + table[hash];
+            table[hash] = ip - src;
+
+            if (match >= ip || ip - match > GSS_LZ4_MAX_OFFSET || gss_lz4_read32(match) != sequence)
+            {
+                ip += searched++ >> GSS_LZ4_SKIP_TRIGGER;
+                continue;
+            }
+            searched = 1 << GSS_LZ4_SKIP_TRIGGER;
+
+            // Extend the match backwards into the pending literals, then forwards.
+            while (ip > anchor && match > src && ip[-1] == match[-1])
+            {
+                ip--;
+                match--;
+            }
+            // Eight bytes at a time while there is room; the lowest differing bit gives the first differing byte, little-endian.
+            size_t length = GSS_LZ4_MIN_MATCH;
+            size_t limit = matchlimit - ip;
+            uint64_t difference = 0;
+            while (length + 8 <= limit && (difference = gss_lz4_read64(ip + length) ^ gss_lz4_read64(match + length)) == 0)
+            {
+                length += 8;
+            }
+            if (difference != 0)
+            {
+                length += __builtin_ctzll(difference) >> 3;
+            }
+            else
+            {
+                while (length < limit && ip[length] == match[length])
+                {
+                    length++;
+                }
+            }
+            const unsigned char *match_end = ip + length;
+
+            size_t literal_length = ip - anchor;
+            size_t match_length = match_end - ip - GSS_LZ4_MIN_MATCH;
+            if ((size_t)(oend - op) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1)
+            {
+                return -1;
+            }
+
+            unsigned char *token = op++;
+            if (literal_length >= 15)
+            {
+                *token = 15 << 4;
+                op = gss_lz4_write_length(op, literal_length - 15);
+            }
+            else
+            {
+                *token = literal_length << 4;
+            }
+            memcpy(op, anchor, literal_length);
+            op += literal_length;
+
+            uint16_t offset = ip - match;
+            *op++ = offset & 0xff;
+            *op++ = offset >> 8;
+
+            if (match_length >= 15)
+            {
+                *token |= 15;
+                op = gss_lz4_write_length(op, match_length - 15);
+            }
+            else
+            {
+                *token |= match_length;
+            }
+
+            ip = match_end;
+            anchor = ip;
+
+            // Seed the table from inside the match too, which finds the next one sooner in repetitive data.
+            table[gss_lz4_hash(gss_lz4_read32(ip - 2))] = ip - 2 - src;
+        }
+    }
+
+    // The rest is literals.
+    size_t literal_length = iend - anchor;
+    if ((size_t)(oend - op) < 1 + literal_length / 255 + 1 + literal_length)
+    {
+        return -1;
+    }
+    if (literal_length >= 15)
+    {
+        *op++ = 15 << 4;
+        op = gss_lz4_write_length(op, literal_length - 15);
+    }
+    else
+    {
+        *op++ = literal_length << 4;
+    }
+    memcpy(op, anchor, literal_length);
+    op += literal_length;
+
+    return op - dst;
+}
+
+/**
+ * @brief Reads the 255-byte continuation of a length.
+ *
+ * @return bool false if the block ends first.
+ */
+static inline bool gss_lz4_read_length(const unsigned char **ip, const unsigned char *iend, size_t *length)
+{
+    unsigned char byte;
+    do
+    {
+        if (*ip >= iend)
+        {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+
+    return true;
+}
+
+ssize_t gss_lz4_decompress(const unsigned char *src, size_t src_size, unsigned char *dst, size_t dst_capacity)
+{
+    const unsigned char *ip = src;
+    const unsigned char *iend = src + src_size;
+    unsigned char *op = dst;
+    unsigned char *oend = dst + dst_capacity;
+
+    while (ip < iend)
+    {
+        unsigned token = *ip++;
+
+        size_t length = token >> 4;
+        if (length == 15 && !gss_lz4_read_length(&ip, iend, &length))
+        {
+            return -1;
+        }
+        if (length > (size_t)(iend - ip) || length > (size_t)(oend - op))
+        {
+            return -1;
+        }
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        // Only the last sequence has no match.
+        if (ip == iend)
+        {
+            break;
+        }
+
+        if (iend - ip < 2)
+        {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+        {
+            return -1;
+        }
+
+        length = token & 15;
+        if (length == 15 && !gss_lz4_read_length(&ip, iend, &length))
+        {
+            return -1;
+        }
+        length += GSS_LZ4_MIN_MATCH;
+        if (length > (size_t)(oend - op))
+        {
+            return -1;
+        }
+
+        // A match may overlap what it is copying, to repeat a short run.
+        const unsigned char *match = op - offset;
+        if (offset >= length)
+        {
+            memcpy(op, match, length);
+            op += length;
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op - dst;
+}
+
+gss_compress_t *gss_compress_create(int min_size)
+{
+    gss_compress_t *compress = new gss_compress_t;
+
+    compress->min_size = min_size;
+    compress->links = 0;
+    for (int i = 0; i < GSS_COMPRESS_MAX_LINKS; i++)
+    {
+        gss_compress_link_t *link = &compress->link_stats[i];
+        link->compressed = 0;
+        link->bypassed = 0;
+        link->raw_bytes = 0;
+        link->wire_bytes = 0;
+        link->compress_ns = 0;
+        link->expanded = 0;
+        link->expand_ns = 0;
+    }
+    for (int i = 0; i < 256; i++)
+    {
+        compress->skip[i] = 0;
+        compress->backoff[i] = 0;
+    }
+
+    return compress;
+}
+
+void gss_compress_destroy(gss_compress_t *compress)
+{
+    delete compress;
+}
+
+const char *gss_compress_negotiate(gss_compress_t *compress, int link, bool allowed, const unsigned char *request, int request_size)
+{
+    size_t prefix_size = strlen(GSS_COMPRESS_REQUEST);
+    if (request_size < (int)prefix_size || memcmp(request, GSS_COMPRESS_REQUEST, prefix_size) != 0)
+    {
+        return NULL;
+    }
+
+    const char *codec = (const char *)request + prefix_size;
+    size_t codec_size = request_size - prefix_size;
+    while (codec_size > 0 && codec[codec_size - 1] == '\0')
+    {
+        // Sent as a C string.
+        codec_size--;
+    }
+    bool enable = allowed && compress != NULL && codec_size == 3 && memcmp(codec, "lz4", 3) == 0;
+
+    if (compress != NULL)
+    {
+        if (enable)
+        {
+            compress->links.fetch_or(1u << link, std::memory_order_acq_rel);
+        }
+        else
+        {
+            compress->links.fetch_and(~(1u << link), std::memory_order_acq_rel);
+        }
+    }
+
+    return enable ? GSS_COMPRESS_REQUEST "lz4" : GSS_COMPRESS_REQUEST "none";
+}
+
+void gss_compress_reset(gss_compress_t *compress, int link)
+{
+    if (compress != NULL)
+    {
+        compress->links.fetch_and(~(1u << link), std::memory_order_acq_rel);
+    }
+}
+
+/**
+ * @brief Tries to compress a frame's payload into a new pool buffer, in at most 1 - 1/GSS_COMPRESS_MIN_SAVING of its size.
+ *
+ * @return unsigned char* The compressed frame, or NULL if it did not shrink enough.
+ */
+static unsigned char *gss_compress_try(gss_pool_t *pool, const unsigned char *frame, size_t *compressed_size)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    size_t capacity = header->payload_size - header->payload_size / GSS_COMPRESS_MIN_SAVING;
+    if (capacity <= sizeof(gss_compress_header_t))
+    {
+        return NULL;
+    }
+
+    unsigned char *buffer = gss_pool_get(pool, GSS_FRAME_OVERHEAD + capacity);
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    unsigned char *payload = buffer + sizeof(gss_frame_header_t);
+    ssize_t block_size = gss_lz4_compress(frame + sizeof(gss_frame_header_t), header->payload_size, payload + sizeof(gss_compress_header_t), capacity - sizeof(gss_compress_header_t));
+    if (block_size < 0)
+    {
+        gss_pool_put(pool, buffer);
+        return NULL;
+    }
+
+    gss_compress_header_t *compress_header = (gss_compress_header_t *)payload;
+    compress_header->raw_size = header->payload_size;
+    compress_header->raw_crc = header->crc1;
+
+    // Only the type, size and CRCs differ from the original.
+    gss_frame_header_t *compressed_header = (gss_frame_header_t *)buffer;
+    memcpy(compressed_header, header, sizeof(gss_frame_header_t));
+    compressed_header->type |= GSS_FRAME_TYPE_COMPRESSED;
+    compressed_header->payload_size = sizeof(gss_compress_header_t) + block_size;
+    compressed_header->crc1 = gss_crc16(payload, compressed_header->payload_size);
+
+    gss_frame_footer_t *footer = (gss_frame_footer_t *)(payload + compressed_header->payload_size);
+    footer->crc2 = compressed_header->crc1;
+    footer->termination = GSS_FRAME_TERMINATION;
+
+    gss_pool_copy_stamp(buffer, frame);
+    *compressed_size = GSS_FRAME_OVERHEAD + compressed_header->payload_size;
+    return buffer;
+}
+
+unsigned char *gss_compress_frame(gss_compress_t *compress, gss_pool_t *pool, const unsigned char *frame, size_t frame_size, uint32_t links, size_t *compressed_size)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    unsigned char *compressed = NULL;
+    uint64_t elapsed_ns = 0;
+
+    if (header->payload_size >= compress->min_size && !(header->type & GSS_FRAME_TYPE_COMPRESSED))
+    {
+        uint8_t origin = header->origin;
+        uint16_t skip = compress->skip[origin].load(std::memory_order_relaxed);
+        if (skip > 0)
+        {
+            compress->skip[origin].store(skip - 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            uint64_t start_ns = gss_health_now_ns();
+            compressed = gss_compress_try(pool, frame, compressed_size);
+            elapsed_ns = gss_health_now_ns() - start_ns;
+
+            // Back off an origin whose payloads are not compressing, a little longer each time.
+            uint16_t backoff = 0;
+            if (compressed == NULL)
+            {
+                backoff = compress->backoff[origin].load(std::memory_order_relaxed) * 2;
+                backoff = backoff < GSS_COMPRESS_BACKOFF_MIN ? GSS_COMPRESS_BACKOFF_MIN : backoff > GSS_COMPRESS_BACKOFF_MAX ? GSS_COMPRESS_BACKOFF_MAX : backoff;
+            }
+            compress->backoff[origin].store(backoff, std::memory_order_relaxed);
+            compress->skip[origin].store(backoff, std::memory_order_relaxed);
+        }
+    }
+
+    size_t wire_size = compressed != NULL ? *compressed_size : frame_size;
+    while (links != 0)
+    {
+        gss_compress_link_t *link = &compress->link_stats[__builtin_ctz(links)];
+        links &= links - 1;
+
+        (compressed != NULL ? link->compressed : link->bypassed).fetch_add(1, std::memory_order_relaxed);
+        link->raw_bytes.fetch_add(frame_size, std::memory_order_relaxed);
+        link->wire_bytes.fetch_add(wire_size, std::memory_order_relaxed);
+        link->compress_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    }
+
+    return compressed;
+}
+
+unsigned char *gss_compress_expand(gss_compress_t *compress, gss_pool_t *pool, int link, const unsigned char *frame, size_t *frame_size)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    if (!(gss_compress_links(compress) & (1u << link)) || header->payload_size < (int32_t)sizeof(gss_compress_header_t))
+    {
+        return NULL;
+    }
+
+    const unsigned char *payload = frame + sizeof(gss_frame_header_t);
+    const gss_compress_header_t *compress_header = (const gss_compress_header_t *)payload;
+    if (compress_header->raw_size > GSS_FRAME_MAX_PAYLOAD_SIZE)
+    {
+        return NULL;
+    }
+
+    unsigned char *buffer = gss_pool_get(pool, GSS_FRAME_OVERHEAD + compress_header->raw_size);
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    uint64_t start_ns = gss_health_now_ns();
+    unsigned char *raw_payload = buffer + sizeof(gss_frame_header_t);
+    ssize_t raw_size = gss_lz4_decompress(payload + sizeof(gss_compress_header_t), header->payload_size - sizeof(gss_compress_header_t), raw_payload, compress_header->raw_size);
+    if (raw_size != (ssize_t)compress_header->raw_size || gss_crc16(raw_payload, raw_size) != compress_header->raw_crc)
+    {
+        gss_pool_put(pool, buffer);
+        return NULL;
+    }
+
+    gss_frame_header_t *raw_header = (gss_frame_header_t *)buffer;
+    memcpy(raw_header, header, sizeof(gss_frame_header_t));
+    raw_header->type &= ~GSS_FRAME_TYPE_COMPRESSED;
+    raw_header->payload_size = raw_size;
+    raw_header->crc1 = compress_header->raw_crc;
+
+    gss_frame_footer_t *footer = (gss_frame_footer_t *)(raw_payload + raw_size);
+    footer->crc2 = raw_header->crc1;
+    footer->termination = GSS_FRAME_TERMINATION;
+
+    gss_pool_copy_stamp(buffer, frame);
+
+    gss_compress_link_t *stats = &compress->link_stats[link];
+    stats->expanded.fetch_add(1, std::memory_order_relaxed);
+    stats->expand_ns.fetch_add(gss_health_now_ns() - start_ns, std::memory_order_relaxed);
+
+    *frame_size = GSS_FRAME_OVERHEAD + raw_size;
+    return buffer;
+}
+
+void gss_compress_get_stats(gss_compress_t *compress, int link, gss_compress_stats_t *stats)
+{
+    const gss_compress_link_t *link_stats = &compress->link_stats[link];
+
+    stats->enabled = (gss_compress_links(compress) & (1u << link)) != 0;
+    stats->compressed = link_stats->compressed.load(std::memory_order_relaxed);
+    stats->bypassed = link_stats->bypassed.load(std::memory_order_relaxed);
+    stats->raw_bytes = link_stats->raw_bytes.load(std::memory_order_relaxed);
+    stats->wire_bytes = link_stats->wire_bytes.load(std::memory_order_relaxed);
+    stats->compress_ns = link_stats->compress_ns.load(std::memory_order_relaxed);
+    stats->expanded = link_stats->expanded.load(std::memory_order_relaxed);
+    stats->expand_ns = link_stats->expand_ns.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,326 @@
+/**
+ * @file gss_crc.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * crc16(...) is the reflected CRC-16/CCITT (polynomial 0x1021, reflected 0x8408) with an initial value of 0xFFFF, inverted at the end, and then byte-swapped.
+ *
+ * The carry-less multiplication version folds the message 16 bytes (or 4 x 16 bytes) at a time. A 128-bit block V at some position is congruent, modulo the polynomial, to V_hi * x^(D-1) + V_lo * x^(D+63) placed D bits further along the message, because the operands are bit-reflected and the product of two reflected 64-bit operands comes out one bit short of a reflected 128-bit value. Once fewer than 16 bytes remain, the folded block and the tail are run through the table.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "gss_crc.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define GSS_CRC_HAVE_PCLMUL
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define GSS_CRC_HAVE_PMULL
+#endif
+
+#define GSS_CRC16_POLY_REFLECTED 0x8408
+#define GSS_CRC16_POLY_NORMAL 0x11021
+#define GSS_CRC16_CLMUL_MIN_LENGTH 64 // Below this the table is as fast, since folding has a fixed setup cost.
+
+static pthread_once_t gss_crc16_once = PTHREAD_ONCE_INIT;
+static uint16_t gss_crc16_tables[8][256];
+static gss_crc16_fn gss_crc16_dispatch = gss_crc16_table;
+static const char *gss_crc16_dispatch_name = "slice-by-8";
+
+// Fold constants, as {multiplier for the low 64 bits, multiplier for the high 64 bits}.
+static uint64_t gss_crc16_fold_128[2];
+static uint64_t gss_crc16_fold_512[2];
+
+/**
+ * @brief Computes x^n mod P(x) in normal (non-reflected) bit order.
+ *
+ */
+static uint32_t gss_crc16_xpow_mod(unsigned int n)
+{
+    uint32_t remainder = 1;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        remainder <<= 1;
+        if (remainder & 0x10000)
+        {
+            remainder ^= GSS_CRC16_POLY_NORMAL;
+        }
+    }
+    return remainder;
+}
+
+/**
+ * @brief Reflects a polynomial of degree < 16 into a 64-bit carry-less multiplication operand.
+ *
+ */
+static uint64_t gss_crc16_reflect64(uint32_t polynomial)
+{
+    uint64_t reflected = 0;
+    for (int degree = 0; degree < 16; degree++)
+    {
+        if (polynomial & (1u << degree))
+        {
+            reflected |= 1ULL << (63 - degree);
+        }
+    }
+    return reflected;
+}
+
+static void gss_crc16_init()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ GSS_CRC16_POLY_REFLECTED : crc >> 1;
+        }
+        gss_crc16_tables[0][i] = crc;
+    }
+
+    for (int k = 1; k < 8; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint16_t previous = gss_crc16_tables[k - 1][i];
+            gss_crc16_tables[k][i] = (previous >> 8) ^ gss_crc16_tables[0][previous & 0xff];
+        }
+    }
+
+    gss_crc16_fold_128[0] = gss_crc16_reflect64(gss_crc16_xpow_mod(128 + 63));
+    gss_crc16_fold_128[1] = gss_crc16_reflect64(gss_crc16_xpow_mod(128 - 1));
+    gss_crc16_fold_512[0] = gss_crc16_reflect64(gss_crc16_xpow_mod(512 + 63));
+    gss_crc16_fold_512[1] = gss_crc16_reflect64(gss_crc16_xpow_mod(512 - 1));
+
+    if (gss_crc16_clmul_supported())
+    {
+        gss_crc16_dispatch = gss_crc16_clmul;
+#if defined(GSS_CRC_HAVE_PMULL)
+        gss_crc16_dispatch_name = "pmull";
+#else
+        gss_crc16_dispatch_name = "clmul";
+#endif
+    }
+}
+
+/**
+ * @brief Runs the raw CRC register over the data, eight bytes per step.
+ *
+ */
+static uint16_t gss_crc16_update(uint16_t crc, const unsigned char *data, size_t length)
+{
+    while (length >= 8)
+    {
+        crc ^= data[0] | (data[1] << 8);
+        crc = gss_crc16_tables[7][crc & 0xff] ^ gss_crc16_tables[6][crc >> 8] ^
+              gss_crc16_tables[5][data[2]] ^ gss_crc16_tables[4][data[3]] ^
+              gss_crc16_tables[3][data[4]] ^ gss_crc16_tables[2][data[5]] ^
+              gss_crc16_tables[1][data[6]] ^ gss_crc16_tables[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+    {
+        crc = (crc >> 8) ^ gss_crc16_tables[0][(crc ^ *data++) & 0xff];
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Applies crc16(...)'s final inversion and byte swap to the raw register.
+ *
+ */
+static inline uint16_t gss_crc16_finalize(uint16_t crc)
+{
+    crc = ~crc;
+    return (uint16_t)((crc << 8) | (crc >> 8));
+}
+
+uint16_t gss_crc16_table(const unsigned char *data, size_t length)
+{
+    pthread_once(&gss_crc16_once, gss_crc16_init);
+    return gss_crc16_finalize(gss_crc16_update(0xffff, data, length));
+}
+
+#if defined(GSS_CRC_HAVE_PCLMUL)
+
+__attribute__((target("pclmul,sse2"))) static inline __m128i gss_crc16_fold(__m128i block, __m128i constants)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00), _mm_clmulepi64_si128(block, constants, 0x11));
+}
+
+__attribute__((target("pclmul,sse2"))) uint16_t gss_crc16_clmul(const unsigned char *data, size_t length)
+{
+    pthread_once(&gss_crc16_once, gss_crc16_init);
+
+    if (length < GSS_CRC16_CLMUL_MIN_LENGTH)
+    {
+        return gss_crc16_table(data, length);
+    }
+
+    const __m128i fold_128 = _mm_set_epi64x(gss_crc16_fold_128[1], gss_crc16_fold_128[0]);
+
+    // XORing the initial value into the first two bytes is equivalent to starting the register at 0xFFFF.
+    __m128i block = _mm_xor_si128(_mm_loadu_si128((const __m128i *)data), _mm_cvtsi32_si128(0xffff));
+
+    if (length >= 128)
+    {
+        const __m128i fold_512 = _mm_set_epi64x(gss_crc16_fold_512[1], gss_crc16_fold_512[0]);
+        __m128i lane1 = _mm_loadu_si128((const __m128i *)(data + 16));
+        __m128i lane2 = _mm_loadu_si128((const __m128i *)(data + 32));
+        __m128i lane3 = _mm_loadu_si128((const __m128i *)(data + 48));
+        data += 64;
+        length -= 64;
+
+        while (length >= 64)
+        {
+            block = _mm_xor_si128(gss_crc16_fold(block, fold_512), _mm_loadu_si128((const __m128i *)data));
+            lane1 = _mm_xor_si128(gss_crc16_fold(lane1, fold_512), _mm_loadu_si128((const __m128i *)(data + 16)));
+            lane2 = _mm_xor_si128(gss_crc16_fold(lane2, fold_512), _mm_loadu_si128((const __m128i *)(data + 32)));
+            lane3 = _mm_xor_si128(gss_crc16_fold(lane3, fold_512), _mm_loadu_si128((const __m128i *)(data + 48)));
+            data += 64;
+            length -= 64;
+        }
+
+        block = _mm_xor_si128(gss_crc16_fold(block, fold_128), lane1);
+        block = _mm_xor_si128(gss_crc16_fold(block, fold_128), lane2);
+        block = _mm_xor_si128(gss_crc16_fold(block, fold_128), lane3);
+    }
+    else
+    {
+        data += 16;
+        length -= 16;
+    }
+
+    while (length >= 16)
+    {
+        block = _mm_xor_si128(gss_crc16_fold(block, fold_128), _mm_loadu_si128((const __m128i *)data));
+        data += 16;
+        length -= 16;
+    }
+
+    unsigned char folded[16];
+    _mm_storeu_si128((__m128i *)folded, block);
+
+    return gss_crc16_finalize(gss_crc16_update(gss_crc16_update(0x0, folded, sizeof(folded)), data, length));
+}
+
+bool gss_crc16_clmul_supported()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (ecx & bit_PCLMUL) && (edx & bit_SSE2);
+}
+
+#elif defined(GSS_CRC_HAVE_PMULL)
+
+static inline uint64x2_t gss_crc16_fold(uint64x2_t block, const uint64_t *constants)
+{
+    poly128_t low = vmull_p64((poly64_t)vgetq_lane_u64(block, 0), (poly64_t)constants[0]);
+    poly128_t high = vmull_p64((poly64_t)vgetq_lane_u64(block, 1), (poly64_t)constants[1]);
+    return veorq_u64(vreinterpretq_u64_p128(low), vreinterpretq_u64_p128(high));
+}
+
+static inline uint64x2_t gss_crc16_load(const unsigned char *data)
+{
+    return vreinterpretq_u64_u8(vld1q_u8(data));
+}
+
+uint16_t gss_crc16_clmul(const unsigned char *data, size_t length)
+{
+    pthread_once(&gss_crc16_once, gss_crc16_init);
+
+    if (length < GSS_CRC16_CLMUL_MIN_LENGTH)
+    {
+        return gss_crc16_table(data, length);
+    }
+
+    // XORing the initial value into the first two bytes is equivalent to starting the register at 0xFFFF.
+    uint64x2_t block = veorq_u64(gss_crc16_load(data), vsetq_lane_u64(0xffff, vdupq_n_u64(0), 0));
+
+    if (length >= 128)
+    {
+        uint64x2_t lane1 = gss_crc16_load(data + 16);
+        uint64x2_t lane2 = gss_crc16_load(data + 32);
+        uint64x2_t lane3 = gss_crc16_load(data + 48);
+        data += 64;
+        length -= 64;
+
+        while (length >= 64)
+        {
+            block = veorq_u64(gss_crc16_fold(block, gss_crc16_fold_512), gss_crc16_load(data));
+            lane1 = veorq_u64(gss_crc16_fold(lane1, gss_crc16_fold_512), gss_crc16_load(data + 16));
+            lane2 = veorq_u64(gss_crc16_fold(lane2, gss_crc16_fold_512), gss_crc16_load(data + 32));
+            lane3 = veorq_u64(gss_crc16_fold(lane3, gss_crc16_fold_512), gss_crc16_load(data + 48));
+            data += 64;
+            length -= 64;
+        }
+
+        block = veorq_u64(gss_crc16_fold(block, gss_crc16_fold_128), lane1);
+        block = veorq_u64(gss_crc16_fold(block, gss_crc16_fold_128), lane2);
+        block = veorq_u64(gss_crc16_fold(block, gss_crc16_fold_128), lane3);
+    }
+    else
+    {
+        data += 16;
+        length -= 16;
+    }
+
+    while (length >= 16)
+    {
+        block = veorq_u64(gss_crc16_fold(block, gss_crc16_fold_128), gss_crc16_load(data));
+        data += 16;
+        length -= 16;
+    }
+
+    unsigned char folded[16];
+    vst1q_u8(folded, vreinterpretq_u8_u64(block));
+
+    return gss_crc16_finalize(gss_crc16_update(gss_crc16_update(0x0, folded, sizeof(folded)), data, length));
+}
+
+bool gss_crc16_clmul_supported()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+}
+
+#else
+
+uint16_t gss_crc16_clmul(const unsigned char *data, size_t length)
+{
+    return gss_crc16_table(data, length);
+}
+
+bool gss_crc16_clmul_supported()
+{
+    return false;
+}
+
+#endif
+
+uint16_t gss_crc16(const unsigned char *data, size_t length)
+{
+    pthread_once(&gss_crc16_once, gss_crc16_init);
+    return gss_crc16_dispatch(data, length);
+}
+
+const char *gss_crc16_implementation()
+{
+    pthread_once(&gss_crc16_once, gss_crc16_init);
+    return gss_crc16_dispatch_name;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file gss_dedup.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <string.h>
+#include "gss_dedup.hpp"
+#include "gss_frame.hpp"
+
+#define GSS_DEDUP_PRIME_1 0x9e3779b97f4a7c15ULL
+#define GSS_DEDUP_PRIME_2 0xc2b2ae3d27d4eb4fULL
+
+static inline uint64_t gss_dedup_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t gss_dedup_round(uint64_t lane, uint64_t word)
+{
+    return gss_dedup_rotl(lane ^ (word * GSS_DEDUP_PRIME_2), 31) * GSS_DEDUP_PRIME_1;
+}
+
+/**
+ * @brief 64-bit hash of a payload, eight bytes per step in four independent lanes so it runs near memory speed. Not cryptographic; it only has to tell apart frames that crc1 does not.
+ *
+ */
+static uint64_t gss_dedup_hash(const unsigned char *data, size_t length)
+{
+    uint64_t lanes[4] = {GSS_DEDUP_PRIME_1, GSS_DEDUP_PRIME_2, ~GSS_DEDUP_PRIME_1, ~GSS_DEDUP_PRIME_2};
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32)
+    {
+        for (int l = 0; l < 4; l++)
+        {
+            uint64_t word;
+            memcpy(&word, data + i + l * 8, sizeof(word));
+            lanes[l] = gss_dedup_round(lanes[l], word);
+        }
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        lanes[0] = gss_dedup_round(lanes[0], word);
+    }
+    if (i < length)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, length - i);
+        lanes[1] = gss_dedup_round(lanes[1], word);
+    }
+
+    uint64_t hash = length * GSS_DEDUP_PRIME_1;
+    for (int l = 0; l < 4; l++)
+    {
+        hash = gss_dedup_round(hash, lanes[l]);
+    }
+    hash ^= hash >> 29;
+    hash *= GSS_DEDUP_PRIME_2;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+gss_dedup_t *gss_dedup_create(int window_ms)
+{
+    gss_dedup_t *dedup = new gss_dedup_t;
+
+    pthread_mutex_init(&dedup->lock, NULL);
+    dedup->window_ns = (uint64_t)window_ms * 1000000ULL;
+    memset(dedup->entries, 0, sizeof(dedup->entries));
+    dedup->hits = 0;
+    dedup->misses = 0;
+
+    return dedup;
+}
+
+void gss_dedup_destroy(gss_dedup_t *dedup)
+{
+    pthread_mutex_destroy(&dedup->lock);
+    delete dedup;
+}
+
+bool gss_dedup_check(gss_dedup_t *dedup, const unsigned char *frame, uint64_t now_ns)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+
+    // Hashed outside the lock; it is the only part that scales with the payload.
+    uint64_t hash = gss_dedup_hash(frame + sizeof(gss_frame_header_t), header->payload_size);
+
+    pthread_mutex_lock(&dedup->lock);
+
+    gss_dedup_entry_t *victim = NULL;
+    uint64_t victim_seen_ns = UINT64_MAX;
+    for (int p = 0; p < GSS_DEDUP_PROBES; p++)
+    {
+        gss_dedup_entry_t *entry = &dedup->entries[(hash + p) & (GSS_DEDUP_SLOTS - 1)];
+        bool live = entry->seen_ns != 0 && now_ns - entry->seen_ns < dedup->window_ns;
+
+        if (live && entry->hash == hash && entry->crc1 == header->crc1 && entry->payload_size == (uint32_t)header->payload_size &&
+            entry->type == header->type && entry->destination == header->destination)
+        {
+            pthread_mutex_unlock(&dedup->lock);
+            dedup->hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // An expired slot is as good as an empty one; otherwise the oldest makes room.
+        uint64_t seen_ns = live ? entry->seen_ns : 0;
+        if (seen_ns < victim_seen_ns)
+        {
+            victim = entry;
+            victim_seen_ns = seen_ns;
+        }
+    }
+
+    victim->hash = hash;
+    victim->seen_ns = now_ns;
+    victim->payload_size = header->payload_size;
+    victim->type = header->type;
+    victim->crc1 = header->crc1;
+    victim->destination = header->destination;
+
+    pthread_mutex_unlock(&dedup->lock);
+    dedup->misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void gss_dedup_get_stats(gss_dedup_t *dedup, gss_dedup_stats_t *stats)
+{
+    stats->hits = dedup->hits.load(std::memory_order_relaxed);
+    stats->misses = dedup->misses.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,493 @@
+/**
+ * @file gss_frame.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include "gss.hpp"
+#include "gss_frame.hpp"
+#include "gss_crc.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+ssize_t gss_frame_recv_stamped(int socket, unsigned char *buffer, size_t size, int flags, uint64_t *kernel_ns)
+{
+    if (kernel_ns == NULL)
+    {
+        return recv(socket, buffer, size, flags);
+    }
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(struct scm_timestamping))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t read_size = recvmsg(socket, &message, flags);
+
+    *kernel_ns = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); read_size > 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+        {
+            // ts[0] is the software timestamp; ts[2] would be the NIC's, in its own clock.
+            struct scm_timestamping timestamps;
+            memcpy(&timestamps, CMSG_DATA(cmsg), sizeof(timestamps));
+            *kernel_ns = (uint64_t)timestamps.ts[0].tv_sec * 1000000000ULL + timestamps.ts[0].tv_nsec;
+        }
+    }
+
+    return read_size;
+}
+
+/**
+ * @brief Reads exactly size bytes from a blocking socket.
+ *
+ * @param kernel_ns Set to the receive timestamp of the first read, as by gss_frame_recv_stamped(...); may be NULL.
+ * @param received Set to the bytes read, also on failure; may be NULL.
+ * @return ssize_t 0 on success, -404 if the peer closed the connection, or -1 on error.
+ */
+static ssize_t gss_frame_recv_all(int socket, unsigned char *buffer, size_t size, uint64_t *kernel_ns, size_t *received)
+{
+    size_t total = 0;
+    ssize_t retval = 0;
+
+    while (total < size)
+    {
+        ssize_t read_size = gss_frame_recv_stamped(socket, buffer + total, size - total, MSG_WAITALL, total == 0 ? kernel_ns : NULL);
+
+        if (read_size == 0)
+        {
+            retval = -404;
+            break;
+        }
+        else if (read_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            retval = -1;
+            break;
+        }
+
+        total += read_size;
+    }
+
+    if (received != NULL)
+    {
+        *received = total;
+    }
+
+    return retval;
+}
+
+void gss_frame_decoder_reset(gss_frame_decoder_t *decoder)
+{
+    decoder->length = 0;
+}
+
+ssize_t gss_frame_decoder_fill(gss_frame_decoder_t *decoder, int socket, uint64_t *kernel_ns)
+{
+    size_t space = sizeof(decoder->buffer) - decoder->length;
+
+    if (space == 0)
+    {
+        // Should never happen, a full buffer always holds a complete (or invalid) frame.
+        return 0;
+    }
+
+    ssize_t read_size = gss_frame_recv_stamped(socket, decoder->buffer + decoder->length, space, MSG_DONTWAIT, kernel_ns);
+
+    if (read_size == 0)
+    {
+        return -404;
+    }
+    else if (read_size < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return 0;
+        }
+        return -1;
+    }
+
+    decoder->length += read_size;
+    return read_size;
+}
+
+/**
+ * @brief Checks the footer of a frame whose payload has been received: its termination, and both CRCs against the payload.
+ *
+ */
+static bool gss_frame_footer_valid(const gss_frame_header_t *header, const gss_frame_footer_t *footer, const unsigned char *payload)
+{
+    return footer->termination == GSS_FRAME_TERMINATION && footer->crc2 == header->crc1 && gss_crc16(payload, header->payload_size) == header->crc1;
+}
+
+/**
+ * @brief Checks whether a header's GUID and payload size are plausible.
+ *
+ */
+static bool gss_frame_header_valid(const gss_frame_header_t *header)
+{
+    return header->guid == GSS_FRAME_GUID && header->payload_size >= 0 && header->payload_size <= GSS_FRAME_MAX_PAYLOAD_SIZE;
+}
+
+ssize_t gss_frame_check(const unsigned char *data, size_t length)
+{
+    if (length < sizeof(gss_frame_header_t))
+    {
+        return 0;
+    }
+
+    const gss_frame_header_t *header = (const gss_frame_header_t *)data;
+
+    if (!gss_frame_header_valid(header))
+    {
+        return -1;
+    }
+
+    size_t frame_size = GSS_FRAME_OVERHEAD + header->payload_size;
+
+    if (length < frame_size)
+    {
+        return 0;
+    }
+
+    const gss_frame_footer_t *footer = (const gss_frame_footer_t *)(data + sizeof(gss_frame_header_t) + header->payload_size);
+
+    if (!gss_frame_footer_valid(header, footer, data + sizeof(gss_frame_header_t)))
+    {
+        return -1;
+    }
+
+    return frame_size;
+}
+
+size_t gss_frame_resync(const unsigned char *data, size_t length)
+{
+    // The GUID is written little-endian, so its low byte comes first.
+    const unsigned char first = GSS_FRAME_GUID & 0xff;
+    const unsigned char second = GSS_FRAME_GUID >> 8;
+
+    size_t offset = 1;
+    while (offset < length)
+    {
+        const unsigned char *match = (const unsigned char *)memchr(data + offset, first, length - offset);
+        if (match == NULL)
+        {
+            return length;
+        }
+
+        offset = match - data;
+        if (offset + 1 == length || data[offset + 1] == second)
+        {
+            return offset;
+        }
+        offset++;
+    }
+
+    return length;
+}
+
+ssize_t gss_frame_decoder_peek(gss_frame_decoder_t *decoder)
+{
+    return gss_frame_check(decoder->buffer, decoder->length);
+}
+
+size_t gss_frame_decoder_resync(gss_frame_decoder_t *decoder)
+{
+    size_t skipped = gss_frame_resync(decoder->buffer, decoder->length);
+    gss_frame_decoder_consume(decoder, skipped);
+    return skipped;
+}
+
+void gss_frame_decoder_consume(gss_frame_decoder_t *decoder, size_t size)
+{
+    if (size >= decoder->length)
+    {
+        decoder->length = 0;
+        return;
+    }
+
+    memmove(decoder->buffer, decoder->buffer + size, decoder->length - size);
+    decoder->length -= size;
+}
+
+ssize_t gss_frame_decoder_recv(gss_frame_decoder_t *decoder, int socket, size_t *skipped)
+{
+    *skipped = 0;
+
+    while (decoder->length > 0)
+    {
+        ssize_t frame_size = gss_frame_decoder_peek(decoder);
+        if (frame_size > 0)
+        {
+            return frame_size;
+        }
+        else if (frame_size < 0)
+        {
+            *skipped += gss_frame_decoder_resync(decoder);
+            continue;
+        }
+
+        // Only what the frame at the front still needs, so that nothing after it is taken off of the stream.
+        const gss_frame_header_t *header = (const gss_frame_header_t *)decoder->buffer;
+        size_t needed = decoder->length < sizeof(gss_frame_header_t) ? sizeof(gss_frame_header_t) : GSS_FRAME_OVERHEAD + header->payload_size;
+        size_t received;
+        ssize_t retval = gss_frame_recv_all(socket, decoder->buffer + decoder->length, needed - decoder->length, NULL, &received);
+        decoder->length += received;
+
+        if (retval < 0 && errno == EAGAIN)
+        {
+            // The rest never came, so it was no frame; most likely its payload size was corrupt.
+            *skipped += gss_frame_decoder_resync(decoder);
+        }
+        else if (retval < 0)
+        {
+            return retval;
+        }
+    }
+
+    return 0;
+}
+
+ssize_t gss_frame_recv_header(int socket, gss_frame_header_t *header, size_t *skipped, uint64_t *kernel_ns)
+{
+    unsigned char *bytes = (unsigned char *)header;
+    size_t total_skipped = 0;
+
+    ssize_t retval = gss_frame_recv_all(socket, bytes, sizeof(gss_frame_header_t), kernel_ns, NULL);
+
+    // Slide along the stream until a plausible header lines up.
+    while (retval == 0 && !gss_frame_header_valid(header))
+    {
+        size_t skip = gss_frame_resync(bytes, sizeof(gss_frame_header_t));
+        memmove(bytes, bytes + skip, sizeof(gss_frame_header_t) - skip);
+        total_skipped += skip;
+        retval = gss_frame_recv_all(socket, bytes + sizeof(gss_frame_header_t) - skip, skip, NULL, NULL);
+    }
+
+    if (skipped != NULL)
+    {
+        *skipped = total_skipped;
+    }
+
+    return retval < 0 ? retval : sizeof(gss_frame_header_t);
+}
+
+/**
+ * @brief Leaves what was received of a rejected frame in the decoder, for the caller to resynchronize on.
+ *
+ */
+static void gss_frame_reject(gss_frame_decoder_t *decoder, const unsigned char *frame, size_t size)
+{
+    if (decoder == NULL)
+    {
+        return;
+    }
+
+    memcpy(decoder->buffer, frame, size);
+    decoder->length = size;
+}
+
+ssize_t gss_frame_recv_body(int socket, const gss_frame_header_t *header, gss_pool_t *pool, unsigned char **frame, gss_frame_decoder_t *decoder)
+{
+    size_t frame_size = GSS_FRAME_OVERHEAD + header->payload_size;
+    unsigned char *buffer = gss_pool_get(pool, frame_size);
+    if (buffer == NULL)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(buffer, header, sizeof(gss_frame_header_t));
+
+    size_t received;
+    ssize_t retval = gss_frame_recv_all(socket, buffer + sizeof(gss_frame_header_t), frame_size - sizeof(gss_frame_header_t), NULL, &received);
+    if (retval < 0)
+    {
+        int error = errno;
+        gss_frame_reject(decoder, buffer, sizeof(gss_frame_header_t) + received);
+        gss_pool_put(pool, buffer);
+        errno = error;
+        return retval;
+    }
+
+    if (gss_frame_check(buffer, frame_size) < 0)
+    {
+        gss_frame_reject(decoder, buffer, frame_size);
+        gss_pool_put(pool, buffer);
+        errno = EBADMSG;
+        return -1;
+    }
+
+    *frame = buffer;
+    return frame_size;
+}
+
+ssize_t gss_frame_discard_body(int socket, const gss_frame_header_t *header, gss_frame_decoder_t *decoder)
+{
+    size_t frame_size = GSS_FRAME_OVERHEAD + header->payload_size;
+
+    memcpy(decoder->buffer, header, sizeof(gss_frame_header_t));
+
+    size_t received;
+    ssize_t retval = gss_frame_recv_all(socket, decoder->buffer + sizeof(gss_frame_header_t), frame_size - sizeof(gss_frame_header_t), NULL, &received);
+    if (retval < 0)
+    {
+        decoder->length = sizeof(gss_frame_header_t) + received;
+        return retval;
+    }
+
+    if (gss_frame_check(decoder->buffer, frame_size) < 0)
+    {
+        decoder->length = frame_size;
+        errno = EBADMSG;
+        return -1;
+    }
+
+    gss_frame_decoder_reset(decoder);
+    return frame_size;
+}
+
+void gss_frame_print(const unsigned char *frame)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    const gss_frame_footer_t *footer = (const gss_frame_footer_t *)(frame + sizeof(gss_frame_header_t) + header->payload_size);
+
+    dbdebuglf(BLUE_FG "    GUID ------------ 0x%04x", header->guid);
+    dbdebuglf(BLUE_FG "    Type ------------ %d", (int)header->type);
+    dbdebuglf(BLUE_FG "    Origin ---------- %d", (int)header->origin);
+    dbdebuglf(BLUE_FG "    Destination ----- %d", (int)header->destination);
+    dbdebuglf(BLUE_FG "    Payload Size ---- %d", header->payload_size);
+    dbdebuglf(BLUE_FG "    CRC1 ------------ 0x%04x", header->crc1);
+    dbdebuglf(BLUE_FG "    NetStat --------- 0x%02x", header->netstat);
+    dbdebuglf(BLUE_FG "    CRC2 ------------ 0x%04x", footer->crc2);
+    dbdebuglf(BLUE_FG "    Termination ----- 0x%04x", footer->termination);
+}
+
+ssize_t gss_frame_build(unsigned char *buffer, NetType type, NetVertex origin, NetVertex destination, uint8_t netstat, const unsigned char *payload, int payload_size)
+{
+    if (payload_size < 0 || payload_size > GSS_FRAME_MAX_PAYLOAD_SIZE)
+    {
+        return -1;
+    }
+
+    gss_frame_header_t *header = (gss_frame_header_t *)buffer;
+    header->guid = GSS_FRAME_GUID;
+    header->crc1 = gss_crc16(payload, payload_size);
+    header->type = (uint32_t)type;
+    header->origin = (uint8_t)origin;
+    header->destination = (uint8_t)destination;
+    header->payload_size = payload_size;
+    header->netstat = netstat;
+
+    if (payload_size > 0)
+    {
+        memcpy(buffer + sizeof(gss_frame_header_t), payload, payload_size);
+    }
+
+    gss_frame_footer_t *footer = (gss_frame_footer_t *)(buffer + sizeof(gss_frame_header_t) + payload_size);
+    footer->crc2 = header->crc1;
+    footer->termination = GSS_FRAME_TERMINATION;
+
+    return GSS_FRAME_OVERHEAD + payload_size;
+}
+
+ssize_t gss_frame_send(int socket, const unsigned char *frame, size_t size)
+{
+    size_t sent = 0;
+
+    while (sent < size)
+    {
+        ssize_t send_size = send(socket, frame + sent, size - sent, MSG_NOSIGNAL);
+
+        if (send_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        sent += send_size;
+    }
+
+    return sent;
+}
+
+ssize_t gss_frame_send_stamped(int socket, const unsigned char *frame, size_t size, int *stamps)
+{
+    size_t sent = 0;
+    *stamps = 0;
+
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(uint32_t))];
+        struct cmsghdr align;
+    } control;
+
+    while (sent < size)
+    {
+        struct iovec iov;
+        iov.iov_base = (void *)(frame + sent);
+        iov.iov_len = size - sent;
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        // Asks for this write alone to be timestamped as its last packet reaches the driver.
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SO_TIMESTAMPING;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+        uint32_t flags = SOF_TIMESTAMPING_TX_SOFTWARE;
+        memcpy(CMSG_DATA(cmsg), &flags, sizeof(flags));
+
+        ssize_t send_size = sendmsg(socket, &message, MSG_NOSIGNAL);
+
+        if (send_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        sent += send_size;
+        (*stamps)++;
+    }
+
+    return sent;
+}
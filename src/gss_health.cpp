@@ -0,0 +1,136 @@
+/**
+ * @file gss_health.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "gss.hpp"
+#include "gss_health.hpp"
+#include "gss_frame.hpp"
+#include "gss_txq.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+int gss_health_parse_keepalive(const char *arg, gss_health_config_t *config)
+{
+    int idle, interval, count;
+    if (sscanf(arg, "%d,%d,%d", &idle, &interval, &count) != 3 || idle < 1 || interval < 1 || count < 1)
+    {
+        return -1;
+    }
+
+    config->keepalive_idle_s = idle;
+    config->keepalive_interval_s = interval;
+    config->keepalive_count = count;
+    return 1;
+}
+
+int gss_health_parse_heartbeat(const char *arg, gss_health_config_t *config)
+{
+    int interval, misses = GSS_HEALTH_DEFAULT_MISSES;
+    if (sscanf(arg, "%d,%d", &interval, &misses) < 1 || interval < 1 || misses < 1)
+    {
+        return -1;
+    }
+
+    config->heartbeat_ms = interval;
+    config->heartbeat_misses = misses;
+    return 1;
+}
+
+int gss_health_configure_socket(int socket, const gss_health_config_t *config)
+{
+    int retval = 1;
+
+    if (config->keepalive_idle_s > 0)
+    {
+        int enable = 1;
+        if (setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable)) < 0 ||
+            setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &config->keepalive_idle_s, sizeof(int)) < 0 ||
+            setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &config->keepalive_interval_s, sizeof(int)) < 0 ||
+            setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT, &config->keepalive_count, sizeof(int)) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not enable keepalive: %s", strerror(errno));
+            retval = -1;
+        }
+    }
+
+    if (config->user_timeout_ms > 0)
+    {
+        unsigned int timeout = config->user_timeout_ms;
+        if (setsockopt(socket, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, sizeof(timeout)) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not set user timeout: %s", strerror(errno));
+            retval = -1;
+        }
+    }
+
+    return retval;
+}
+
+void *gss_health_thread(void *global_vp)
+{
+    global_data_t *global = (global_data_t *)global_vp;
+    gss_health_config_t *config = &global->health;
+
+    uint64_t deadline_ns = (uint64_t)config->heartbeat_ms * config->heartbeat_misses * 1000000ULL;
+
+    struct timespec interval;
+    interval.tv_sec = config->heartbeat_ms / 1000;
+    interval.tv_nsec = (config->heartbeat_ms % 1000) * 1000000L;
+
+    dbinfolf("[HEALTH] Heartbeat every %d ms, disconnecting after %d silent intervals.", config->heartbeat_ms, config->heartbeat_misses);
+
+    while (config->active)
+    {
+        nanosleep(&interval, NULL);
+
+        uint8_t netstat = gss_netstat(global);
+        uint64_t now = gss_health_now_ns();
+
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (!gss_is_connected(global, i))
+            {
+                continue;
+            }
+
+            if (now - global->last_rx_ns[i].load(std::memory_order_relaxed) > deadline_ns)
+            {
+                dbwarnlf(YELLOW_BG "[HEALTH] Nothing from ID:%d for %d heartbeats, disconnecting.", i, config->heartbeat_misses);
+
+                // Stop routing to it now; the receiving side sees the shutdown as a closed connection and cleans up as usual.
+                gss_set_connected(global, i, false);
+                gss_txq_shutdown_socket(global->txq[i], SHUT_RDWR);
+                continue;
+            }
+
+            unsigned char *heartbeat = gss_pool_get(global->pool, GSS_FRAME_OVERHEAD);
+            if (heartbeat == NULL)
+            {
+                continue;
+            }
+            ssize_t heartbeat_size = gss_frame_build(heartbeat, NetType::POLL, (NetVertex)global->topology.server_id, gss_vertex_id(global, i), netstat, NULL, 0);
+            if (heartbeat_size < 0)
+            {
+                gss_pool_put(global->pool, heartbeat);
+                continue;
+            }
+            gss_txq_push(global->txq[i], heartbeat, heartbeat_size);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,436 @@
+/**
+ * @file gss_latency.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include "gss_latency.hpp"
+#include "gss_frame.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_LATENCY_WRITER_TICK_MS 500 // How often an idle trace writer checks whether it should exit.
+
+static_assert(sizeof(gss_latency_sample_t) <= GSS_POOL_MAX_SIZE, "A sample must fit in a pool buffer.");
+
+// The point each hop starts at; each ends at the next, except that kernel tx ends at GSS_LATENCY_SENT if there is no transmit timestamp.
+static const int gss_latency_hop_start[GSS_LATENCY_NUM_HOPS] = {GSS_LATENCY_KERNEL_RX, GSS_LATENCY_RECEIVED, GSS_LATENCY_PARSED, GSS_LATENCY_ROUTED, GSS_LATENCY_DEQUEUED};
+
+/**
+ * @brief The point a sample's hop ends at.
+ *
+ */
+static int gss_latency_hop_end(const gss_latency_sample_t *sample, int hop)
+{
+    if (hop == GSS_LATENCY_HOP_KERNEL_TX)
+    {
+        return sample->times[GSS_LATENCY_KERNEL_TX] != 0 ? GSS_LATENCY_KERNEL_TX : GSS_LATENCY_SENT;
+    }
+    return gss_latency_hop_start[hop] + 1;
+}
+
+/**
+ * @brief Names the vertex with an ID, for the trace.
+ *
+ */
+static const char *gss_latency_vertex_name(const gss_topology_t *topology, uint8_t id)
+{
+    int vertex = gss_topology_route(topology, id);
+    return vertex >= 0 ? topology->vertices[vertex].name : vertex == GSS_ROUTE_SERVER ? "server" : "unknown";
+}
+
+gss_latency_t *gss_latency_create(int every, const char *path, bool kernel_tx, const gss_topology_t *topology, gss_pool_t *pool)
+{
+    FILE *file = NULL;
+    if (path != NULL)
+    {
+        file = fopen(path, "we");
+        if (file == NULL)
+        {
+            dberrorlf(RED_FG "Could not open trace file %s (%d).", path, errno);
+            return NULL;
+        }
+    }
+
+    gss_latency_t *latency = new gss_latency_t;
+    latency->every = every;
+    latency->kernel_tx = kernel_tx;
+    latency->topology = topology;
+    latency->pool = pool;
+    latency->file = file;
+    latency->start_ns = gss_latency_now_ns();
+    latency->written = false;
+    gss_ring_init(&latency->ring, GSS_LATENCY_QUEUE_CAPACITY);
+    sem_init(&latency->samples, 0, 0);
+    latency->active = true;
+
+    latency->next_id = 0;
+    latency->samples_done = 0;
+    latency->kernel_rx = 0;
+    latency->kernel_tx_done = 0;
+    latency->traced = 0;
+    latency->dropped = 0;
+    for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+    {
+        latency->hop_count[h] = 0;
+        latency->hop_ns[h] = 0;
+    }
+    latency->total_ns = 0;
+
+    // A JSON array of events; the closing bracket is optional, so the file can be read while it is still being written.
+    if (file != NULL)
+    {
+        fprintf(file, "[\n");
+        for (int v = 0; v < topology->num_vertices; v++)
+        {
+            fprintf(file, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"to %s\"}}", latency->written ? ",\n" : "", v, topology->vertices[v].name);
+            latency->written = true;
+        }
+        fflush(file);
+    }
+
+    return latency;
+}
+
+void gss_latency_destroy(gss_latency_t *latency)
+{
+    unsigned char *sample;
+    size_t size;
+    while (gss_ring_pop(&latency->ring, &sample, &size))
+    {
+        gss_pool_put(latency->pool, sample);
+    }
+    gss_ring_free(&latency->ring);
+    sem_destroy(&latency->samples);
+
+    if (latency->file != NULL)
+    {
+        fclose(latency->file);
+    }
+
+    delete latency;
+}
+
+int gss_latency_parse(char *arg, int *every, const char **path)
+{
+    *path = NULL;
+
+    char *separator = strchr(arg, ',');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+        *path = separator + 1;
+    }
+
+    *every = atoi(arg);
+    if (*every < 1 || (*path != NULL && (*path)[0] == '\0'))
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+int gss_latency_configure_socket(int socket)
+{
+    // Transmit timestamps are only generated for the writes which ask for them; these flags only have the kernel report them.
+    uint32_t flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+    {
+        dbwarnlf(YELLOW_FG "Could not enable kernel timestamps: %s", strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+unsigned char *gss_latency_dequeued(gss_latency_t *latency, const unsigned char *frame, size_t frame_size, int connection)
+{
+    if (latency == NULL)
+    {
+        return NULL;
+    }
+
+    const uint64_t *times = gss_pool_times(frame);
+    if (times[GSS_LATENCY_RECEIVED] == 0)
+    {
+        return NULL;
+    }
+
+    unsigned char *buffer = gss_pool_get(latency->pool, sizeof(gss_latency_sample_t));
+    if (buffer == NULL)
+    {
+        latency->dropped++;
+        return NULL;
+    }
+
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    gss_latency_sample_t *sample = (gss_latency_sample_t *)buffer;
+    memset(sample, 0, sizeof(gss_latency_sample_t));
+    memcpy(sample->times, times, GSS_POOL_NUM_TIMES * sizeof(uint64_t));
+    sample->times[GSS_LATENCY_DEQUEUED] = gss_latency_now_ns();
+    sample->id = ++latency->next_id;
+    sample->type = header->type;
+    sample->frame_size = frame_size;
+    sample->origin = header->origin;
+    sample->destination = header->destination;
+    sample->connection = connection;
+
+    return buffer;
+}
+
+/**
+ * @brief Adds a sample's hops to the counters, then queues it for the trace writer or returns it to the pool.
+ *
+ */
+static void gss_latency_finish(gss_latency_t *latency, unsigned char *buffer)
+{
+    gss_latency_sample_t *sample = (gss_latency_sample_t *)buffer;
+    const uint64_t *times = sample->times;
+
+    for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+    {
+        uint64_t start = times[gss_latency_hop_start[h]], end = times[gss_latency_hop_end(sample, h)];
+        if (start != 0 && end >= start)
+        {
+            latency->hop_count[h]++;
+            latency->hop_ns[h] += end - start;
+        }
+    }
+
+    uint64_t first = times[GSS_LATENCY_KERNEL_RX] != 0 ? times[GSS_LATENCY_KERNEL_RX] : times[GSS_LATENCY_RECEIVED];
+    uint64_t last = times[GSS_LATENCY_KERNEL_TX] > times[GSS_LATENCY_SENT] ? times[GSS_LATENCY_KERNEL_TX] : times[GSS_LATENCY_SENT];
+    if (last >= first)
+    {
+        latency->total_ns += last - first;
+    }
+
+    latency->samples_done++;
+    if (times[GSS_LATENCY_KERNEL_RX] != 0)
+    {
+        latency->kernel_rx++;
+    }
+    if (times[GSS_LATENCY_KERNEL_TX] != 0)
+    {
+        latency->kernel_tx_done++;
+    }
+
+    if (latency->file == NULL)
+    {
+        gss_pool_put(latency->pool, buffer);
+        return;
+    }
+
+    if (!gss_ring_push(&latency->ring, buffer, sizeof(gss_latency_sample_t)))
+    {
+        gss_pool_put(latency->pool, buffer);
+        latency->dropped++;
+        return;
+    }
+
+    sem_post(&latency->samples);
+}
+
+void gss_latency_sent(gss_latency_t *latency, gss_latency_pending_t *pending, unsigned char *sample, int stamps)
+{
+    ((gss_latency_sample_t *)sample)->times[GSS_LATENCY_SENT] = gss_latency_now_ns();
+
+    if (stamps == 0)
+    {
+        gss_latency_finish(latency, sample);
+        return;
+    }
+
+    pending->sample = sample;
+    pending->expected = stamps;
+    pending->received = 0;
+}
+
+void gss_latency_reap(gss_latency_t *latency, gss_latency_pending_t *pending, int socket)
+{
+    if (latency == NULL || pending->sample == NULL)
+    {
+        return;
+    }
+
+    gss_latency_sample_t *sample = (gss_latency_sample_t *)pending->sample;
+
+    while (socket >= 0 && pending->received < pending->expected)
+    {
+        union
+        {
+            char buffer[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct sock_extended_err) + 32)];
+            struct cmsghdr align;
+        } control;
+
+        // SOF_TIMESTAMPING_OPT_TSONLY: each report is an empty packet with the timestamp alongside.
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        if (recvmsg(socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            break;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+            {
+                struct scm_timestamping timestamps;
+                memcpy(&timestamps, CMSG_DATA(cmsg), sizeof(timestamps));
+                uint64_t kernel_ns = (uint64_t)timestamps.ts[0].tv_sec * 1000000000ULL + timestamps.ts[0].tv_nsec;
+
+                // The last write's packet is the last to go, so the latest timestamp is the frame's.
+                if (kernel_ns > sample->times[GSS_LATENCY_KERNEL_TX])
+                {
+                    sample->times[GSS_LATENCY_KERNEL_TX] = kernel_ns;
+                }
+                pending->received++;
+            }
+        }
+    }
+
+    if (pending->received < pending->expected)
+    {
+        if (socket >= 0 && gss_latency_now_ns() - sample->times[GSS_LATENCY_SENT] < GSS_LATENCY_TX_TIMEOUT_MS * 1000000ULL)
+        {
+            return;
+        }
+
+        // Without the last write's timestamp the ones which did arrive say nothing about the frame as a whole.
+        sample->times[GSS_LATENCY_KERNEL_TX] = 0;
+    }
+
+    gss_latency_finish(latency, pending->sample);
+    pending->sample = NULL;
+}
+
+void gss_latency_get_stats(gss_latency_t *latency, gss_latency_stats_t *stats)
+{
+    stats->samples = latency->samples_done;
+    stats->kernel_rx = latency->kernel_rx;
+    stats->kernel_tx = latency->kernel_tx_done;
+    stats->traced = latency->traced;
+    stats->dropped = latency->dropped;
+    for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+    {
+        stats->hop_count[h] = latency->hop_count[h];
+        stats->hop_ns[h] = latency->hop_ns[h];
+    }
+    stats->total_ns = latency->total_ns;
+}
+
+const char *gss_latency_hop_name(int hop)
+{
+    static const char *names[GSS_LATENCY_NUM_HOPS] = {"kernel rx", "parse", "route", "queue", "kernel tx"};
+    return hop >= 0 && hop < GSS_LATENCY_NUM_HOPS ? names[hop] : "unknown";
+}
+
+/**
+ * @brief Appends one async event of a sample, in microseconds since the trace began.
+ *
+ */
+static void gss_latency_write_event(gss_latency_t *latency, const gss_latency_sample_t *sample, const char *name, char phase, uint64_t timestamp_ns, const char *args)
+{
+    int pid = gss_topology_route(latency->topology, sample->destination);
+    fprintf(latency->file, "%s{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\",\"id\":\"0x%lx\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f%s}", latency->written ? ",\n" : "", name, phase,
+            (unsigned long)sample->id, pid >= 0 ? pid : latency->topology->num_vertices, sample->connection, (double)(int64_t)(timestamp_ns - latency->start_ns) / 1e3, args);
+    latency->written = true;
+}
+
+/**
+ * @brief Appends a sample as a frame event, named for its route, with its hops nested inside.
+ *
+ */
+static void gss_latency_write_sample(gss_latency_t *latency, const gss_latency_sample_t *sample)
+{
+    const uint64_t *times = sample->times;
+    uint64_t first = times[GSS_LATENCY_KERNEL_RX] != 0 ? times[GSS_LATENCY_KERNEL_RX] : times[GSS_LATENCY_RECEIVED];
+    uint64_t last = times[GSS_LATENCY_KERNEL_TX] > times[GSS_LATENCY_SENT] ? times[GSS_LATENCY_KERNEL_TX] : times[GSS_LATENCY_SENT];
+
+    char name[2 * GSS_TOPOLOGY_NAME_SIZE + 8];
+    snprintf(name, sizeof(name), "%s -> %s", gss_latency_vertex_name(latency->topology, sample->origin), gss_latency_vertex_name(latency->topology, sample->destination));
+
+    char args[192];
+    snprintf(args, sizeof(args), ",\"args\":{\"type\":%u,\"compressed\":%s,\"bytes\":%u,\"connection\":%d,\"send_us\":%.3f,\"kernel_tx\":%s}", sample->type & ~GSS_FRAME_TYPE_COMPRESSED,
+             (sample->type & GSS_FRAME_TYPE_COMPRESSED) ? "true" : "false", sample->frame_size, sample->connection, (double)(times[GSS_LATENCY_SENT] - times[GSS_LATENCY_DEQUEUED]) / 1e3,
+             times[GSS_LATENCY_KERNEL_TX] != 0 ? "true" : "false");
+
+    gss_latency_write_event(latency, sample, name, 'b', first, args);
+    for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+    {
+        uint64_t start = times[gss_latency_hop_start[h]], end = times[gss_latency_hop_end(sample, h)];
+        if (start != 0 && end >= start)
+        {
+            gss_latency_write_event(latency, sample, gss_latency_hop_name(h), 'b', start, "");
+            gss_latency_write_event(latency, sample, gss_latency_hop_name(h), 'e', end, "");
+        }
+    }
+    gss_latency_write_event(latency, sample, name, 'e', last, "");
+}
+
+void *gss_latency_writer_thread(void *latency_vp)
+{
+    gss_latency_t *latency = (gss_latency_t *)latency_vp;
+
+    bool active = true;
+    while (active)
+    {
+        // Read the flag before draining so that everything queued before shutdown is written on the last pass.
+        active = latency->active;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += GSS_LATENCY_WRITER_TICK_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        if (active)
+        {
+            sem_timedwait(&latency->samples, &deadline);
+        }
+
+        unsigned char *sample;
+        size_t size;
+        bool wrote = false;
+        while (gss_ring_pop(&latency->ring, &sample, &size))
+        {
+            gss_latency_write_sample(latency, (const gss_latency_sample_t *)sample);
+            gss_pool_put(latency->pool, sample);
+            latency->traced++;
+            wrote = true;
+        }
+
+        if (wrote)
+        {
+            fflush(latency->file);
+        }
+    }
+
+    fprintf(latency->file, "\n]\n");
+    fflush(latency->file);
+
+    gss_latency_stats_t stats;
+    gss_latency_get_stats(latency, &stats);
+    dbwarnlf(YELLOW_FG "[TRACE] Writer deactivated (%lu samples, %lu traced, %lu dropped).", stats.samples, stats.traced, stats.dropped);
+
+    return NULL;
+}
@@ -0,0 +1,315 @@
+/**
+ * @file gss_log.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "gss_log.hpp"
+#include "gss_frame.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+static_assert(sizeof(gss_log_record_t) + GSS_FRAME_MAX_PAYLOAD_SIZE <= GSS_POOL_MAX_SIZE, "A record of a maximum size frame must fit in a pool buffer.");
+
+#define GSS_LOG_WRITER_TICK_MS 500 // How often an idle writer checks whether it should exit.
+
+static uint64_t gss_log_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Closes the current file, if any, and opens the next one in the sequence.
+ *
+ * @param log
+ * @return int 1 on success, -1 on failure.
+ */
+static int gss_log_open_next(gss_log_t *log)
+{
+    if (log->fd >= 0)
+    {
+        close(log->fd);
+        log->fd = -1;
+        log->rotations++;
+    }
+
+    char path[sizeof(log->directory) + 64];
+    snprintf(path, sizeof(path), "%s/%s_%lu_%04u.bin", log->directory, log->name, (unsigned long)(log->start_ns / 1000000000ULL), log->sequence);
+
+    log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (log->fd < 0)
+    {
+        dberrorlf(RED_FG "Could not open log file %s (%d).", path, errno);
+        return -1;
+    }
+
+    gss_log_file_header_t file_header[1];
+    memset(file_header, 0x0, sizeof(gss_log_file_header_t));
+    memcpy(file_header->magic, log->magic, sizeof(file_header->magic));
+    file_header->created_ns = gss_log_now_ns();
+    file_header->sequence = log->sequence++;
+
+    if (write(log->fd, file_header, sizeof(gss_log_file_header_t)) != sizeof(gss_log_file_header_t))
+    {
+        dberrorlf(RED_FG "Could not write header of log file %s (%d).", path, errno);
+        close(log->fd);
+        log->fd = -1;
+        return -1;
+    }
+
+    log->file_size = sizeof(gss_log_file_header_t);
+    log->bytes_written += sizeof(gss_log_file_header_t);
+    dbinfolf(BLUE_FG "Logging to %s.", path);
+
+    return 1;
+}
+
+gss_log_t *gss_log_create(const char *directory, const char *name, const char *magic, uint64_t rotate_size, gss_pool_t *pool)
+{
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+    {
+        dberrorlf(FATAL "Could not create log directory %s (%d).", directory, errno);
+        return NULL;
+    }
+
+    gss_log_t *log = new gss_log_t;
+    gss_ring_init(&log->ring, GSS_LOG_QUEUE_CAPACITY);
+
+    if (sem_init(&log->records, 0, 0) != 0)
+    {
+        dberrorlf(FATAL "Could not create log semaphore.");
+        gss_ring_free(&log->ring);
+        delete log;
+        return NULL;
+    }
+
+    log->pool = pool;
+    log->active = true;
+
+    snprintf(log->directory, sizeof(log->directory), "%s", directory);
+    snprintf(log->name, sizeof(log->name), "%s", name);
+    memcpy(log->magic, magic, sizeof(log->magic));
+    log->rotate_size = rotate_size;
+    log->start_ns = gss_log_now_ns();
+    log->sequence = 0;
+    log->fd = -1;
+    log->file_size = 0;
+
+    log->logged = 0;
+    log->dropped = 0;
+    log->bytes_written = 0;
+    log->write_calls = 0;
+    log->rotations = 0;
+
+    return log;
+}
+
+void gss_log_destroy(gss_log_t *log)
+{
+    unsigned char *record;
+    size_t record_size;
+    while (gss_ring_pop(&log->ring, &record, &record_size))
+    {
+        gss_pool_put(log->pool, record);
+    }
+
+    if (log->fd >= 0)
+    {
+        close(log->fd);
+    }
+
+    sem_destroy(&log->records);
+    gss_ring_free(&log->ring);
+    delete log;
+}
+
+void gss_log_frame(gss_log_t *log, const unsigned char *frame, uint8_t flags)
+{
+    if (log == NULL)
+    {
+        return;
+    }
+
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+    gss_log_record_t entry;
+    entry.timestamp_ns = gss_log_now_ns();
+    entry.origin = header->origin;
+    entry.destination = header->destination;
+    entry.netstat = header->netstat;
+    entry.flags = flags;
+    entry.type = header->type;
+    entry.payload_size = header->payload_size;
+
+    // The writer has fallen behind if this is dropped; forwarding matters more than the log.
+    gss_log_record(log, &entry, sizeof(entry), frame + sizeof(gss_frame_header_t), (flags & GSS_LOG_FLAG_NO_PAYLOAD) ? 0 : header->payload_size);
+}
+
+void gss_log_record(gss_log_t *log, const void *head, size_t head_size, const unsigned char *data, size_t data_size)
+{
+    unsigned char *record = gss_pool_get(log->pool, head_size + data_size);
+    if (record == NULL)
+    {
+        log->dropped++;
+        return;
+    }
+
+    memcpy(record, head, head_size);
+    if (data_size > 0)
+    {
+        memcpy(record + head_size, data, data_size);
+    }
+
+    if (!gss_ring_push(&log->ring, record, head_size + data_size))
+    {
+        gss_pool_put(log->pool, record);
+        log->dropped++;
+        return;
+    }
+
+    log->logged++;
+    sem_post(&log->records);
+}
+
+void gss_log_get_stats(gss_log_t *log, gss_log_stats_t *stats)
+{
+    stats->logged = log->logged;
+    stats->dropped = log->dropped;
+    stats->bytes_written = log->bytes_written;
+    stats->write_calls = log->write_calls;
+    stats->rotations = log->rotations;
+}
+
+/**
+ * @brief Writes a batch of records with as few writev(2) calls as possible, rotating first if the batch would overflow the current file.
+ *
+ * @param log
+ * @param iov
+ * @param count
+ * @param size Total bytes in the batch.
+ */
+static void gss_log_write_batch(gss_log_t *log, struct iovec *iov, int count, size_t size)
+{
+    if (log->fd < 0 || log->file_size + size > log->rotate_size)
+    {
+        if (gss_log_open_next(log) < 0)
+        {
+            log->dropped += count;
+            return;
+        }
+    }
+
+    while (count > 0)
+    {
+        ssize_t written = writev(log->fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            dberrorlf(RED_FG "Log write failed (%d), dropping %d records.", errno, count);
+            log->dropped += count;
+            return;
+        }
+
+        log->write_calls++;
+        log->bytes_written += written;
+        log->file_size += written;
+
+        // Skip whatever was fully written and retry the remainder of a short write.
+        while (count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (unsigned char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void *gss_log_writer_thread(void *log_vp)
+{
+    gss_log_t *log = (gss_log_t *)log_vp;
+
+    unsigned char *batch[GSS_LOG_BATCH_SIZE];
+    struct iovec iov[GSS_LOG_BATCH_SIZE];
+
+    bool active = true;
+    while (active)
+    {
+        // Read the flag before draining so that everything queued before shutdown is flushed on the last pass.
+        active = log->active;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += GSS_LOG_WRITER_TICK_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        if (active)
+        {
+            sem_timedwait(&log->records, &deadline);
+        }
+
+        while (true)
+        {
+            int count = 0;
+            size_t size = 0;
+            size_t record_size;
+            while (count < GSS_LOG_BATCH_SIZE && gss_ring_pop(&log->ring, &batch[count], &record_size))
+            {
+                iov[count].iov_base = batch[count];
+                iov[count].iov_len = record_size;
+                size += record_size;
+                count++;
+            }
+
+            if (count == 0)
+            {
+                break;
+            }
+
+            gss_log_write_batch(log, iov, count, size);
+
+            for (int i = 0; i < count; i++)
+            {
+                gss_pool_put(log->pool, batch[i]);
+            }
+        }
+    }
+
+    if (log->fd >= 0)
+    {
+        fdatasync(log->fd);
+    }
+
+    gss_log_stats_t stats;
+    gss_log_get_stats(log, &stats);
+    dbwarnlf(YELLOW_FG "[%s] Writer deactivated (logged %lu, dropped %lu, %lu bytes in %lu writes, %lu rotations).",
+             log->name, stats.logged, stats.dropped, stats.bytes_written, stats.write_calls, stats.rotations);
+
+    return NULL;
+}
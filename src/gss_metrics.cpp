@@ -0,0 +1,482 @@
+/**
+ * @file gss_metrics.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "gss.hpp"
+#include "gss_metrics.hpp"
+#include "gss_txq.hpp"
+#include "gss_pool.hpp"
+#include "gss_latency.hpp"
+#include "gss_reload.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_METRICS_ACCEPT_TIMEOUT_MS 500 // How often an idle scrape thread checks whether it should exit.
+
+thread_local gss_metrics_shard_t *gss_metrics_local_shard = NULL;
+
+static const char *gss_metrics_failure_name[GSS_METRICS_NUM_FAILURES] = {"send_failed", "not_ready"};
+
+/**
+ * @brief A growing text buffer for one scrape's response.
+ *
+ */
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} gss_metrics_text_t;
+
+static void gss_metrics_printf(gss_metrics_text_t *text, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void gss_metrics_printf(gss_metrics_text_t *text, const char *format, ...)
+{
+    while (true)
+    {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+        va_end(args);
+
+        if (written < 0)
+        {
+            return;
+        }
+        if (text->length + written < text->capacity)
+        {
+            text->length += written;
+            return;
+        }
+
+        char *data = (char *)realloc(text->data, text->capacity * 2);
+        if (data == NULL)
+        {
+            return;
+        }
+        text->data = data;
+        text->capacity *= 2;
+    }
+}
+
+gss_metrics_shard_t *gss_metrics_shard_claim(gss_metrics_t *metrics)
+{
+    int index = metrics->num_shards.fetch_add(1, std::memory_order_relaxed);
+    if (index >= GSS_METRICS_MAX_SHARDS)
+    {
+        index = GSS_METRICS_MAX_SHARDS - 1;
+    }
+
+    gss_metrics_local_shard = &metrics->shards[index];
+    return gss_metrics_local_shard;
+}
+
+gss_metrics_t *gss_metrics_create(int port, const gss_topology_t *topology)
+{
+    // Value-initialized, so every counter starts at zero.
+    gss_metrics_t *metrics = new gss_metrics_t();
+
+    metrics->num_shards = 0;
+    metrics->active = true;
+    metrics->port = port;
+    metrics->listening_socket = -1;
+    metrics->topology = topology;
+
+    return metrics;
+}
+
+void gss_metrics_destroy(gss_metrics_t *metrics)
+{
+    delete metrics;
+}
+
+/**
+ * @brief Names a vertex index, the server included, for labels.
+ *
+ */
+static const char *gss_metrics_vertex_name(const gss_topology_t *topology, int index)
+{
+    return index < topology->num_vertices ? topology->vertices[index].name : "server";
+}
+
+/**
+ * @brief Sums one counter over every claimed shard.
+ *
+ */
+#define GSS_METRICS_SUM(metrics, field, sum)                                                      \
+    do                                                                                            \
+    {                                                                                             \
+        int num_shards_ = (metrics)->num_shards.load(std::memory_order_relaxed);                  \
+        num_shards_ = num_shards_ < GSS_METRICS_MAX_SHARDS ? num_shards_ : GSS_METRICS_MAX_SHARDS; \
+        (sum) = 0;                                                                                \
+        for (int shard_ = 0; shard_ < num_shards_; shard_++)                                      \
+        {                                                                                         \
+            (sum) += (metrics)->shards[shard_].field.load(std::memory_order_relaxed);             \
+        }                                                                                         \
+    } while (0)
+
+/**
+ * @brief Writes a per-vertex counter for every vertex.
+ *
+ */
+#define GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, name, help, field)                    \
+    do                                                                                        \
+    {                                                                                         \
+        gss_metrics_printf(text, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);      \
+        for (int v_ = 0; v_ <= (metrics)->topology->num_vertices; v_++)                       \
+        {                                                                                     \
+            uint64_t sum_;                                                                    \
+            GSS_METRICS_SUM(metrics, field[v_], sum_);                                        \
+            gss_metrics_printf(text, "%s{vertex=\"%s\"} %lu\n", name, gss_metrics_vertex_name((metrics)->topology, v_), sum_); \
+        }                                                                                     \
+    } while (0)
+
+/**
+ * @brief Renders every metric in the Prometheus text format.
+ *
+ */
+static void gss_metrics_render(global_data_t *global, gss_metrics_text_t *text)
+{
+    gss_metrics_t *metrics = global->metrics;
+    const gss_topology_t *topology = metrics->topology;
+
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_frames_received_total", "Frames received from each vertex.", frames_in);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_bytes_received_total", "Bytes received from each vertex.", bytes_in);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_frames_sent_total", "Frames sent to each vertex.", frames_out);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_bytes_sent_total", "Bytes sent to each vertex.", bytes_out);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_reconnects_total", "Connections accepted from each vertex.", reconnects);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_corrupt_frames_total", "Invalid frames (bad header, footer or CRC) discarded from each vertex's stream.", corrupt);
+    GSS_METRICS_PRINT_VERTEX_COUNTER(text, metrics, "gss_resync_bytes_total", "Bytes skipped while resynchronizing each vertex's stream.", resync_bytes);
+
+    gss_metrics_printf(text, "# HELP gss_send_failures_total Frames which could not be delivered to each vertex.\n# TYPE gss_send_failures_total counter\n");
+    for (int v = 0; v <= topology->num_vertices; v++)
+    {
+        for (int f = 0; f < GSS_METRICS_NUM_FAILURES; f++)
+        {
+            uint64_t sum;
+            GSS_METRICS_SUM(metrics, failures[v][f], sum);
+            gss_metrics_printf(text, "gss_send_failures_total{vertex=\"%s\",reason=\"%s\"} %lu\n", gss_metrics_vertex_name(topology, v), gss_metrics_failure_name[f], sum);
+        }
+    }
+
+    gss_metrics_printf(text, "# HELP gss_connected Whether each vertex is connected.\n# TYPE gss_connected gauge\n");
+    for (int v = 0; v < topology->num_vertices; v++)
+    {
+        gss_metrics_printf(text, "gss_connected{vertex=\"%s\"} %d\n", gss_metrics_vertex_name(topology, v), gss_vertex_connected(global, v) ? 1 : 0);
+    }
+
+    // The transmit queues already keep their own counters, so a scrape just reads them.
+    gss_txq_stats_t txq_stats[GSS_MAX_CONNECTIONS];
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_txq_get_stats(global->txq[i], &txq_stats[i]);
+    }
+    gss_metrics_printf(text, "# HELP gss_txq_depth Frames waiting in each connection's transmit queue.\n# TYPE gss_txq_depth gauge\n");
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_metrics_printf(text, "gss_txq_depth{connection=\"%d\",vertex=\"%s\"} %lu\n", i, gss_metrics_vertex_name(topology, gss_vertex(global, i)), txq_stats[i].depth);
+    }
+    gss_metrics_printf(text, "# HELP gss_txq_class_depth Frames waiting in each priority class of each connection's transmit queue.\n# TYPE gss_txq_class_depth gauge\n");
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+        {
+            gss_metrics_printf(text, "gss_txq_class_depth{connection=\"%d\",vertex=\"%s\",class=\"%s\"} %lu\n", i, gss_metrics_vertex_name(topology, gss_vertex(global, i)), gss_txq_class_name(c), txq_stats[i].class_depth[c]);
+        }
+    }
+    gss_metrics_printf(text, "# HELP gss_txq_high_water Most frames ever waiting in each connection's transmit queue.\n# TYPE gss_txq_high_water gauge\n");
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_metrics_printf(text, "gss_txq_high_water{connection=\"%d\",vertex=\"%s\"} %lu\n", i, gss_metrics_vertex_name(topology, gss_vertex(global, i)), txq_stats[i].high_water);
+    }
+    gss_metrics_printf(text, "# HELP gss_txq_dropped_total Frames dropped by each connection's transmit queue overflow policy.\n# TYPE gss_txq_dropped_total counter\n");
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        gss_metrics_printf(text, "gss_txq_dropped_total{connection=\"%d\",vertex=\"%s\"} %lu\n", i, gss_metrics_vertex_name(topology, gss_vertex(global, i)), txq_stats[i].dropped_oldest + txq_stats[i].dropped_newest);
+    }
+
+    gss_metrics_printf(text, "# HELP gss_writer_wakeup_seconds Time from a frame being queued for a sleeping writer to the writer running, per connection.\n# TYPE gss_writer_wakeup_seconds histogram\n");
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        if (txq_stats[i].wakeups == 0)
+        {
+            continue;
+        }
+
+        const char *vertex = gss_metrics_vertex_name(topology, gss_vertex(global, i));
+        uint64_t cumulative = 0;
+        for (int b = 0; b < GSS_METRICS_NUM_BUCKETS; b++)
+        {
+            cumulative += txq_stats[i].wakeup_buckets[b];
+            if (b < GSS_METRICS_NUM_BUCKETS - 1)
+            {
+                gss_metrics_printf(text, "gss_writer_wakeup_seconds_bucket{connection=\"%d\",vertex=\"%s\",le=\"%.9g\"} %lu\n", i, vertex, (double)(1ULL << b) * 1e-6, cumulative);
+            }
+            else
+            {
+                gss_metrics_printf(text, "gss_writer_wakeup_seconds_bucket{connection=\"%d\",vertex=\"%s\",le=\"+Inf\"} %lu\n", i, vertex, cumulative);
+            }
+        }
+        gss_metrics_printf(text, "gss_writer_wakeup_seconds_sum{connection=\"%d\",vertex=\"%s\"} %.9f\n", i, vertex, txq_stats[i].wakeup_ns * 1e-9);
+        gss_metrics_printf(text, "gss_writer_wakeup_seconds_count{connection=\"%d\",vertex=\"%s\"} %lu\n", i, vertex, txq_stats[i].wakeups);
+    }
+
+    // Likewise the dedup caches, if enabled.
+    if (global->dedup[0] != NULL)
+    {
+        gss_dedup_stats_t dedup_stats[GSS_MAX_VERTICES];
+        for (int v = 0; v < topology->num_vertices; v++)
+        {
+            gss_dedup_get_stats(global->dedup[v], &dedup_stats[v]);
+        }
+        gss_metrics_printf(text, "# HELP gss_dedup_hits_total Retransmitted frames from each vertex dropped as duplicates.\n# TYPE gss_dedup_hits_total counter\n");
+        for (int v = 0; v < topology->num_vertices; v++)
+        {
+            gss_metrics_printf(text, "gss_dedup_hits_total{vertex=\"%s\"} %lu\n", gss_metrics_vertex_name(topology, v), dedup_stats[v].hits);
+        }
+        gss_metrics_printf(text, "# HELP gss_dedup_misses_total Frames from each vertex checked for duplicates and forwarded.\n# TYPE gss_dedup_misses_total counter\n");
+        for (int v = 0; v < topology->num_vertices; v++)
+        {
+            gss_metrics_printf(text, "gss_dedup_misses_total{vertex=\"%s\"} %lu\n", gss_metrics_vertex_name(topology, v), dedup_stats[v].misses);
+        }
+    }
+
+    // And the GUI client connections' compression, if enabled.
+    if (global->compress != NULL)
+    {
+        gss_compress_stats_t compress_stats[GSS_MAX_CONNECTIONS];
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            gss_compress_get_stats(global->compress, i, &compress_stats[i]);
+        }
+        const char *client = gss_metrics_vertex_name(topology, topology->client);
+        gss_metrics_printf(text, "# HELP gss_compress_frames_total Frames for each GUI client connection sent compressed, or as is after it asked for compression.\n# TYPE gss_compress_frames_total counter\n");
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (gss_vertex(global, i) == topology->client)
+            {
+                gss_metrics_printf(text, "gss_compress_frames_total{connection=\"%d\",vertex=\"%s\",result=\"compressed\"} %lu\n", i, client, compress_stats[i].compressed);
+                gss_metrics_printf(text, "gss_compress_frames_total{connection=\"%d\",vertex=\"%s\",result=\"bypassed\"} %lu\n", i, client, compress_stats[i].bypassed);
+            }
+        }
+        gss_metrics_printf(text, "# HELP gss_compress_raw_bytes_total Size of those frames uncompressed.\n# TYPE gss_compress_raw_bytes_total counter\n");
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (gss_vertex(global, i) == topology->client)
+            {
+                gss_metrics_printf(text, "gss_compress_raw_bytes_total{connection=\"%d\",vertex=\"%s\"} %lu\n", i, client, compress_stats[i].raw_bytes);
+            }
+        }
+        gss_metrics_printf(text, "# HELP gss_compress_wire_bytes_total Size those frames were sent at.\n# TYPE gss_compress_wire_bytes_total counter\n");
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (gss_vertex(global, i) == topology->client)
+            {
+                gss_metrics_printf(text, "gss_compress_wire_bytes_total{connection=\"%d\",vertex=\"%s\"} %lu\n", i, client, compress_stats[i].wire_bytes);
+            }
+        }
+        gss_metrics_printf(text, "# HELP gss_compress_seconds_total Time spent compressing frames for each GUI client connection, failed trials included.\n# TYPE gss_compress_seconds_total counter\n");
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (gss_vertex(global, i) == topology->client)
+            {
+                gss_metrics_printf(text, "gss_compress_seconds_total{connection=\"%d\",vertex=\"%s\"} %.9f\n", i, client, compress_stats[i].compress_ns * 1e-9);
+            }
+        }
+    }
+
+    // And the sampled frames' hops, if enabled.
+    if (global->latency != NULL)
+    {
+        gss_latency_stats_t latency_stats;
+        gss_latency_get_stats(global->latency, &latency_stats);
+        gss_metrics_printf(text, "# HELP gss_hop_latency_seconds Time sampled frames spent in each hop from the kernel receiving them to the kernel sending them on.\n# TYPE gss_hop_latency_seconds summary\n");
+        for (int h = 0; h < GSS_LATENCY_NUM_HOPS; h++)
+        {
+            gss_metrics_printf(text, "gss_hop_latency_seconds_sum{hop=\"%s\"} %.9f\n", gss_latency_hop_name(h), latency_stats.hop_ns[h] * 1e-9);
+            gss_metrics_printf(text, "gss_hop_latency_seconds_count{hop=\"%s\"} %lu\n", gss_latency_hop_name(h), latency_stats.hop_count[h]);
+        }
+        gss_metrics_printf(text, "# HELP gss_latency_samples_total Frames sampled, counted once per destination.\n# TYPE gss_latency_samples_total counter\ngss_latency_samples_total %lu\n", latency_stats.samples);
+    }
+
+    gss_pool_stats_t pool_stats;
+    gss_pool_get_stats(global->pool, &pool_stats);
+    gss_metrics_printf(text, "# HELP gss_pool_outstanding Frame buffers in use.\n# TYPE gss_pool_outstanding gauge\ngss_pool_outstanding %lu\n", pool_stats.outstanding);
+    gss_metrics_printf(text, "# HELP gss_pool_heap_allocations_total Frame buffers malloc'd because the pool was empty.\n# TYPE gss_pool_heap_allocations_total counter\ngss_pool_heap_allocations_total %lu\n", pool_stats.heap_allocations);
+
+    // Only routes which have carried traffic, or the scrape would be mostly zeros.
+    gss_metrics_printf(text, "# HELP gss_forward_latency_seconds Time from a frame arriving at the server to it being sent on, per route.\n# TYPE gss_forward_latency_seconds histogram\n");
+    for (int o = 0; o <= topology->num_vertices; o++)
+    {
+        for (int d = 0; d <= topology->num_vertices; d++)
+        {
+            uint64_t count, sum_ns;
+            GSS_METRICS_SUM(metrics, latency_count[o][d], count);
+            if (count == 0)
+            {
+                continue;
+            }
+            GSS_METRICS_SUM(metrics, latency_sum_ns[o][d], sum_ns);
+
+            const char *origin = gss_metrics_vertex_name(topology, o), *destination = gss_metrics_vertex_name(topology, d);
+            uint64_t cumulative = 0;
+            for (int b = 0; b < GSS_METRICS_NUM_BUCKETS; b++)
+            {
+                uint64_t bucket;
+                GSS_METRICS_SUM(metrics, latency_buckets[o][d][b], bucket);
+                cumulative += bucket;
+                if (b < GSS_METRICS_NUM_BUCKETS - 1)
+                {
+                    gss_metrics_printf(text, "gss_forward_latency_seconds_bucket{origin=\"%s\",destination=\"%s\",le=\"%.9g\"} %lu\n", origin, destination, (double)(1ULL << b) * 1e-6, cumulative);
+                }
+                else
+                {
+                    gss_metrics_printf(text, "gss_forward_latency_seconds_bucket{origin=\"%s\",destination=\"%s\",le=\"+Inf\"} %lu\n", origin, destination, cumulative);
+                }
+            }
+            gss_metrics_printf(text, "gss_forward_latency_seconds_sum{origin=\"%s\",destination=\"%s\"} %.9f\n", origin, destination, sum_ns * 1e-9);
+            gss_metrics_printf(text, "gss_forward_latency_seconds_count{origin=\"%s\",destination=\"%s\"} %lu\n", origin, destination, count);
+        }
+    }
+
+    gss_metrics_printf(text, "# HELP gss_class_latency_seconds Time from a frame arriving at the server to it being sent on, per transmit queue priority class.\n# TYPE gss_class_latency_seconds histogram\n");
+    for (int c = 0; c < GSS_METRICS_NUM_CLASSES; c++)
+    {
+        uint64_t count, sum_ns;
+        GSS_METRICS_SUM(metrics, class_latency_count[c], count);
+        GSS_METRICS_SUM(metrics, class_latency_sum_ns[c], sum_ns);
+
+        const char *name = gss_txq_class_name(c);
+        uint64_t cumulative = 0;
+        for (int b = 0; b < GSS_METRICS_NUM_BUCKETS; b++)
+        {
+            uint64_t bucket;
+            GSS_METRICS_SUM(metrics, class_latency_buckets[c][b], bucket);
+            cumulative += bucket;
+            if (b < GSS_METRICS_NUM_BUCKETS - 1)
+            {
+                gss_metrics_printf(text, "gss_class_latency_seconds_bucket{class=\"%s\",le=\"%.9g\"} %lu\n", name, (double)(1ULL << b) * 1e-6, cumulative);
+            }
+            else
+            {
+                gss_metrics_printf(text, "gss_class_latency_seconds_bucket{class=\"%s\",le=\"+Inf\"} %lu\n", name, cumulative);
+            }
+        }
+        gss_metrics_printf(text, "gss_class_latency_seconds_sum{class=\"%s\"} %.9f\n", name, sum_ns * 1e-9);
+        gss_metrics_printf(text, "gss_class_latency_seconds_count{class=\"%s\"} %lu\n", name, count);
+    }
+}
+
+int gss_metrics_listen(gss_metrics_t *metrics)
+{
+    // After a hot restart the previous instance's socket is already bound and listening.
+    int listening_socket = gss_reload_inherit(metrics->port);
+    bool inherited = listening_socket >= 0;
+    if (!inherited)
+    {
+        listening_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    if (listening_socket < 0)
+    {
+        dberrorlf(RED_FG "[METRICS] Could not create socket.");
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(listening_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = GSS_METRICS_ACCEPT_TIMEOUT_MS * 1000;
+    setsockopt(listening_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    // Only reachable from this machine; scrape it through a local Prometheus agent or an SSH tunnel.
+    struct sockaddr_in listening_address;
+    memset(&listening_address, 0x0, sizeof(listening_address));
+    listening_address.sin_family = AF_INET;
+    listening_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listening_address.sin_port = htons(metrics->port);
+
+    if (!inherited && (bind(listening_socket, (struct sockaddr *)&listening_address, sizeof(listening_address)) < 0 || listen(listening_socket, 4) < 0))
+    {
+        dberrorlf(RED_FG "[METRICS] Could not listen on port %d: %s", metrics->port, strerror(errno));
+        close(listening_socket);
+        return -1;
+    }
+    metrics->listening_socket = listening_socket;
+    dbinfolf(GREEN_FG "[METRICS] Serving metrics on 127.0.0.1:%d.", metrics->port);
+    gss_reload_listening(metrics->port, listening_socket);
+
+    return 1;
+}
+
+void *gss_metrics_thread(void *global_vp)
+{
+    global_data_t *global = (global_data_t *)global_vp;
+    gss_metrics_t *metrics = global->metrics;
+    int listening_socket = metrics->listening_socket;
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = GSS_METRICS_ACCEPT_TIMEOUT_MS * 1000;
+
+    gss_metrics_text_t text;
+    text.capacity = 64 * 1024;
+    text.data = (char *)malloc(text.capacity);
+
+    while (metrics->active)
+    {
+        int scrape_socket = accept(listening_socket, NULL, NULL);
+        if (scrape_socket < 0)
+        {
+            continue;
+        }
+        setsockopt(scrape_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+        // Every request gets the same answer, so the request itself is only read to be polite.
+        char request[1024];
+        if (recv(scrape_socket, request, sizeof(request), 0) < 0)
+        {
+            close(scrape_socket);
+            continue;
+        }
+
+        text.length = 0;
+        gss_metrics_printf(&text, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n");
+        gss_metrics_render(global, &text);
+
+        size_t sent = 0;
+        while (sent < text.length)
+        {
+            ssize_t send_size = send(scrape_socket, text.data + sent, text.length - sent, MSG_NOSIGNAL);
+            if (send_size <= 0)
+            {
+                break;
+            }
+            sent += send_size;
+        }
+
+        close(scrape_socket);
+    }
+
+    free(text.data);
+    close(listening_socket);
+
+    return NULL;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file gss_pool.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gss_pool.hpp"
+#include "gss_frame.hpp"
+
+static const size_t gss_pool_class_size[GSS_POOL_NUM_CLASSES] = {256, 1024, 4096, 16384, GSS_POOL_MAX_SIZE};
+
+/**
+ * @brief Stored immediately before every buffer handed out, so a returned buffer finds its way back to its class.
+ *
+ */
+typedef struct
+{
+    alignas(16) uint32_t size_class;
+    std::atomic<uint32_t> references;
+    uint64_t stamp_ns;
+    uint64_t times[GSS_POOL_NUM_TIMES];
+} gss_pool_block_t;
+
+static_assert(sizeof(gss_pool_block_t) % 16 == 0, "Buffers stay 16-byte aligned.");
+
+gss_pool_t *gss_pool_create()
+{
+    gss_pool_t *pool = new gss_pool_t;
+
+    for (int i = 0; i < GSS_POOL_NUM_CLASSES; i++)
+    {
+        gss_ring_init(&pool->free_list[i], GSS_POOL_CLASS_CAPACITY);
+    }
+
+    pool->gets = 0;
+    pool->puts = 0;
+    pool->heap_allocations = 0;
+    pool->heap_frees = 0;
+    pool->high_water = 0;
+
+    return pool;
+}
+
+void gss_pool_destroy(gss_pool_t *pool)
+{
+    for (int i = 0; i < GSS_POOL_NUM_CLASSES; i++)
+    {
+        unsigned char *block;
+        size_t size;
+        while (gss_ring_pop(&pool->free_list[i], &block, &size))
+        {
+            free(block);
+        }
+        gss_ring_free(&pool->free_list[i]);
+    }
+
+    delete pool;
+}
+
+unsigned char *gss_pool_get(gss_pool_t *pool, size_t size)
+{
+    int size_class = 0;
+    while (size_class < GSS_POOL_NUM_CLASSES && gss_pool_class_size[size_class] < size)
+    {
+        size_class++;
+    }
+    if (size_class == GSS_POOL_NUM_CLASSES)
+    {
+        return NULL;
+    }
+
+    unsigned char *block;
+    size_t block_size;
+    if (!gss_ring_pop(&pool->free_list[size_class], &block, &block_size))
+    {
+        block = (unsigned char *)malloc(sizeof(gss_pool_block_t) + gss_pool_class_size[size_class]);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        ((gss_pool_block_t *)block)->size_class = size_class;
+        pool->heap_allocations++;
+    }
+    ((gss_pool_block_t *)block)->references.store(1, std::memory_order_relaxed);
+    ((gss_pool_block_t *)block)->stamp_ns = 0;
+    memset(((gss_pool_block_t *)block)->times, 0, sizeof(((gss_pool_block_t *)block)->times));
+
+    uint64_t outstanding = ++pool->gets - pool->puts.load(std::memory_order_relaxed);
+    uint64_t high_water = pool->high_water.load(std::memory_order_relaxed);
+    while (outstanding > high_water && outstanding < (1ULL << 63) && !pool->high_water.compare_exchange_weak(high_water, outstanding, std::memory_order_relaxed))
+    {
+    }
+
+    return block + sizeof(gss_pool_block_t);
+}
+
+void gss_pool_put(gss_pool_t *pool, unsigned char *buffer)
+{
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    unsigned char *block = buffer - sizeof(gss_pool_block_t);
+
+    // Only the last owner of a shared buffer recycles it.
+    if (((gss_pool_block_t *)block)->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    uint32_t size_class = ((gss_pool_block_t *)block)->size_class;
+
+    pool->puts++;
+
+    if (!gss_ring_push(&pool->free_list[size_class], block, gss_pool_class_size[size_class]))
+    {
+        free(block);
+        pool->heap_frees++;
+    }
+}
+
+void gss_pool_share(unsigned char *buffer, uint32_t count)
+{
+    ((gss_pool_block_t *)(buffer - sizeof(gss_pool_block_t)))->references.fetch_add(count, std::memory_order_relaxed);
+}
+
+void gss_pool_set_stamp(unsigned char *buffer, uint64_t stamp_ns)
+{
+    ((gss_pool_block_t *)(buffer - sizeof(gss_pool_block_t)))->stamp_ns = stamp_ns;
+}
+
+uint64_t gss_pool_stamp(const unsigned char *buffer)
+{
+    return ((const gss_pool_block_t *)(buffer - sizeof(gss_pool_block_t)))->stamp_ns;
+}
+
+void gss_pool_get_stats(gss_pool_t *pool, gss_pool_stats_t *stats)
+{
+    stats->puts = pool->puts;
+    stats->gets = pool->gets;
+    stats->heap_allocations = pool->heap_allocations;
+    stats->heap_frees = pool->heap_frees;
+    stats->outstanding = stats->gets > stats->puts ? stats->gets - stats->puts : 0;
+    stats->high_water = pool->high_water;
+}
+
+uint64_t *gss_pool_times(const unsigned char *buffer)
+{
+    return ((gss_pool_block_t *)(buffer - sizeof(gss_pool_block_t)))->times;
+}
+
+void gss_pool_copy_stamp(unsigned char *buffer, const unsigned char *original)
+{
+    gss_pool_block_t *block = (gss_pool_block_t *)(buffer - sizeof(gss_pool_block_t));
+    const gss_pool_block_t *original_block = (const gss_pool_block_t *)(original - sizeof(gss_pool_block_t));
+    block->stamp_ns = original_block->stamp_ns;
+    memcpy(block->times, original_block->times, sizeof(block->times));
+}
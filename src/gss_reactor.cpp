@@ -0,0 +1,334 @@
+/**
+ * @file gss_reactor.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "network.hpp"
+#include "gss.hpp"
+#include "gss_frame.hpp"
+#include "gss_reactor.hpp"
+#include "gss_pool.hpp"
+#include "gss_latency.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_REACTOR_LISTENER 0x100 // Set in epoll_event.data.u32 for listening sockets, the low byte is the vertex index. Otherwise the low byte is the connection index.
+
+/**
+ * @brief Per-reactor state for one connection.
+ *
+ */
+typedef struct
+{
+    int listening_socket; // Only for the first connection of each vertex.
+    gss_frame_decoder_t decoder;
+    time_t last_rx;
+} gss_reactor_vertex_t;
+
+static time_t gss_reactor_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+/**
+ * @brief Closes an accepted connection, if any.
+ *
+ */
+static void gss_reactor_disconnect(global_data_t *global, int epoll_fd, gss_reactor_vertex_t *vertex, int t_index)
+{
+    NetDataServer *network_data = global->network_data[t_index];
+
+    // Never waits on the connection's writer: a send in progress is shut down and closes the socket itself when it returns.
+    if (network_data->socket >= 0)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, network_data->socket, NULL);
+    }
+    gss_txq_close_socket(global->txq[t_index]);
+
+    gss_set_connected(global, t_index, false);
+
+    gss_frame_decoder_reset(&vertex->decoder);
+}
+
+/**
+ * @brief Finds a GUI client connection which is not in use.
+ *
+ * @return int Connection index, or -1 if every client connection is in use.
+ */
+static int gss_reactor_client_slot(global_data_t *global)
+{
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        if (gss_vertex(global, i) == global->topology.client && global->network_data[i]->socket < 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Accepts every pending connection on a vertex's listening socket. GUI clients get a connection each, up to global->max_clients; for the radios a new connection replaces the old one.
+ *
+ */
+static void gss_reactor_accept(global_data_t *global, int epoll_fd, gss_reactor_vertex_t *vertices, int v_index, const char *t_tag)
+{
+    while (true)
+    {
+        struct sockaddr_in accepted_address;
+        socklen_t socket_size = sizeof(struct sockaddr_in);
+
+        int accepted_socket = accept4(vertices[v_index].listening_socket, (struct sockaddr *)&accepted_address, &socket_size, SOCK_CLOEXEC);
+        if (accepted_socket < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                dbwarnlf(YELLOW_FG "%s>>> accept failed: %s", t_tag, strerror(errno));
+            }
+            return;
+        }
+
+        int t_index = v_index;
+        if (v_index == global->topology.client)
+        {
+            t_index = gss_reactor_client_slot(global);
+            if (t_index < 0)
+            {
+                dbwarnlf(YELLOW_FG "%sAll %d GUI client connections are in use, refusing another.", t_tag, global->max_clients);
+                close(accepted_socket);
+                continue;
+            }
+        }
+        else if (global->network_data[t_index]->socket >= 0)
+        {
+            dbwarnlf(YELLOW_FG "%sNew connection for ID:%d replaces the existing one.", t_tag, t_index);
+            gss_reactor_disconnect(global, epoll_fd, &vertices[t_index], t_index);
+        }
+
+        gss_health_configure_socket(accepted_socket, &global->health);
+        gss_topology_configure_socket(accepted_socket, &global->topology, gss_vertex(global, t_index));
+        gss_txq_configure_socket(accepted_socket, global->topology.timeout_s);
+        if (global->latency != NULL)
+        {
+            gss_latency_configure_socket(accepted_socket);
+        }
+
+        struct epoll_event event;
+        memset(&event, 0x0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u32 = t_index;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, accepted_socket, &event) < 0)
+        {
+            dberrorlf(RED_FG "%s>>> epoll_ctl: %s", t_tag, strerror(errno));
+            close(accepted_socket);
+            continue;
+        }
+
+        gss_txq_set_socket(global->txq[t_index], accepted_socket);
+
+        gss_set_connected(global, t_index, true);
+
+        vertices[t_index].last_rx = gss_reactor_now();
+        dbinfolf(CYAN_FG "%sConnection accepted for ID:%d (connection %d).", t_tag, v_index, t_index);
+    }
+}
+
+/**
+ * @brief Reads what is available from a vertex's connection and routes every complete frame.
+ *
+ * @return int 1 if the connection is still usable, 0 if it should be closed.
+ */
+static int gss_reactor_receive(global_data_t *global, gss_reactor_vertex_t *vertex, int t_index, const char *t_tag)
+{
+    uint64_t kernel_ns = 0;
+    ssize_t read_size = gss_frame_decoder_fill(&vertex->decoder, global->network_data[t_index]->socket, global->latency != NULL ? &kernel_ns : NULL);
+    uint64_t received_ns = global->latency != NULL ? gss_latency_now_ns() : 0;
+
+    if (read_size == -404)
+    {
+        dbinfolf(CYAN_BG "%sClient ID:%d closed connection.", t_tag, t_index);
+        return 0;
+    }
+    else if (read_size < 0)
+    {
+        dbwarnlf(YELLOW_FG "%s>>> recv: %s", t_tag, strerror(errno));
+        return 0;
+    }
+
+    vertex->last_rx = gss_reactor_now();
+
+    ssize_t frame_size;
+    while ((frame_size = gss_frame_decoder_peek(&vertex->decoder)) != 0)
+    {
+        if (frame_size < 0)
+        {
+            gss_report_corrupt(global, t_index, gss_frame_decoder_resync(&vertex->decoder), t_tag);
+            continue;
+        }
+
+        // The router owns what it is given, so move the frame out of the decoder into a pool buffer, unless it is going nowhere.
+        unsigned char *frame = NULL;
+        if (gss_route_drops(global, t_index, (gss_frame_header_t *)vertex->decoder.buffer))
+        {
+            gss_route_dropped(global, t_index, (gss_frame_header_t *)vertex->decoder.buffer, frame_size, t_tag);
+        }
+        else if ((frame = gss_pool_get(global->pool, frame_size)) == NULL)
+        {
+            dbwarnlf(RED_FG "%sOut of frame buffers, dropping frame from ID:%d.", t_tag, t_index);
+        }
+        else
+        {
+            memcpy(frame, vertex->decoder.buffer, frame_size);
+            if (gss_latency_due(global->latency))
+            {
+                gss_latency_begin(frame, kernel_ns, received_ns);
+            }
+            gss_route_frame(global, t_index, frame, frame_size, t_tag);
+        }
+        gss_frame_decoder_consume(&vertex->decoder, frame_size);
+    }
+
+    return 1;
+}
+
+void *gss_reactor_thread(void *args_vp)
+{
+    gss_reactor_args_t *args = (gss_reactor_args_t *)args_vp;
+    global_data_t *global = args->global;
+
+    char t_tag[32];
+    snprintf(t_tag, sizeof(t_tag), "[REACTOR_%d] ", args->reactor_index);
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        dberrorlf(FATAL "%sCould not create epoll instance.", t_tag);
+        return NULL;
+    }
+
+    gss_reactor_vertex_t *vertices = new gss_reactor_vertex_t[GSS_MAX_CONNECTIONS];
+    bool owned[GSS_MAX_CONNECTIONS] = {0};
+
+    for (int i = args->reactor_index; i < global->topology.num_vertices; i += args->num_reactors)
+    {
+        // Bound, non-blocking, before any reactor started (see gss_network_listen(...)).
+        vertices[i].listening_socket = global->listening_socket[i];
+        gss_frame_decoder_reset(&vertices[i].decoder);
+        vertices[i].last_rx = 0;
+
+        struct epoll_event event;
+        memset(&event, 0x0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = GSS_REACTOR_LISTENER | i;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, vertices[i].listening_socket, &event) < 0)
+        {
+            dberrorlf(RED_FG "%s>>> epoll_ctl: %s", t_tag, strerror(errno));
+            continue;
+        }
+
+        owned[i] = true;
+        dbinfolf("%sListening for %s.", t_tag, global->topology.vertices[i].name);
+    }
+
+    // The GUI client's additional connections come from its listening socket, so they belong to the same reactor.
+    for (int i = global->topology.num_vertices; i < global->num_connections; i++)
+    {
+        vertices[i].listening_socket = -1;
+        gss_frame_decoder_reset(&vertices[i].decoder);
+        vertices[i].last_rx = 0;
+        owned[i] = owned[global->topology.client];
+    }
+
+    struct epoll_event events[GSS_REACTOR_MAX_EVENTS];
+
+    while (true)
+    {
+        bool active = false;
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            active |= owned[i] && global->network_data[i]->recv_active;
+        }
+        if (!active)
+        {
+            break;
+        }
+
+        int num_events = epoll_wait(epoll_fd, events, GSS_REACTOR_MAX_EVENTS, GSS_REACTOR_TICK_MS);
+        if (num_events < 0 && errno != EINTR)
+        {
+            dberrorlf(RED_FG "%s>>> epoll_wait: %s", t_tag, strerror(errno));
+            break;
+        }
+
+        for (int e = 0; e < num_events; e++)
+        {
+            int t_index = events[e].data.u32 & 0xff;
+            gss_reactor_vertex_t *vertex = &vertices[t_index];
+
+            if (events[e].data.u32 & GSS_REACTOR_LISTENER)
+            {
+                gss_reactor_accept(global, epoll_fd, vertices, t_index, t_tag);
+                continue;
+            }
+
+            if (global->network_data[t_index]->socket < 0)
+            {
+                // Closed earlier in this batch.
+                continue;
+            }
+
+            if (!gss_reactor_receive(global, vertex, t_index, t_tag) || (events[e].events & (EPOLLERR | EPOLLHUP)))
+            {
+                if (!global->network_data[t_index]->recv_active)
+                {
+                    // Shutting down: gss_shutdown(...) ended the stream, but the connection stays open until its transmit queue has drained (see gss_drain(...)).
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, global->network_data[t_index]->socket, NULL);
+                    continue;
+                }
+                gss_reactor_disconnect(global, epoll_fd, vertex, t_index);
+            }
+        }
+
+        // Parity with the RX threads' SO_RCVTIMEO: drop connections which have been silent for too long.
+        time_t now = gss_reactor_now();
+        for (int i = 0; i < global->num_connections; i++)
+        {
+            if (owned[i] && global->network_data[i]->recv_active && global->network_data[i]->socket >= 0 && now - vertices[i].last_rx > global->topology.timeout_s)
+            {
+                dbwarnlf(YELLOW_BG "%sActive connection for ID:%d timed-out.", t_tag, i);
+                gss_reactor_disconnect(global, epoll_fd, &vertices[i], i);
+            }
+        }
+    }
+
+    // Receiving is only deactivated to shut down (see gss_shutdown(...)), so the connections stay open until their transmit queues have drained (see gss_drain(...)).
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        if (owned[i] && vertices[i].listening_socket >= 0)
+        {
+            close(vertices[i].listening_socket);
+        }
+    }
+    close(epoll_fd);
+    delete[] vertices;
+
+    dbwarnlf(YELLOW_FG "%sReceive deactivated.", t_tag);
+
+    return NULL;
+}
@@ -0,0 +1,528 @@
+/**
+ * @file gss_recv.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "gss_recv.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_RECV_URING_ENTRIES 64 // Room for every buffer to be handed back, plus a receive and a cancel, between two submissions.
+#define GSS_RECV_URING_CQ_ENTRIES 64 // Room for a completion per provided buffer, and then some.
+#define GSS_RECV_URING_BGID 0
+#define GSS_RECV_URING_DATA 1 // user_data of the multishot receive.
+#define GSS_RECV_URING_CANCEL 2
+#define GSS_RECV_URING_PROVIDE 3
+#define GSS_RECV_URING_INTERNAL_WAIT_S 1 // How long setup and cancellation wait on the kernel.
+
+static int gss_recv_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int gss_recv_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, struct io_uring_getevents_arg *arg)
+{
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, arg, sizeof(*arg));
+}
+
+/**
+ * @brief Unmaps and closes whatever part of the ring has been set up.
+ *
+ */
+static void gss_recv_uring_release(gss_recv_t *receiver)
+{
+    free(receiver->buffers);
+    receiver->buffers = NULL;
+
+    if (receiver->sqes != NULL)
+    {
+        munmap(receiver->sqes, receiver->sqes_size);
+        receiver->sqes = NULL;
+    }
+    if (receiver->cq_ring != NULL && receiver->cq_ring != receiver->sq_ring)
+    {
+        munmap(receiver->cq_ring, receiver->cq_ring_size);
+    }
+    receiver->cq_ring = NULL;
+    if (receiver->sq_ring != NULL)
+    {
+        munmap(receiver->sq_ring, receiver->sq_ring_size);
+        receiver->sq_ring = NULL;
+    }
+
+    if (receiver->ring_fd >= 0)
+    {
+        close(receiver->ring_fd);
+        receiver->ring_fd = -1;
+    }
+}
+
+/**
+ * @brief Queues a blank submission, to be submitted by the next gss_recv_uring_wait(...).
+ *
+ */
+static struct io_uring_sqe *gss_recv_uring_queue(gss_recv_t *receiver, uint8_t opcode, uint64_t user_data)
+{
+    uint32_t tail = *receiver->sq_tail;
+    uint32_t index = tail & receiver->sq_mask;
+
+    struct io_uring_sqe *sqe = &receiver->sqes[index];
+    memset(sqe, 0x0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = -1;
+    sqe->user_data = user_data;
+
+    receiver->sq_array[index] = index;
+    __atomic_store_n(receiver->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    receiver->to_submit++;
+
+    return sqe;
+}
+
+/**
+ * @brief Arms the multishot receive on the current socket.
+ *
+ */
+static void gss_recv_uring_arm(gss_recv_t *receiver)
+{
+    struct io_uring_sqe *sqe = gss_recv_uring_queue(receiver, IORING_OP_RECV, GSS_RECV_URING_DATA);
+    sqe->fd = receiver->socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = GSS_RECV_URING_BGID;
+    receiver->armed = true;
+}
+
+/**
+ * @brief Hands a buffer back to the kernel once its contents have been copied out.
+ *
+ */
+static void gss_recv_uring_provide(gss_recv_t *receiver, int bid)
+{
+    struct io_uring_sqe *sqe = gss_recv_uring_queue(receiver, IORING_OP_PROVIDE_BUFFERS, GSS_RECV_URING_PROVIDE);
+    sqe->fd = 1;
+    sqe->addr = (uint64_t)(uintptr_t)(receiver->buffers + (size_t)bid * GSS_RECV_URING_BUFFER_SIZE);
+    sqe->len = GSS_RECV_URING_BUFFER_SIZE;
+    sqe->off = bid;
+    sqe->buf_group = GSS_RECV_URING_BGID;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+/**
+ * @brief Submits anything queued and, if no completion is waiting, waits for one.
+ *
+ * @return int 1 once a completion may be reaped, -1 on error (errno is ETIME on a timeout).
+ */
+static int gss_recv_uring_wait(gss_recv_t *receiver, int timeout_s)
+{
+    // While completions are waiting, returned buffers are left to accumulate so they cost no system call of their own.
+    bool waiting = *receiver->cq_head != __atomic_load_n(receiver->cq_tail, __ATOMIC_ACQUIRE);
+    if (waiting && receiver->to_submit < receiver->sq_entries / 2)
+    {
+        return 1;
+    }
+
+    struct __kernel_timespec timeout;
+    timeout.tv_sec = timeout_s;
+    timeout.tv_nsec = 0;
+
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0x0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t)(uintptr_t)&timeout;
+
+    receiver->syscalls++;
+    int retval = gss_recv_uring_enter(receiver->ring_fd, receiver->to_submit, waiting ? 0 : 1, &arg);
+    if (retval < 0)
+    {
+        return errno == EINTR ? 1 : -1;
+    }
+
+    receiver->to_submit -= retval;
+    return 1;
+}
+
+/**
+ * @brief Takes the next completion off the ring.
+ *
+ * @return bool Whether there was one.
+ */
+static bool gss_recv_uring_reap(gss_recv_t *receiver, struct io_uring_cqe *cqe)
+{
+    uint32_t head = *receiver->cq_head;
+    if (head == __atomic_load_n(receiver->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    *cqe = receiver->cqes[head & receiver->cq_mask];
+    __atomic_store_n(receiver->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    if (cqe->user_data == GSS_RECV_URING_DATA && !(cqe->flags & IORING_CQE_F_MORE))
+    {
+        receiver->armed = false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Creates the ring and provides it the receive buffers.
+ *
+ * @return int 1 on success, -1 on failure (errno is set).
+ */
+static int gss_recv_uring_init(gss_recv_t *receiver)
+{
+    struct io_uring_params params;
+    memset(&params, 0x0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = GSS_RECV_URING_CQ_ENTRIES;
+
+    receiver->ring_fd = gss_recv_uring_setup(GSS_RECV_URING_ENTRIES, &params);
+    if (receiver->ring_fd < 0)
+    {
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG))
+    {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    receiver->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    receiver->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (receiver->cq_ring_size > receiver->sq_ring_size)
+        {
+            receiver->sq_ring_size = receiver->cq_ring_size;
+        }
+        receiver->cq_ring_size = receiver->sq_ring_size;
+    }
+
+    void *ring = mmap(NULL, receiver->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, receiver->ring_fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+    {
+        return -1;
+    }
+    receiver->sq_ring = ring;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        receiver->cq_ring = receiver->sq_ring;
+    }
+    else
+    {
+        ring = mmap(NULL, receiver->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, receiver->ring_fd, IORING_OFF_CQ_RING);
+        if (ring == MAP_FAILED)
+        {
+            return -1;
+        }
+        receiver->cq_ring = ring;
+    }
+
+    receiver->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring = mmap(NULL, receiver->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, receiver->ring_fd, IORING_OFF_SQES);
+    if (ring == MAP_FAILED)
+    {
+        return -1;
+    }
+    receiver->sqes = (struct io_uring_sqe *)ring;
+
+    unsigned char *sq = (unsigned char *)receiver->sq_ring;
+    unsigned char *cq = (unsigned char *)receiver->cq_ring;
+    receiver->sq_tail = (uint32_t *)(sq + params.sq_off.tail);
+    receiver->sq_mask = *(uint32_t *)(sq + params.sq_off.ring_mask);
+    receiver->sq_entries = params.sq_entries;
+    receiver->sq_array = (uint32_t *)(sq + params.sq_off.array);
+    receiver->cq_head = (uint32_t *)(cq + params.cq_off.head);
+    receiver->cq_tail = (uint32_t *)(cq + params.cq_off.tail);
+    receiver->cq_mask = *(uint32_t *)(cq + params.cq_off.ring_mask);
+    receiver->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    receiver->buffers = (unsigned char *)malloc((size_t)GSS_RECV_URING_BUFFERS * GSS_RECV_URING_BUFFER_SIZE);
+    if (receiver->buffers == NULL)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Provide every buffer at once, and wait for the result, which also shows whether the kernel supports provided buffers at all.
+    struct io_uring_sqe *sqe = gss_recv_uring_queue(receiver, IORING_OP_PROVIDE_BUFFERS, GSS_RECV_URING_PROVIDE);
+    sqe->fd = GSS_RECV_URING_BUFFERS;
+    sqe->addr = (uint64_t)(uintptr_t)receiver->buffers;
+    sqe->len = GSS_RECV_URING_BUFFER_SIZE;
+    sqe->off = 0;
+    sqe->buf_group = GSS_RECV_URING_BGID;
+
+    struct io_uring_cqe cqe;
+    if (gss_recv_uring_wait(receiver, GSS_RECV_URING_INTERNAL_WAIT_S) < 0 || !gss_recv_uring_reap(receiver, &cqe))
+    {
+        return -1;
+    }
+    if (cqe.res < 0)
+    {
+        errno = -cqe.res;
+        return -1;
+    }
+
+    return 1;
+}
+
+static ssize_t gss_recv_batch_fill(gss_recv_t *receiver)
+{
+    gss_frame_decoder_t *decoder = &receiver->decoder;
+    size_t space = sizeof(decoder->buffer) - decoder->length;
+
+    if (space == 0)
+    {
+        // A full decoder always holds a complete (or invalid) frame.
+        return 0;
+    }
+
+    while (true)
+    {
+        receiver->syscalls++;
+        ssize_t read_size = gss_frame_recv_stamped(receiver->socket, decoder->buffer + decoder->length, space, 0, receiver->stamped ? &receiver->kernel_ns : NULL);
+
+        if (read_size == 0)
+        {
+            return -404;
+        }
+        else if (read_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        decoder->length += read_size;
+        return read_size;
+    }
+}
+
+static ssize_t gss_recv_uring_fill(gss_recv_t *receiver, int timeout_s)
+{
+    gss_frame_decoder_t *decoder = &receiver->decoder;
+
+    while (true)
+    {
+        if (receiver->chunk_bid >= 0)
+        {
+            // Copy as much of the completion as fits; the rest waits for the next fill.
+            size_t size = sizeof(decoder->buffer) - decoder->length;
+            if (size > receiver->chunk_size - receiver->chunk_offset)
+            {
+                size = receiver->chunk_size - receiver->chunk_offset;
+            }
+
+            memcpy(decoder->buffer + decoder->length, receiver->buffers + (size_t)receiver->chunk_bid * GSS_RECV_URING_BUFFER_SIZE + receiver->chunk_offset, size);
+            decoder->length += size;
+            receiver->chunk_offset += size;
+
+            if (receiver->chunk_offset == receiver->chunk_size)
+            {
+                gss_recv_uring_provide(receiver, receiver->chunk_bid);
+                receiver->chunk_bid = -1;
+            }
+            return size;
+        }
+
+        if (!receiver->armed)
+        {
+            gss_recv_uring_arm(receiver);
+        }
+
+        if (gss_recv_uring_wait(receiver, timeout_s) < 0)
+        {
+            if (errno == ETIME)
+            {
+                errno = EAGAIN;
+            }
+            return -1;
+        }
+
+        struct io_uring_cqe cqe;
+        if (!gss_recv_uring_reap(receiver, &cqe) || cqe.user_data != GSS_RECV_URING_DATA)
+        {
+            continue;
+        }
+
+        if (cqe.res > 0)
+        {
+            receiver->chunk_bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            receiver->chunk_offset = 0;
+            receiver->chunk_size = cqe.res;
+        }
+        else if (cqe.res == 0)
+        {
+            return -404;
+        }
+        else if (cqe.res == -ENOBUFS)
+        {
+            // Every buffer was full before it could be reaped; the receive is re-armed along with their return.
+            continue;
+        }
+        else if (cqe.res == -EINVAL && receiver->frames == 0)
+        {
+            // Multishot receives need Linux 6.0; provided buffers alone only need 5.7.
+            dbwarnlf(YELLOW_FG "Multishot receive unsupported, receiving in batches instead.");
+            gss_recv_uring_release(receiver);
+            receiver->engine = GSS_RECV_BATCH;
+            return gss_recv_batch_fill(receiver);
+        }
+        else
+        {
+            errno = -cqe.res;
+            return -1;
+        }
+    }
+}
+
+int gss_recv_init(gss_recv_t *receiver, GSS_RECV_ENGINE engine, const char *t_tag)
+{
+    memset(receiver, 0x0, sizeof(gss_recv_t));
+    receiver->engine = engine;
+    receiver->socket = -1;
+    receiver->ring_fd = -1;
+    receiver->chunk_bid = -1;
+
+    if (engine == GSS_RECV_URING && gss_recv_uring_init(receiver) < 0)
+    {
+        dbwarnlf(YELLOW_FG "%sio_uring unavailable (%s), receiving in batches instead.", t_tag, strerror(errno));
+        gss_recv_uring_release(receiver);
+        receiver->engine = GSS_RECV_BATCH;
+    }
+
+    return engine == GSS_RECV_FRAME ? -1 : 1;
+}
+
+int gss_recv_start(gss_recv_t *receiver, int socket)
+{
+    receiver->socket = socket;
+    gss_frame_decoder_reset(&receiver->decoder);
+    receiver->offset = 0;
+    receiver->chunk_bid = -1;
+    receiver->syscalls = 0;
+    receiver->frames = 0;
+    return socket < 0 ? -1 : 1;
+}
+
+ssize_t gss_recv_fill(gss_recv_t *receiver, int timeout_s)
+{
+    // Everything handed out so far is done with; only a partial frame remains to be kept.
+    gss_frame_decoder_consume(&receiver->decoder, receiver->offset);
+    receiver->offset = 0;
+
+    if (receiver->engine == GSS_RECV_URING)
+    {
+        return gss_recv_uring_fill(receiver, timeout_s);
+    }
+    return gss_recv_batch_fill(receiver);
+}
+
+ssize_t gss_recv_next(gss_recv_t *receiver, unsigned char **frame)
+{
+    gss_frame_decoder_t *decoder = &receiver->decoder;
+
+    ssize_t frame_size = gss_frame_check(decoder->buffer + receiver->offset, decoder->length - receiver->offset);
+    if (frame_size > 0)
+    {
+        *frame = decoder->buffer + receiver->offset;
+        receiver->offset += frame_size;
+        receiver->frames++;
+    }
+    else if (frame_size < 0)
+    {
+        receiver->skipped = gss_frame_resync(decoder->buffer + receiver->offset, decoder->length - receiver->offset);
+        receiver->offset += receiver->skipped;
+    }
+
+    return frame_size;
+}
+
+void gss_recv_stop(gss_recv_t *receiver)
+{
+    if (receiver->engine != GSS_RECV_URING)
+    {
+        return;
+    }
+
+    if (receiver->chunk_bid >= 0)
+    {
+        gss_recv_uring_provide(receiver, receiver->chunk_bid);
+        receiver->chunk_bid = -1;
+    }
+
+    // The receive must be gone before the socket is closed and its number reused; whatever it still completes is discarded.
+    if (receiver->armed)
+    {
+        struct io_uring_sqe *sqe = gss_recv_uring_queue(receiver, IORING_OP_ASYNC_CANCEL, GSS_RECV_URING_CANCEL);
+        sqe->addr = GSS_RECV_URING_DATA;
+    }
+
+    // Returned buffers still queued are submitted along with the next connection's receive.
+    while (receiver->armed)
+    {
+        if (gss_recv_uring_wait(receiver, GSS_RECV_URING_INTERNAL_WAIT_S) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not cancel multishot receive: %s", strerror(errno));
+            break;
+        }
+
+        struct io_uring_cqe cqe;
+        while (gss_recv_uring_reap(receiver, &cqe))
+        {
+            if (cqe.user_data == GSS_RECV_URING_DATA && (cqe.flags & IORING_CQE_F_BUFFER))
+            {
+                gss_recv_uring_provide(receiver, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+        }
+    }
+
+    receiver->socket = -1;
+}
+
+void gss_recv_close(gss_recv_t *receiver)
+{
+    gss_recv_uring_release(receiver);
+}
+
+int gss_recv_parse_engine(const char *name, GSS_RECV_ENGINE *engine)
+{
+    if (strcmp(name, "frame") == 0)
+    {
+        *engine = GSS_RECV_FRAME;
+    }
+    else if (strcmp(name, "batch") == 0)
+    {
+        *engine = GSS_RECV_BATCH;
+    }
+    else if (strcmp(name, "uring") == 0)
+    {
+        *engine = GSS_RECV_URING;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 1;
+}
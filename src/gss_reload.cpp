@@ -0,0 +1,366 @@
+/**
+ * @file gss_reload.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "gss_reload.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+extern char **environ;
+
+typedef struct
+{
+    int port;
+    int socket;
+} gss_reload_socket_t;
+
+// Process-wide, like the sockets themselves.
+static pthread_mutex_t gss_reload_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *const *gss_reload_argv = NULL;
+static char gss_reload_path[PATH_MAX];
+static int gss_reload_expected = 0;
+static gss_reload_socket_t gss_reload_inherited[GSS_RELOAD_MAX_SOCKETS];
+static int gss_reload_num_inherited = 0;
+static gss_reload_socket_t gss_reload_sockets[GSS_RELOAD_MAX_SOCKETS];
+static int gss_reload_num_sockets = 0;
+static int gss_reload_ready_fd = -1;
+static const char *gss_reload_ready_path = NULL;
+static bool gss_reload_handed_over = false; // A new instance has taken over, and with it the ready file.
+static struct timespec gss_reload_start;
+
+void gss_reload_init(char *const argv[], int num_sockets, const char *ready_path)
+{
+    pthread_mutex_lock(&gss_reload_lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &gss_reload_start);
+    gss_reload_argv = argv;
+    gss_reload_expected = num_sockets;
+    gss_reload_ready_path = ready_path;
+
+    // Resolved now, so that a binary replaced at the same path is the one restarted.
+    if (realpath("/proc/self/exe", gss_reload_path) == NULL)
+    {
+        snprintf(gss_reload_path, sizeof(gss_reload_path), "%s", argv[0]);
+    }
+
+    const char *fds = getenv(GSS_RELOAD_FDS_ENV);
+    while (fds != NULL && *fds != '\0' && gss_reload_num_inherited < GSS_RELOAD_MAX_SOCKETS)
+    {
+        gss_reload_socket_t *inherited = &gss_reload_inherited[gss_reload_num_inherited];
+        int length = 0;
+        if (sscanf(fds, "%d:%d%n", &inherited->port, &inherited->socket, &length) != 2)
+        {
+            dbwarnlf(YELLOW_FG "Ignoring malformed %s.", GSS_RELOAD_FDS_ENV);
+            break;
+        }
+        gss_reload_num_inherited++;
+        fds += length;
+        fds += *fds == ',';
+    }
+
+    const char *ready = getenv(GSS_RELOAD_READY_ENV);
+    if (ready != NULL)
+    {
+        gss_reload_ready_fd = atoi(ready);
+        fcntl(gss_reload_ready_fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    for (int i = 0; i < gss_reload_num_inherited; i++)
+    {
+        fcntl(gss_reload_inherited[i].socket, F_SETFD, FD_CLOEXEC);
+    }
+
+    if (gss_reload_num_inherited > 0)
+    {
+        dbinfolf(GREEN_FG "Inherited %d listening sockets from the previous instance.", gss_reload_num_inherited);
+    }
+
+    pthread_mutex_unlock(&gss_reload_lock);
+}
+
+int gss_reload_inherit(int port)
+{
+    int socket = -1;
+
+    pthread_mutex_lock(&gss_reload_lock);
+    for (int i = 0; i < gss_reload_num_inherited; i++)
+    {
+        if (gss_reload_inherited[i].port == port)
+        {
+            socket = gss_reload_inherited[i].socket;
+            gss_reload_inherited[i] = gss_reload_inherited[--gss_reload_num_inherited];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gss_reload_lock);
+
+    return socket;
+}
+
+/**
+ * @brief Tells the service manager, if it asked to be told (sd_notify(3)'s protocol, without linking libsystemd), then writes the ready file.
+ *
+ */
+static void gss_reload_notify_ready()
+{
+    const char *notify_path = getenv(GSS_RELOAD_NOTIFY_ENV);
+    if (notify_path != NULL && (notify_path[0] == '/' || notify_path[0] == '@') && strlen(notify_path) < sizeof(((struct sockaddr_un *)NULL)->sun_path))
+    {
+        struct sockaddr_un address;
+        memset(&address, 0x0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, notify_path, strlen(notify_path));
+        if (address.sun_path[0] == '@')
+        {
+            // An abstract socket.
+            address.sun_path[0] = '\0';
+        }
+
+        // MAINPID, so that after a hot restart the service manager follows the new instance rather than the exiting one.
+        char state[64];
+        int length = snprintf(state, sizeof(state), "READY=1\nMAINPID=%d", (int)getpid());
+
+        int notify_socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (notify_socket < 0 || sendto(notify_socket, state, length, MSG_NOSIGNAL, (struct sockaddr *)&address, offsetof(struct sockaddr_un, sun_path) + strlen(notify_path)) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not notify %s: %s", notify_path, strerror(errno));
+        }
+        if (notify_socket >= 0)
+        {
+            close(notify_socket);
+        }
+    }
+
+    // Written whole under another name first, so that whoever waits for it never reads it half written.
+    if (gss_reload_ready_path != NULL)
+    {
+        char temporary_path[PATH_MAX];
+        snprintf(temporary_path, sizeof(temporary_path), "%s.%d", gss_reload_ready_path, (int)getpid());
+        FILE *file = fopen(temporary_path, "we");
+        if (file == NULL || fprintf(file, "%d\n", (int)getpid()) < 0 || fclose(file) != 0 || rename(temporary_path, gss_reload_ready_path) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not write ready file %s: %s", gss_reload_ready_path, strerror(errno));
+            unlink(temporary_path);
+        }
+    }
+}
+
+void gss_reload_listening(int port, int socket)
+{
+    pthread_mutex_lock(&gss_reload_lock);
+
+    if (gss_reload_num_sockets < GSS_RELOAD_MAX_SOCKETS)
+    {
+        gss_reload_sockets[gss_reload_num_sockets].port = port;
+        gss_reload_sockets[gss_reload_num_sockets].socket = socket;
+        gss_reload_num_sockets++;
+    }
+
+    if (gss_reload_num_sockets == gss_reload_expected)
+    {
+        // Ports the previous instance listened on which this one does not use.
+        for (int i = 0; i < gss_reload_num_inherited; i++)
+        {
+            dbinfolf("Closing inherited listening socket for port %d, which is no longer used.", gss_reload_inherited[i].port);
+            close(gss_reload_inherited[i].socket);
+        }
+        gss_reload_num_inherited = 0;
+
+        if (gss_reload_ready_fd >= 0)
+        {
+            if (write(gss_reload_ready_fd, "R", 1) != 1)
+            {
+                dbwarnlf(YELLOW_FG "Could not tell the previous instance this one is ready: %s", strerror(errno));
+            }
+            close(gss_reload_ready_fd);
+            gss_reload_ready_fd = -1;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        dbinfolf(GREEN_FG "Listening on all %d ports, %.1f ms after starting to bind.", gss_reload_num_sockets,
+                 (now.tv_sec - gss_reload_start.tv_sec) * 1e3 + (now.tv_nsec - gss_reload_start.tv_nsec) / 1e6);
+        gss_reload_notify_ready();
+    }
+
+    pthread_mutex_unlock(&gss_reload_lock);
+}
+
+/**
+ * @brief Closes every file descriptor from first through last. Only async-signal-safe calls, since it runs between fork(...) and execve(...).
+ *
+ */
+static void gss_reload_close_range(int first, int last)
+{
+    if (first > last)
+    {
+        return;
+    }
+#ifdef __NR_close_range
+    if (syscall(__NR_close_range, first, last, 0) == 0)
+    {
+        return;
+    }
+#endif
+    for (int fd = first; fd <= last; fd++)
+    {
+        close(fd);
+    }
+}
+
+int gss_reload_spawn()
+{
+    pthread_mutex_lock(&gss_reload_lock);
+
+    if (gss_reload_argv == NULL || gss_reload_num_sockets < gss_reload_expected)
+    {
+        pthread_mutex_unlock(&gss_reload_lock);
+        dberrorlf(RED_FG "Cannot restart before listening on every port.");
+        return -1;
+    }
+
+    int ready_pipe[2];
+    if (pipe2(ready_pipe, O_CLOEXEC) < 0)
+    {
+        pthread_mutex_unlock(&gss_reload_lock);
+        dberrorlf(RED_FG "Could not create restart pipe: %s", strerror(errno));
+        return -1;
+    }
+
+    // Everything the child needs is prepared before fork(...), which leaves it only async-signal-safe work.
+    char fds_env[sizeof(GSS_RELOAD_FDS_ENV) + GSS_RELOAD_MAX_SOCKETS * 24];
+    int length = snprintf(fds_env, sizeof(fds_env), "%s=", GSS_RELOAD_FDS_ENV);
+    int keep[GSS_RELOAD_MAX_SOCKETS + 1];
+    int num_keep = 0;
+    for (int i = 0; i < gss_reload_num_sockets; i++)
+    {
+        length += snprintf(fds_env + length, sizeof(fds_env) - length, "%s%d:%d", i > 0 ? "," : "", gss_reload_sockets[i].port, gss_reload_sockets[i].socket);
+        keep[num_keep++] = gss_reload_sockets[i].socket;
+    }
+    keep[num_keep++] = ready_pipe[1];
+
+    // In ascending order, for closing the gaps between them.
+    for (int i = 1; i < num_keep; i++)
+    {
+        for (int j = i; j > 0 && keep[j - 1] > keep[j]; j--)
+        {
+            int swap = keep[j];
+            keep[j] = keep[j - 1];
+            keep[j - 1] = swap;
+        }
+    }
+
+    char ready_env[sizeof(GSS_RELOAD_READY_ENV) + 16];
+    snprintf(ready_env, sizeof(ready_env), "%s=%d", GSS_RELOAD_READY_ENV, ready_pipe[1]);
+
+    int num_environ = 0;
+    while (environ[num_environ] != NULL)
+    {
+        num_environ++;
+    }
+    char **envp = new char *[num_environ + 3];
+    int num_envp = 0;
+    for (int i = 0; i < num_environ; i++)
+    {
+        if (strncmp(environ[i], GSS_RELOAD_FDS_ENV "=", sizeof(GSS_RELOAD_FDS_ENV)) != 0 && strncmp(environ[i], GSS_RELOAD_READY_ENV "=", sizeof(GSS_RELOAD_READY_ENV)) != 0)
+        {
+            envp[num_envp++] = environ[i];
+        }
+    }
+    envp[num_envp++] = fds_env;
+    envp[num_envp++] = ready_env;
+    envp[num_envp] = NULL;
+
+    struct rlimit limit;
+    int max_fd = getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < INT_MAX ? (int)limit.rlim_cur - 1 : 65535;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Only the listening sockets and the pipe survive; connections in particular must not, or closing them here would not end them.
+        int next = 3;
+        for (int i = 0; i < num_keep; i++)
+        {
+            gss_reload_close_range(next, keep[i] - 1);
+            fcntl(keep[i], F_SETFD, 0);
+            next = keep[i] + 1;
+        }
+        gss_reload_close_range(next, max_fd);
+
+        execve(gss_reload_path, gss_reload_argv, envp);
+        _exit(127);
+    }
+
+    pthread_mutex_unlock(&gss_reload_lock);
+    delete[] envp;
+    close(ready_pipe[1]);
+
+    if (pid < 0)
+    {
+        dberrorlf(RED_FG "Could not start a new instance: %s", strerror(errno));
+        close(ready_pipe[0]);
+        return -1;
+    }
+
+    dbinfolf("Started a new instance (pid %d) of %s, waiting for it to listen.", (int)pid, gss_reload_path);
+
+    struct pollfd ready;
+    ready.fd = ready_pipe[0];
+    ready.events = POLLIN;
+    char byte = 0;
+    int retval;
+    do
+    {
+        retval = poll(&ready, 1, GSS_RELOAD_READY_TIMEOUT_S * 1000);
+    } while (retval < 0 && errno == EINTR);
+    bool is_ready = retval > 0 && read(ready_pipe[0], &byte, 1) == 1;
+    close(ready_pipe[0]);
+
+    if (!is_ready)
+    {
+        dberrorlf(RED_FG "New instance (pid %d) did not become ready, stopping it and carrying on.", (int)pid);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    dbinfolf(GREEN_FG "New instance (pid %d) is listening.", (int)pid);
+    pthread_mutex_lock(&gss_reload_lock);
+    gss_reload_handed_over = true;
+    pthread_mutex_unlock(&gss_reload_lock);
+    return 1;
+}
+
+void gss_reload_exit()
+{
+    pthread_mutex_lock(&gss_reload_lock);
+    if (gss_reload_ready_path != NULL && !gss_reload_handed_over)
+    {
+        unlink(gss_reload_ready_path);
+    }
+    pthread_mutex_unlock(&gss_reload_lock);
+}
@@ -0,0 +1,241 @@
+/**
+ * @file gss_splice.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "gss_splice.hpp"
+#include "gss_frame.hpp"
+
+int gss_splice_init(gss_splice_t *splicer)
+{
+    if (pipe2(splicer->pipe_fds, O_CLOEXEC) < 0)
+    {
+        splicer->pipe_fds[0] = splicer->pipe_fds[1] = -1;
+        return -1;
+    }
+
+    // A pipe which holds a whole frame lets each splice out of the socket complete in one call; fall back to the default size if the limit is lower.
+    int pipe_size = fcntl(splicer->pipe_fds[1], F_SETPIPE_SZ, GSS_FRAME_MAX_SIZE);
+    if (pipe_size < 0)
+    {
+        pipe_size = fcntl(splicer->pipe_fds[1], F_GETPIPE_SZ);
+    }
+    splicer->pipe_size = pipe_size > 0 ? pipe_size : 4096;
+
+    return 1;
+}
+
+void gss_splice_close(gss_splice_t *splicer)
+{
+    if (splicer->pipe_fds[0] >= 0)
+    {
+        close(splicer->pipe_fds[0]);
+        close(splicer->pipe_fds[1]);
+    }
+    splicer->pipe_fds[0] = splicer->pipe_fds[1] = -1;
+}
+
+/**
+ * @brief Empties the pipe into buffer, or into a scratch buffer if buffer is NULL.
+ *
+ */
+static void gss_splice_drain(gss_splice_t *splicer, unsigned char *buffer, size_t size)
+{
+    unsigned char scratch[4096];
+
+    while (size > 0)
+    {
+        size_t chunk = buffer == NULL && size > sizeof(scratch) ? sizeof(scratch) : size;
+        ssize_t read_size = read(splicer->pipe_fds[0], buffer != NULL ? buffer : scratch, chunk);
+        if (read_size <= 0)
+        {
+            if (read_size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        size -= read_size;
+        if (buffer != NULL)
+        {
+            buffer += read_size;
+        }
+    }
+}
+
+/**
+ * @brief Sends all of size bytes, retrying on short writes.
+ *
+ * @return int 1 on success, -1 on failure.
+ */
+static int gss_splice_send(int dst, const void *data, size_t size, int flags)
+{
+    size_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t send_size = send(dst, (const unsigned char *)data + sent, size - sent, MSG_NOSIGNAL | flags);
+        if (send_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        sent += send_size;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Moves size bytes from the pipe to dst, or discards them once dst has failed.
+ *
+ */
+static void gss_splice_flush(gss_splice_t *splicer, int dst, size_t size, bool *dst_ok)
+{
+    while (*dst_ok && size > 0)
+    {
+        ssize_t out_pipe = splice(splicer->pipe_fds[0], NULL, dst, NULL, size, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (out_pipe <= 0)
+        {
+            if (out_pipe < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            *dst_ok = false;
+            break;
+        }
+        size -= out_pipe;
+    }
+
+    gss_splice_drain(splicer, NULL, size);
+}
+
+/**
+ * @brief Reads a frame's footer from src.
+ *
+ * @return ssize_t 0 on success, -404 if src was closed, or -1 on error.
+ */
+static ssize_t gss_splice_recv_footer(int src, gss_frame_footer_t *footer)
+{
+    size_t received = 0;
+    while (received < sizeof(gss_frame_footer_t))
+    {
+        ssize_t read_size = recv(src, (unsigned char *)footer + received, sizeof(gss_frame_footer_t) - received, MSG_WAITALL);
+        if (read_size == 0)
+        {
+            return -404;
+        }
+        else if (read_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        received += read_size;
+    }
+
+    return 0;
+}
+
+ssize_t gss_splice_forward(gss_splice_t *splicer, int src, int dst, const gss_frame_header_t *header, gss_frame_decoder_t *decoder)
+{
+    size_t remaining = header->payload_size;
+    size_t in_pipe = 0;
+    bool streaming = false;
+    bool dst_ok = true;
+    ssize_t retval = 0;
+
+    // The payload waits in the pipe until the footer has been checked, so that an invalid frame is not forwarded.
+    while (remaining > 0)
+    {
+        ssize_t read_size = splice(src, NULL, splicer->pipe_fds[1], NULL, remaining, SPLICE_F_MOVE | SPLICE_F_MORE | (streaming ? 0 : SPLICE_F_NONBLOCK));
+        if (read_size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (read_size < 0 && errno == EAGAIN && !streaming)
+        {
+            // The pipe is full, e.g. of a payload which arrived in many small segments: forward what it holds, and the rest as it arrives, before the footer is seen.
+            streaming = true;
+            dst_ok = gss_splice_send(dst, header, sizeof(gss_frame_header_t), MSG_MORE) > 0;
+            gss_splice_flush(splicer, dst, in_pipe, &dst_ok);
+            in_pipe = 0;
+            continue;
+        }
+        else if (read_size <= 0)
+        {
+            retval = read_size == 0 ? -404 : -1;
+            break;
+        }
+
+        remaining -= read_size;
+        if (streaming)
+        {
+            gss_splice_flush(splicer, dst, read_size, &dst_ok);
+        }
+        else
+        {
+            in_pipe += read_size;
+        }
+    }
+
+    // The footer is read rather than spliced, so that it can be checked; the payload's CRC cannot be, since the payload is never seen.
+    gss_frame_footer_t footer;
+    if (retval == 0)
+    {
+        retval = gss_splice_recv_footer(src, &footer);
+    }
+    bool valid = retval == 0 && footer.termination == GSS_FRAME_TERMINATION && footer.crc2 == header->crc1;
+
+    if (!streaming && !valid)
+    {
+        // Nothing has been sent to dst.
+        int error = errno;
+        if (retval == 0)
+        {
+            memcpy(decoder->buffer, header, sizeof(gss_frame_header_t));
+            gss_splice_drain(splicer, decoder->buffer + sizeof(gss_frame_header_t), in_pipe);
+            memcpy(decoder->buffer + sizeof(gss_frame_header_t) + header->payload_size, &footer, sizeof(footer));
+            decoder->length = GSS_FRAME_OVERHEAD + header->payload_size;
+            error = EBADMSG;
+            retval = -1;
+        }
+        else
+        {
+            gss_splice_drain(splicer, NULL, in_pipe);
+        }
+        errno = error;
+        return retval;
+    }
+
+    if (!streaming)
+    {
+        // MSG_MORE keeps the header from going out as its own segment (and stalling on Nagle) ahead of the payload.
+        dst_ok = gss_splice_send(dst, header, sizeof(gss_frame_header_t), MSG_MORE) > 0;
+        gss_splice_flush(splicer, dst, in_pipe, &dst_ok);
+    }
+
+    if (!valid || !dst_ok || gss_splice_send(dst, &footer, sizeof(footer), 0) < 0)
+    {
+        // dst has part of a frame, so whatever is sent on it next would be out of step.
+        shutdown(dst, SHUT_RDWR);
+        return 0;
+    }
+
+    return GSS_FRAME_OVERHEAD + header->payload_size;
+}
@@ -0,0 +1,430 @@
+/**
+ * @file gss_spool.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gss_spool.hpp"
+#include "gss_health.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_SPOOL_WRAP 0xffffffff // Record size marking the rest of the segment as unused.
+
+/**
+ * @brief Precedes every frame in the overflow segment. Records are padded to a multiple of 8 bytes.
+ *
+ */
+typedef struct
+{
+    uint64_t spooled_ns;
+    uint32_t frame_size;
+    uint32_t reserved;
+} gss_spool_record_t;
+
+static inline size_t gss_spool_record_size(size_t frame_size)
+{
+    return (sizeof(gss_spool_record_t) + frame_size + 7) & ~(size_t)7;
+}
+
+gss_spool_t *gss_spool_create(int vertex, const gss_spool_config_t *config, gss_pool_t *pool)
+{
+    gss_spool_t *spool = new gss_spool_t;
+
+    pthread_mutex_init(&spool->lock, NULL);
+    spool->pool = pool;
+    spool->ttl_ns = (uint64_t)config->ttl_s * 1000000000ULL;
+
+    spool->capacity = config->capacity;
+    spool->entries = new gss_spool_entry_t[spool->capacity];
+    spool->head = 0;
+    spool->count = 0;
+
+    spool->path[0] = '\0';
+    spool->fd = -1;
+    spool->segment = NULL;
+    spool->segment_size = 0;
+    spool->segment_head = 0;
+    spool->segment_tail = 0;
+    spool->segment_used = 0;
+    spool->segment_frames = 0;
+
+    spool->depth = 0;
+    spool->spooled = 0;
+    spool->flushed = 0;
+    spool->expired = 0;
+    spool->evicted = 0;
+
+    if (config->directory == NULL)
+    {
+        return spool;
+    }
+
+    if (mkdir(config->directory, 0755) != 0 && errno != EEXIST)
+    {
+        dberrorlf(FATAL "Could not create spool directory %s (%d).", config->directory, errno);
+        gss_spool_destroy(spool);
+        return NULL;
+    }
+
+    // Named for the process too, so that an instance started by a hot restart does not truncate the one still draining.
+    snprintf(spool->path, sizeof(spool->path), "%s/spool_%d_%d.bin", config->directory, (int)getpid(), vertex);
+    spool->segment_size = (size_t)config->segment_mb * 1000000;
+
+    spool->fd = open(spool->path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (spool->fd < 0 || ftruncate(spool->fd, spool->segment_size) != 0)
+    {
+        dberrorlf(FATAL "Could not create spool segment %s (%d).", spool->path, errno);
+        gss_spool_destroy(spool);
+        return NULL;
+    }
+
+    spool->segment = (unsigned char *)mmap(NULL, spool->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, spool->fd, 0);
+    if (spool->segment == MAP_FAILED)
+    {
+        spool->segment = NULL;
+        dberrorlf(FATAL "Could not map spool segment %s (%d).", spool->path, errno);
+        gss_spool_destroy(spool);
+        return NULL;
+    }
+
+    return spool;
+}
+
+/**
+ * @brief Reads the oldest record in the segment into a pool buffer and removes it. Called with the lock held.
+ *
+ * @return unsigned char* The frame, or NULL if the segment is empty. Removed either way, even if no pool buffer was available.
+ */
+static unsigned char *gss_spool_segment_pop(gss_spool_t *spool, size_t *frame_size, uint64_t *spooled_ns)
+{
+    if (spool->segment_frames == 0)
+    {
+        return NULL;
+    }
+
+    // Skip the unused end of the segment, if the writer wrapped here.
+    size_t remaining = spool->segment_size - spool->segment_head;
+    if (remaining < sizeof(gss_spool_record_t) || ((gss_spool_record_t *)(spool->segment + spool->segment_head))->frame_size == GSS_SPOOL_WRAP)
+    {
+        spool->segment_used -= remaining;
+        spool->segment_head = 0;
+    }
+
+    gss_spool_record_t *record = (gss_spool_record_t *)(spool->segment + spool->segment_head);
+    *frame_size = record->frame_size;
+    *spooled_ns = record->spooled_ns;
+
+    unsigned char *frame = gss_pool_get(spool->pool, record->frame_size);
+    if (frame != NULL)
+    {
+        memcpy(frame, record + 1, record->frame_size);
+    }
+
+    size_t record_size = gss_spool_record_size(record->frame_size);
+    spool->segment_head += record_size;
+    spool->segment_used -= record_size;
+    spool->segment_frames--;
+
+    if (spool->segment_frames == 0)
+    {
+        spool->segment_head = spool->segment_tail = spool->segment_used = 0;
+    }
+
+    return frame;
+}
+
+/**
+ * @brief Copies a frame into the segment if there is room. Called with the lock held.
+ *
+ * @return bool Whether it fit.
+ */
+static bool gss_spool_segment_push(gss_spool_t *spool, const unsigned char *frame, size_t frame_size, uint64_t spooled_ns)
+{
+    size_t record_size = gss_spool_record_size(frame_size);
+
+    if (spool->segment_frames == 0)
+    {
+        if (record_size > spool->segment_size)
+        {
+            return false;
+        }
+    }
+    else if (spool->segment_tail > spool->segment_head)
+    {
+        size_t to_end = spool->segment_size - spool->segment_tail;
+        if (record_size > to_end)
+        {
+            // Wrap, if the record fits ahead of the oldest one.
+            if (record_size > spool->segment_head)
+            {
+                return false;
+            }
+            if (to_end >= sizeof(gss_spool_record_t))
+            {
+                ((gss_spool_record_t *)(spool->segment + spool->segment_tail))->frame_size = GSS_SPOOL_WRAP;
+            }
+            spool->segment_used += to_end;
+            spool->segment_tail = 0;
+        }
+    }
+    else if (record_size > spool->segment_head - spool->segment_tail)
+    {
+        // Already wrapped; only the gap up to the oldest record is free.
+        return false;
+    }
+
+    gss_spool_record_t *record = (gss_spool_record_t *)(spool->segment + spool->segment_tail);
+    record->spooled_ns = spooled_ns;
+    record->frame_size = frame_size;
+    record->reserved = 0;
+    memcpy(record + 1, frame, frame_size);
+
+    spool->segment_tail += record_size;
+    spool->segment_used += record_size;
+    spool->segment_frames++;
+
+    return true;
+}
+
+/**
+ * @brief Moves the oldest records in the segment into the ring while it has room, so that the ring is full whenever the segment is not. Called with the lock held.
+ *
+ */
+static void gss_spool_refill(gss_spool_t *spool)
+{
+    while (spool->count < spool->capacity && spool->segment_frames > 0)
+    {
+        size_t frame_size;
+        uint64_t spooled_ns;
+        unsigned char *frame = gss_spool_segment_pop(spool, &frame_size, &spooled_ns);
+        if (frame == NULL)
+        {
+            // No pool buffer to read it back into.
+            spool->depth--;
+            spool->evicted++;
+            continue;
+        }
+
+        gss_spool_entry_t *entry = &spool->entries[(spool->head + spool->count) % spool->capacity];
+        entry->frame = frame;
+        entry->frame_size = frame_size;
+        entry->spooled_ns = spooled_ns;
+        spool->count++;
+    }
+}
+
+/**
+ * @brief Removes the oldest frame, wherever it is. Called with the lock held.
+ *
+ * @return unsigned char* The frame, or NULL if the spool is empty or the frame could not be read back.
+ */
+static unsigned char *gss_spool_take_oldest(gss_spool_t *spool, size_t *frame_size, uint64_t *spooled_ns, bool *taken)
+{
+    *taken = true;
+
+    if (spool->count > 0)
+    {
+        gss_spool_entry_t entry = spool->entries[spool->head];
+        spool->head = (spool->head + 1) % spool->capacity;
+        spool->count--;
+        spool->depth--;
+        *frame_size = entry.frame_size;
+        *spooled_ns = entry.spooled_ns;
+
+        // The slot goes to the oldest frame on disk, which also frees room in the segment for the newest.
+        gss_spool_refill(spool);
+        return entry.frame;
+    }
+
+    if (spool->segment_frames > 0)
+    {
+        spool->depth--;
+        return gss_spool_segment_pop(spool, frame_size, spooled_ns);
+    }
+
+    *taken = false;
+    return NULL;
+}
+
+void gss_spool_push(gss_spool_t *spool, unsigned char *frame, size_t frame_size)
+{
+    uint64_t now = gss_health_now_ns();
+
+    pthread_mutex_lock(&spool->lock);
+
+    // Once anything has overflowed to disk, newer frames must follow it there, or they would be flushed ahead of it.
+    bool stored = false;
+    while (!stored)
+    {
+        if (spool->segment_frames == 0 && spool->count < spool->capacity)
+        {
+            gss_spool_entry_t *entry = &spool->entries[(spool->head + spool->count) % spool->capacity];
+            entry->frame = frame;
+            entry->frame_size = frame_size;
+            entry->spooled_ns = now;
+            spool->count++;
+            stored = true;
+        }
+        else if (spool->segment != NULL && gss_spool_segment_push(spool, frame, frame_size, now))
+        {
+            gss_pool_put(spool->pool, frame);
+            stored = true;
+        }
+        else
+        {
+            // Full; the oldest frame makes room. It is in the ring, and its slot is refilled from the segment, so every eviction also frees room on disk.
+            size_t oldest_size;
+            uint64_t oldest_ns;
+            bool taken;
+            gss_pool_put(spool->pool, gss_spool_take_oldest(spool, &oldest_size, &oldest_ns, &taken));
+            if (!taken)
+            {
+                break;
+            }
+            spool->evicted++;
+        }
+    }
+
+    if (stored)
+    {
+        spool->depth++;
+        spool->spooled++;
+    }
+    else
+    {
+        // Larger than the whole segment.
+        gss_pool_put(spool->pool, frame);
+        spool->evicted++;
+    }
+
+    pthread_mutex_unlock(&spool->lock);
+}
+
+unsigned char *gss_spool_pop(gss_spool_t *spool, size_t *frame_size)
+{
+    if (gss_spool_depth(spool) == 0)
+    {
+        return NULL;
+    }
+
+    uint64_t now = gss_health_now_ns();
+    unsigned char *frame = NULL;
+
+    pthread_mutex_lock(&spool->lock);
+
+    while (true)
+    {
+        uint64_t spooled_ns;
+        bool taken;
+        frame = gss_spool_take_oldest(spool, frame_size, &spooled_ns, &taken);
+        if (!taken)
+        {
+            break;
+        }
+
+        if (spool->ttl_ns > 0 && now - spooled_ns > spool->ttl_ns)
+        {
+            gss_pool_put(spool->pool, frame);
+            frame = NULL;
+            spool->expired++;
+            continue;
+        }
+
+        if (frame != NULL)
+        {
+            spool->flushed++;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&spool->lock);
+
+    return frame;
+}
+
+void gss_spool_destroy(gss_spool_t *spool)
+{
+    // What is on disk goes with the segment.
+    for (size_t i = 0; i < spool->count; i++)
+    {
+        gss_pool_put(spool->pool, spool->entries[(spool->head + i) % spool->capacity].frame);
+    }
+
+    if (spool->segment != NULL)
+    {
+        munmap(spool->segment, spool->segment_size);
+    }
+    if (spool->fd >= 0)
+    {
+        close(spool->fd);
+    }
+    if (spool->path[0] != '\0')
+    {
+        unlink(spool->path);
+    }
+
+    pthread_mutex_destroy(&spool->lock);
+    delete[] spool->entries;
+    delete spool;
+}
+
+void gss_spool_get_stats(gss_spool_t *spool, gss_spool_stats_t *stats)
+{
+    pthread_mutex_lock(&spool->lock);
+    stats->depth = spool->depth;
+    stats->on_disk = spool->segment_frames;
+    pthread_mutex_unlock(&spool->lock);
+
+    stats->spooled = spool->spooled;
+    stats->flushed = spool->flushed;
+    stats->expired = spool->expired;
+    stats->evicted = spool->evicted;
+}
+
+int gss_spool_parse(const char *arg, gss_spool_config_t *config)
+{
+    int ttl_s, capacity = GSS_SPOOL_DEFAULT_CAPACITY;
+    if (sscanf(arg, "%d,%d", &ttl_s, &capacity) < 1 || ttl_s < 1 || capacity < 1)
+    {
+        return -1;
+    }
+
+    config->ttl_s = ttl_s;
+    config->capacity = capacity;
+    return 1;
+}
+
+int gss_spool_parse_overflow(char *arg, gss_spool_config_t *config)
+{
+    int segment_mb = GSS_SPOOL_DEFAULT_SEGMENT_MB;
+
+    char *separator = strrchr(arg, ',');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+        segment_mb = atoi(separator + 1);
+    }
+
+    if (arg[0] == '\0' || segment_mb < 1)
+    {
+        return -1;
+    }
+
+    config->directory = arg;
+    config->segment_mb = segment_mb;
+    return 1;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file gss_topology.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include "gss_topology.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_TOPOLOGY_MAX_LINE 256
+
+/**
+ * @brief Appends a vertex. Validity is checked once the whole topology is known.
+ *
+ */
+static int gss_topology_add_vertex(gss_topology_t *topology, int id, const char *name, int port)
+{
+    if (topology->num_vertices >= GSS_MAX_VERTICES)
+    {
+        return -1;
+    }
+
+    gss_vertex_config_t *vertex = &topology->vertices[topology->num_vertices++];
+    vertex->id = id;
+    snprintf(vertex->name, sizeof(vertex->name), "%s", name);
+    vertex->port = port;
+    CPU_ZERO(&vertex->cpus);
+    vertex->num_cpus = 0;
+    vertex->priority = 0;
+    vertex->busy_poll_us = 0;
+    vertex->netstat_bit = id < 8 ? 0x80 >> id : 0;
+    return 1;
+}
+
+/**
+ * @brief Checks the topology and builds its routing table.
+ *
+ * @param client_id The GUI client's vertex ID.
+ * @return int 1 if valid, -1 otherwise (the reason is printed).
+ */
+static int gss_topology_finish(gss_topology_t *topology, int client_id)
+{
+    memset(topology->route, GSS_ROUTE_NONE, sizeof(topology->route));
+    topology->route[topology->server_id] = GSS_ROUTE_SERVER;
+    topology->client = -1;
+
+    if (topology->num_vertices < 1)
+    {
+        dberrorlf(FATAL "Topology has no vertices.");
+        return -1;
+    }
+
+    for (int i = 0; i < topology->num_vertices; i++)
+    {
+        gss_vertex_config_t *vertex = &topology->vertices[i];
+
+        if (topology->route[vertex->id] != GSS_ROUTE_NONE)
+        {
+            dberrorlf(FATAL "Vertex %s has ID %d, which is already the server's or another vertex's.", vertex->name, vertex->id);
+            return -1;
+        }
+        for (int j = 0; j < i; j++)
+        {
+            if (topology->vertices[j].port == vertex->port)
+            {
+                dberrorlf(FATAL "Vertices %s and %s share port %d.", topology->vertices[j].name, vertex->name, vertex->port);
+                return -1;
+            }
+        }
+
+        topology->route[vertex->id] = i;
+        if (vertex->id == client_id)
+        {
+            topology->client = i;
+        }
+    }
+
+    if (topology->client < 0)
+    {
+        dberrorlf(FATAL "The client vertex (ID %d) is not defined.", client_id);
+        return -1;
+    }
+
+    return 1;
+}
+
+void gss_topology_default(gss_topology_t *topology)
+{
+    memset(topology, 0x0, sizeof(gss_topology_t));
+
+    gss_topology_add_vertex(topology, 0, "client", 54200);
+    gss_topology_add_vertex(topology, 1, "roof_uhf", 54210);
+    gss_topology_add_vertex(topology, 2, "roof_xband", 54220);
+    gss_topology_add_vertex(topology, 3, "haystack", 54230);
+    gss_topology_add_vertex(topology, 4, "track", 54240);
+    topology->server_id = 5;
+    topology->timeout_s = GSS_TOPOLOGY_DEFAULT_TIMEOUT_S;
+
+    gss_topology_finish(topology, 0);
+}
+
+int gss_topology_load(const char *path, gss_topology_t *topology)
+{
+    gss_topology_default(topology);
+    int client_id = topology->vertices[topology->client].id;
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        dberrorlf(FATAL "Could not open topology %s (%d).", path, errno);
+        return -1;
+    }
+
+    char line[GSS_TOPOLOGY_MAX_LINE];
+    int line_number = 0;
+    bool default_vertices = true;
+    int retval = 1;
+
+    while (retval > 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        char key[32], name[GSS_TOPOLOGY_NAME_SIZE], cpus[64] = "-";
+        int value, port, priority = 0, busy_poll_us = 0;
+        int fields = sscanf(line, "%31s", key);
+        if (fields < 1)
+        {
+            // Blank.
+            continue;
+        }
+
+        if (strcmp(key, "vertex") == 0)
+        {
+            if (default_vertices)
+            {
+                topology->num_vertices = 0;
+                default_vertices = false;
+            }
+
+            fields = sscanf(line, "%*s %d %23s %d %63s %d %d", &value, name, &port, cpus, &priority, &busy_poll_us);
+            if (fields < 3 || value < 0 || value > 255 || port < 1 || port > 65535 || priority < 0 || priority > 99 || busy_poll_us < 0)
+            {
+                dberrorlf(FATAL "%s:%d: expected vertex <id 0-255> <name> <port> [cpus|- [priority 0-99 [busy_poll_us]]].", path, line_number);
+                retval = -1;
+            }
+            else if (gss_topology_add_vertex(topology, value, name, port) < 0)
+            {
+                dberrorlf(FATAL "%s:%d: more than %d vertices.", path, line_number, GSS_MAX_VERTICES);
+                retval = -1;
+            }
+            else
+            {
+                // "-" (or the old -1) leaves the vertex unpinned.
+                gss_vertex_config_t *vertex = &topology->vertices[topology->num_vertices - 1];
+                if (strcmp(cpus, "-") != 0 && strcmp(cpus, "-1") != 0 && (vertex->num_cpus = gss_topology_parse_cpus(cpus, &vertex->cpus)) < 0)
+                {
+                    dberrorlf(FATAL "%s:%d: %s is neither a CPU list (e.g. 2-3,6) nor a NUMA node with CPUs (e.g. node1).", path, line_number, cpus);
+                    retval = -1;
+                }
+                vertex->priority = priority;
+                vertex->busy_poll_us = busy_poll_us;
+            }
+            continue;
+        }
+
+        if (sscanf(line, "%*s %d", &value) != 1 || value < 0)
+        {
+            dberrorlf(FATAL "%s:%d: expected %s <non-negative integer>.", path, line_number, key);
+            retval = -1;
+        }
+        else if (strcmp(key, "client") == 0 && value <= 255)
+        {
+            client_id = value;
+        }
+        else if (strcmp(key, "server") == 0 && value <= 255)
+        {
+            topology->server_id = value;
+        }
+        else if (strcmp(key, "max_clients") == 0)
+        {
+            topology->max_clients = value;
+        }
+        else if (strcmp(key, "txq_capacity") == 0)
+        {
+            topology->txq_capacity = value;
+        }
+        else if (strcmp(key, "socket_buffer_kb") == 0)
+        {
+            topology->socket_buffer_kb = value;
+        }
+        else if (strcmp(key, "timeout_s") == 0 && value > 0)
+        {
+            topology->timeout_s = value;
+        }
+        else
+        {
+            dberrorlf(FATAL "%s:%d: unknown key %s, or %d is out of range for it.", path, line_number, key, value);
+            retval = -1;
+        }
+    }
+
+    fclose(file);
+
+    if (retval < 0 || gss_topology_finish(topology, client_id) < 0)
+    {
+        return -1;
+    }
+
+    dbinfolf("Loaded %d vertices from %s.", topology->num_vertices, path);
+    return 1;
+}
+
+int gss_topology_configure_socket(int socket, const gss_topology_t *topology, int vertex)
+{
+    int retval = 1;
+
+    if (topology->socket_buffer_kb > 0)
+    {
+        int size = topology->socket_buffer_kb * 1024;
+        if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0 ||
+            setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0)
+        {
+            dbwarnlf(YELLOW_FG "Could not set socket buffer size: %s", strerror(errno));
+            retval = -1;
+        }
+    }
+
+    // Blocking receives (and epoll_wait(...)) spin on the device queue for this long before sleeping, trading CPU for wake-up latency.
+    const gss_vertex_config_t *config = &topology->vertices[vertex];
+    if (config->busy_poll_us > 0 && setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, &config->busy_poll_us, sizeof(config->busy_poll_us)) < 0)
+    {
+        dbwarnlf(YELLOW_FG "Could not busy poll %s's connection (raising SO_BUSY_POLL needs CAP_NET_ADMIN): %s", config->name, strerror(errno));
+        retval = -1;
+    }
+
+    return retval;
+}
+
+int gss_topology_create_thread(pthread_t *thread, const gss_vertex_config_t *vertex, void *(*routine)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (vertex->num_cpus > 0)
+    {
+        pthread_attr_setaffinity_np(&attr, sizeof(vertex->cpus), &vertex->cpus);
+    }
+    if (vertex->priority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0x0, sizeof(param));
+        param.sched_priority = vertex->priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int error = pthread_create(thread, &attr, routine, arg);
+    if (error == EPERM && vertex->priority > 0)
+    {
+        dbwarnlf(YELLOW_FG "Not permitted to run a thread for %s at SCHED_FIFO priority %d, running it at normal priority.", vertex->name, vertex->priority);
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        error = pthread_create(thread, &attr, routine, arg);
+    }
+    if (error == EINVAL && vertex->num_cpus > 0)
+    {
+        dbwarnlf(YELLOW_FG "Could not pin a thread for %s to its CPUs (are they online?), leaving it unpinned.", vertex->name);
+        pthread_attr_destroy(&attr);
+        pthread_attr_init(&attr);
+        error = pthread_create(thread, &attr, routine, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    return error == 0 ? 1 : -1;
+}
+
+int gss_topology_parse_cpus(const char *text, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+
+    // A NUMA node stands for the CPU list the kernel gives for it.
+    int node;
+    char trailing;
+    if (sscanf(text, "node%d%c", &node, &trailing) == 1)
+    {
+        char path[64], list[GSS_TOPOLOGY_MAX_LINE];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *file = node >= 0 ? fopen(path, "r") : NULL;
+        if (file == NULL)
+        {
+            return -1;
+        }
+        bool read = fgets(list, sizeof(list), file) != NULL;
+        fclose(file);
+        list[strcspn(list, "\n")] = '\0';
+        return read && list[0] != '\0' ? gss_topology_parse_cpus(list, cpus) : -1;
+    }
+
+    const char *next = text;
+    while (*next != '\0')
+    {
+        char *end;
+        long first = strtol(next, &end, 10);
+        long last = first;
+        if (end == next || first < 0)
+        {
+            return -1;
+        }
+        if (*end == '-')
+        {
+            next = end + 1;
+            last = strtol(next, &end, 10);
+            if (end == next || last < first)
+            {
+                return -1;
+            }
+        }
+        if (last >= CPU_SETSIZE)
+        {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            CPU_SET(cpu, cpus);
+        }
+
+        if (*end == ',')
+        {
+            end++;
+        }
+        else if (*end != '\0')
+        {
+            return -1;
+        }
+        next = end;
+    }
+
+    return CPU_COUNT(cpus) > 0 ? CPU_COUNT(cpus) : -1;
+}
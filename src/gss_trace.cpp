@@ -0,0 +1,246 @@
+/**
+ * @file gss_trace.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gss_trace.hpp"
+
+#define GSS_TRACE_OUT_SIZE 65536 // Formatted bytes collected before each write(2).
+#define GSS_TRACE_MAX_LINE 2048 // Longer messages are truncated.
+
+/**
+ * @brief One thread's pending messages. Single producer (the owning thread), single consumer (whoever holds gss_trace_flush_lock).
+ *
+ * Positions count bytes ever written or consumed; a record never straddles the end of the buffer.
+ *
+ */
+typedef struct gss_trace_ring
+{
+    unsigned char buffer[GSS_TRACE_RING_SIZE];
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    std::atomic<uint64_t> dropped;
+    size_t reserved; // Where the owning thread's reserved record starts, past any padding.
+    struct gss_trace_ring *next;
+} gss_trace_ring_t;
+
+static_assert(sizeof(gss_trace_record_t) % 8 == 0, "Records are 8-byte aligned in the ring.");
+
+std::atomic<int> gss_trace_level(GSS_TRACE_DEFAULT_LEVEL);
+
+static thread_local gss_trace_ring_t *gss_trace_local = NULL;
+static std::atomic<gss_trace_ring_t *> gss_trace_rings(NULL);
+static pthread_mutex_t gss_trace_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static char gss_trace_out[GSS_TRACE_OUT_SIZE];
+
+void gss_trace_set_level(int level)
+{
+    if (level < GSS_TRACE_ERROR)
+    {
+        level = GSS_TRACE_ERROR;
+    }
+    if (level > GSS_TRACE_COMPILE_LEVEL)
+    {
+        level = GSS_TRACE_COMPILE_LEVEL;
+    }
+    gss_trace_level = level;
+}
+
+/**
+ * @brief Allocates the calling thread's ring and links it where the flusher will find it.
+ *
+ * @return gss_trace_ring_t*
+ */
+static gss_trace_ring_t *gss_trace_register()
+{
+    gss_trace_ring_t *ring = new gss_trace_ring_t;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    ring->reserved = 0;
+
+    // Rings are never unlinked, so a lock-free push is all the list needs.
+    ring->next = gss_trace_rings.load();
+    while (!gss_trace_rings.compare_exchange_weak(ring->next, ring))
+    {
+    }
+
+    gss_trace_local = ring;
+    return ring;
+}
+
+unsigned char *gss_trace_reserve(size_t size)
+{
+    gss_trace_ring_t *ring = gss_trace_local != NULL ? gss_trace_local : gss_trace_register();
+
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t offset = head % GSS_TRACE_RING_SIZE;
+    size_t contiguous = GSS_TRACE_RING_SIZE - offset;
+
+    // A record that would straddle the end starts over at the beginning instead.
+    size_t padding = size > contiguous ? contiguous : 0;
+
+    if (size + padding > GSS_TRACE_RING_SIZE - (head - ring->tail.load(std::memory_order_acquire)))
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    if (padding >= sizeof(gss_trace_record_t))
+    {
+        ((gss_trace_record_t *)(ring->buffer + offset))->site = NULL;
+    }
+
+    ring->reserved = head + padding;
+    return ring->buffer + ring->reserved % GSS_TRACE_RING_SIZE;
+}
+
+void gss_trace_commit(size_t size)
+{
+    gss_trace_local->head.store(gss_trace_local->reserved + size, std::memory_order_release);
+}
+
+/**
+ * @brief Writes everything collected so far to stderr.
+ *
+ * @param length
+ */
+static void gss_trace_write_out(size_t *length)
+{
+    size_t written = 0;
+    while (written < *length)
+    {
+        ssize_t retval = write(STDERR_FILENO, gss_trace_out + written, *length - written);
+        if (retval < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (retval <= 0)
+        {
+            break;
+        }
+        written += retval;
+    }
+    *length = 0;
+}
+
+/**
+ * @brief Appends one formatted line, writing out first if it might not fit.
+ *
+ */
+static void gss_trace_append(size_t *length, const gss_trace_site_t *site, gss_trace_format_fn formatter, const unsigned char *args)
+{
+    if (GSS_TRACE_OUT_SIZE - *length < GSS_TRACE_MAX_LINE)
+    {
+        gss_trace_write_out(length);
+    }
+
+    char *line = gss_trace_out + *length;
+    size_t room = GSS_TRACE_MAX_LINE - sizeof("\x1b[0m\n");
+
+    int n = snprintf(line, room, "[%s:%d | %s] ", site->file, site->line, site->func);
+    n = n < (int)room ? n : (int)room - 1;
+
+    int m = formatter(line + n, room - n, site->format, args);
+    n += (m < 0) ? 0 : (m < (int)(room - n) ? m : (int)(room - n) - 1);
+
+    memcpy(line + n, "\x1b[0m\n", sizeof("\x1b[0m\n") - 1);
+    *length += n + sizeof("\x1b[0m\n") - 1;
+}
+
+void gss_trace_flush()
+{
+    pthread_mutex_lock(&gss_trace_flush_lock);
+
+    size_t length = 0;
+
+    for (gss_trace_ring_t *ring = gss_trace_rings.load(); ring != NULL; ring = ring->next)
+    {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+
+        while (tail < head)
+        {
+            size_t offset = tail % GSS_TRACE_RING_SIZE;
+            size_t contiguous = GSS_TRACE_RING_SIZE - offset;
+            gss_trace_record_t *record = (gss_trace_record_t *)(ring->buffer + offset);
+
+            if (contiguous < sizeof(gss_trace_record_t) || record->site == NULL)
+            {
+                tail += contiguous;
+                continue;
+            }
+
+            gss_trace_append(&length, record->site, record->formatter, ring->buffer + offset + sizeof(gss_trace_record_t));
+            tail += record->size;
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            if (GSS_TRACE_OUT_SIZE - length < GSS_TRACE_MAX_LINE)
+            {
+                gss_trace_write_out(&length);
+            }
+            length += snprintf(gss_trace_out + length, GSS_TRACE_MAX_LINE, "[%s:%d | %s] \x1b[33m%lu messages dropped, log ring full.\x1b[0m\n", __FILE__, __LINE__, __func__, (unsigned long)dropped);
+        }
+    }
+
+    gss_trace_write_out(&length);
+
+    pthread_mutex_unlock(&gss_trace_flush_lock);
+}
+
+static void *gss_trace_flusher_thread(void *)
+{
+    struct timespec interval;
+    interval.tv_sec = 0;
+    interval.tv_nsec = GSS_TRACE_FLUSH_MS * 1000000L;
+
+    while (true)
+    {
+        nanosleep(&interval, NULL);
+        gss_trace_flush();
+    }
+
+    return NULL;
+}
+
+int gss_trace_start()
+{
+    atexit(gss_trace_flush);
+
+    // The flusher must never be picked to handle a process-directed signal, so it starts with everything blocked.
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+
+    pthread_t pid;
+    int retval = pthread_create(&pid, NULL, gss_trace_flusher_thread, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (retval != 0)
+    {
+        return -1;
+    }
+    pthread_detach(pid);
+
+    return 1;
+}
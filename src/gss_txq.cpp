@@ -0,0 +1,619 @@
+/**
+ * @file gss_txq.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "gss_txq.hpp"
+#include "gss_frame.hpp"
+#include "gss_health.hpp"
+#include "gss_metrics.hpp"
+#include "gss_spool.hpp"
+#include "gss_trace.hpp"
+#include "meb_debug.hpp"
+
+#define GSS_TXQ_WRITER_TICK_MS 500 // How often an idle writer checks whether it should exit.
+
+gss_txq_t *gss_txq_create(size_t capacity, GSS_TXQ_POLICY policy, int t_index, NetDataServer *network_data, const std::atomic<uint32_t> *connected, pthread_mutex_t *tx_lock, gss_pool_t *pool)
+{
+    gss_txq_t *txq = new gss_txq_t;
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        gss_ring_init(&txq->rings[c], capacity);
+    }
+
+    if (sem_init(&txq->items, 0, 0) != 0)
+    {
+        dberrorlf(FATAL "Could not create transmit queue semaphore for ID:%d.", t_index);
+        for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+        {
+            gss_ring_free(&txq->rings[c]);
+        }
+        delete txq;
+        return NULL;
+    }
+
+    txq->pool = pool;
+
+    txq->policy = policy;
+    txq->active = true;
+    txq->t_index = t_index;
+    txq->network_data = network_data;
+    txq->connected = connected;
+    txq->tx_lock = tx_lock;
+    txq->socket_in_use = -1;
+    txq->close_in_use = false;
+    txq->failed_socket = -1;
+    txq->metrics = NULL;
+    txq->vertex = -1;
+    txq->spool = NULL;
+    txq->spool_unsent = false;
+    txq->latency = NULL;
+    txq->latency_pending.sample = NULL;
+    txq->server_id = 0xff;
+    txq->to_client = false;
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        txq->weights[c] = 0;
+        txq->class_sent[c] = 0;
+        txq->class_latency_ns[c] = 0;
+    }
+    txq->round_class = 0;
+    txq->round_credit = 0;
+
+    txq->high_water = 0;
+    txq->enqueued = 0;
+    txq->dropped_oldest = 0;
+    txq->dropped_newest = 0;
+    txq->backpressured = 0;
+    txq->sent = 0;
+    txq->send_failed = 0;
+    txq->spliced = 0;
+    txq->spliced_bytes = 0;
+    txq->sleeping = false;
+    txq->posted_ns = 0;
+    txq->wakeups = 0;
+    txq->wakeup_ns = 0;
+    txq->wakeup_max_ns = 0;
+    for (int b = 0; b < GSS_METRICS_NUM_BUCKETS; b++)
+    {
+        txq->wakeup_buckets[b] = 0;
+    }
+
+    return txq;
+}
+
+void gss_txq_destroy(gss_txq_t *txq)
+{
+    unsigned char *frame;
+    size_t frame_size;
+
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        while (gss_ring_pop(&txq->rings[c], &frame, &frame_size))
+        {
+            gss_pool_put(txq->pool, frame);
+        }
+        gss_ring_free(&txq->rings[c]);
+    }
+
+    sem_destroy(&txq->items);
+    delete txq;
+}
+
+GSS_TXQ_CLASS gss_txq_classify(const gss_txq_t *txq, const unsigned char *frame)
+{
+    const gss_frame_header_t *header = (const gss_frame_header_t *)frame;
+
+    if (header->origin == txq->server_id)
+    {
+        return GSS_TXQ_CONTROL;
+    }
+
+    switch ((NetType)(header->type & ~GSS_FRAME_TYPE_COMPRESSED))
+    {
+    case NetType::POLL:
+    case NetType::ACK:
+    case NetType::NACK:
+        return GSS_TXQ_CONTROL;
+    case NetType::DATA:
+    case NetType::TRACKING_DATA:
+        return txq->to_client ? GSS_TXQ_BULK : GSS_TXQ_COMMAND;
+    default:
+        return GSS_TXQ_COMMAND;
+    }
+}
+
+int gss_txq_configure_socket(int socket, int send_timeout_s)
+{
+    struct timeval timeout;
+    timeout.tv_sec = send_timeout_s;
+    timeout.tv_usec = 0;
+    if (setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout)) < 0)
+    {
+        dbwarnlf(YELLOW_FG "Could not set send timeout: %s", strerror(errno));
+        return -1;
+    }
+
+    int lowat = GSS_TXQ_NOTSENT_LOWAT;
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) < 0)
+    {
+        dbwarnlf(YELLOW_FG "Could not limit unsent bytes: %s", strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+void gss_txq_set_socket(gss_txq_t *txq, int socket)
+{
+    pthread_mutex_lock(txq->tx_lock);
+    txq->network_data->socket = socket;
+    txq->failed_socket = -1;
+    pthread_mutex_unlock(txq->tx_lock);
+}
+
+int gss_txq_claim_socket(gss_txq_t *txq)
+{
+    if (txq->network_data->socket < 0 || txq->socket_in_use >= 0 || txq->network_data->socket == txq->failed_socket)
+    {
+        return -1;
+    }
+
+    txq->socket_in_use = txq->network_data->socket;
+    return txq->socket_in_use;
+}
+
+void gss_txq_release_socket(gss_txq_t *txq)
+{
+    pthread_mutex_lock(txq->tx_lock);
+    if (txq->close_in_use)
+    {
+        close(txq->socket_in_use);
+        txq->close_in_use = false;
+    }
+    txq->socket_in_use = -1;
+    pthread_mutex_unlock(txq->tx_lock);
+}
+
+void gss_txq_fail_socket(gss_txq_t *txq)
+{
+    pthread_mutex_lock(txq->tx_lock);
+    shutdown(txq->socket_in_use, SHUT_RDWR);
+    txq->failed_socket = txq->socket_in_use;
+    pthread_mutex_unlock(txq->tx_lock);
+}
+
+void gss_txq_close_socket(gss_txq_t *txq)
+{
+    pthread_mutex_lock(txq->tx_lock);
+    int socket = txq->network_data->socket;
+    txq->network_data->socket = -1;
+    txq->failed_socket = -1;
+    if (socket >= 0 && socket == txq->socket_in_use)
+    {
+        // Closing it now would let the number be reused under the send; shutting it down ends the send instead.
+        shutdown(socket, SHUT_RDWR);
+        txq->close_in_use = true;
+    }
+    else if (socket >= 0)
+    {
+        close(socket);
+    }
+    pthread_mutex_unlock(txq->tx_lock);
+}
+
+void gss_txq_shutdown_socket(gss_txq_t *txq, int how)
+{
+    pthread_mutex_lock(txq->tx_lock);
+    if (txq->network_data->socket >= 0)
+    {
+        shutdown(txq->network_data->socket, how);
+    }
+    pthread_mutex_unlock(txq->tx_lock);
+}
+
+bool gss_txq_idle(gss_txq_t *txq)
+{
+    // The writer pops and claims the socket under one hold of tx_lock, so a popped frame is always seen as one or the other.
+    pthread_mutex_lock(txq->tx_lock);
+    bool idle = gss_txq_depth(txq) == 0 && txq->socket_in_use < 0;
+    pthread_mutex_unlock(txq->tx_lock);
+
+    return idle;
+}
+
+/**
+ * @brief gss_txq_push(...), which may wait for room if may_wait is set and the policy says so.
+ *
+ */
+static int gss_txq_enqueue(gss_txq_t *txq, unsigned char *frame, size_t frame_size, bool may_wait)
+{
+    gss_ring_t *ring = &txq->rings[gss_txq_classify(txq, frame)];
+    bool queued = gss_ring_push(ring, frame, frame_size);
+
+    if (!queued)
+    {
+        switch (txq->policy)
+        {
+        case GSS_TXQ_DROP_OLDEST:
+        {
+            // Evict until there is room; other producers may be racing for the freed slot.
+            while (!queued)
+            {
+                unsigned char *oldest;
+                size_t oldest_size;
+                if (gss_ring_pop(ring, &oldest, &oldest_size))
+                {
+                    // Take back the evicted frame's token so the writer does not wake for nothing.
+                    sem_trywait(&txq->items);
+                    gss_pool_put(txq->pool, oldest);
+                    txq->dropped_oldest++;
+                }
+                queued = gss_ring_push(ring, frame, frame_size);
+            }
+            break;
+        }
+        case GSS_TXQ_BACKPRESSURE:
+        {
+            if (!may_wait)
+            {
+                break;
+            }
+            txq->backpressured++;
+
+            struct timespec start, now;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            struct timespec pause = {0, 100000};
+
+            while (!queued && txq->active)
+            {
+                nanosleep(&pause, NULL);
+                queued = gss_ring_push(ring, frame, frame_size);
+
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 > GSS_TXQ_BACKPRESSURE_TIMEOUT_MS)
+                {
+                    break;
+                }
+            }
+            break;
+        }
+        case GSS_TXQ_DROP_NEWEST:
+        default:
+        {
+            break;
+        }
+        }
+    }
+
+    if (!queued)
+    {
+        gss_pool_put(txq->pool, frame);
+        txq->dropped_newest++;
+        return 0;
+    }
+
+    txq->enqueued++;
+
+    size_t depth = gss_txq_depth(txq);
+    size_t high_water = txq->high_water.load(std::memory_order_relaxed);
+    while (depth > high_water && !txq->high_water.compare_exchange_weak(high_water, depth, std::memory_order_relaxed))
+    {
+    }
+
+    // Only the first push to find the writer asleep is timed, so this costs one load on every other push.
+    uint64_t unposted = 0;
+    if (txq->sleeping.load(std::memory_order_relaxed) && txq->posted_ns.load(std::memory_order_relaxed) == 0)
+    {
+        txq->posted_ns.compare_exchange_strong(unposted, gss_health_now_ns(), std::memory_order_relaxed);
+    }
+
+    sem_post(&txq->items);
+
+    return 1;
+}
+
+int gss_txq_push(gss_txq_t *txq, unsigned char *frame, size_t frame_size)
+{
+    return gss_txq_enqueue(txq, frame, frame_size, true);
+}
+
+int gss_txq_try_push(gss_txq_t *txq, unsigned char *frame, size_t frame_size)
+{
+    return gss_txq_enqueue(txq, frame, frame_size, false);
+}
+
+void gss_txq_get_stats(gss_txq_t *txq, gss_txq_stats_t *stats)
+{
+    stats->depth = gss_txq_depth(txq);
+    stats->high_water = txq->high_water;
+    stats->enqueued = txq->enqueued;
+    stats->dropped_oldest = txq->dropped_oldest;
+    stats->dropped_newest = txq->dropped_newest;
+    stats->backpressured = txq->backpressured;
+    stats->sent = txq->sent;
+    stats->send_failed = txq->send_failed;
+    stats->spliced = txq->spliced;
+    stats->spliced_bytes = txq->spliced_bytes;
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        stats->class_depth[c] = gss_ring_depth(&txq->rings[c]);
+        stats->class_sent[c] = txq->class_sent[c];
+        stats->class_latency_ns[c] = txq->class_latency_ns[c];
+    }
+    stats->wakeups = txq->wakeups;
+    stats->wakeup_ns = txq->wakeup_ns;
+    stats->wakeup_max_ns = txq->wakeup_max_ns;
+    for (int b = 0; b < GSS_METRICS_NUM_BUCKETS; b++)
+    {
+        stats->wakeup_buckets[b] = txq->wakeup_buckets[b];
+    }
+}
+
+int gss_txq_parse_policy(const char *name, GSS_TXQ_POLICY *policy)
+{
+    if (strcmp(name, "oldest") == 0)
+    {
+        *policy = GSS_TXQ_DROP_OLDEST;
+    }
+    else if (strcmp(name, "newest") == 0)
+    {
+        *policy = GSS_TXQ_DROP_NEWEST;
+    }
+    else if (strcmp(name, "block") == 0)
+    {
+        *policy = GSS_TXQ_BACKPRESSURE;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+int gss_txq_parse_weights(const char *text, int weights[GSS_TXQ_NUM_CLASSES])
+{
+    if (strcmp(text, "strict") == 0)
+    {
+        for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+        {
+            weights[c] = 0;
+        }
+        return 1;
+    }
+
+    int length = 0;
+    if (sscanf(text, "%d,%d,%d%n", &weights[GSS_TXQ_CONTROL], &weights[GSS_TXQ_COMMAND], &weights[GSS_TXQ_BULK], &length) != 3 || text[length] != '\0')
+    {
+        return -1;
+    }
+
+    for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+    {
+        if (weights[c] < 1)
+        {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+const char *gss_txq_class_name(int tx_class)
+{
+    static const char *names[GSS_TXQ_NUM_CLASSES] = {"control", "command", "bulk"};
+    return tx_class >= 0 && tx_class < GSS_TXQ_NUM_CLASSES ? names[tx_class] : "unknown";
+}
+
+/**
+ * @brief Whether the destination is connected (and so its frames should be sent rather than dropped or spooled).
+ *
+ */
+static inline bool gss_txq_connected(const gss_txq_t *txq)
+{
+    return (txq->connected->load(std::memory_order_acquire) & (1u << txq->t_index)) != 0;
+}
+
+/**
+ * @brief Takes the next frame to send: from the most urgent class with any under strict priority, otherwise from the class whose turn it is in the weighted round robin, moving on once its weight is used up or it runs dry.
+ *
+ * @return bool Whether a frame was taken.
+ */
+static bool gss_txq_pop(gss_txq_t *txq, unsigned char **frame, size_t *frame_size)
+{
+    if (txq->weights[0] == 0)
+    {
+        for (int c = 0; c < GSS_TXQ_NUM_CLASSES; c++)
+        {
+            if (gss_ring_pop(&txq->rings[c], frame, frame_size))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One more turn than there are classes, so the class the round started on is tried again with fresh credit.
+    for (int turn = 0; turn <= GSS_TXQ_NUM_CLASSES; turn++)
+    {
+        if (txq->round_credit > 0 && gss_ring_pop(&txq->rings[txq->round_class], frame, frame_size))
+        {
+            txq->round_credit--;
+            return true;
+        }
+
+        txq->round_class = (txq->round_class + 1) % GSS_TXQ_NUM_CLASSES;
+        txq->round_credit = txq->weights[txq->round_class];
+    }
+
+    return false;
+}
+
+void *gss_txq_writer_thread(void *txq_vp)
+{
+    gss_txq_t *txq = (gss_txq_t *)txq_vp;
+
+    char t_tag[32];
+    snprintf(t_tag, sizeof(t_tag), "[TXT_%d] ", txq->t_index);
+
+    while (txq->active)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += GSS_TXQ_WRITER_TICK_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // The semaphore is only a wake-up hint (evictions make its count approximate), so drain everything on every wake-up or tick.
+        txq->posted_ns.store(0, std::memory_order_relaxed);
+        txq->sleeping.store(true, std::memory_order_seq_cst);
+        sem_timedwait(&txq->items, &deadline);
+        txq->sleeping.store(false, std::memory_order_relaxed);
+
+        uint64_t posted_ns = txq->posted_ns.load(std::memory_order_relaxed), now_ns = gss_health_now_ns();
+        if (posted_ns != 0 && now_ns >= posted_ns)
+        {
+            uint64_t wakeup_ns = now_ns - posted_ns;
+            txq->wakeups++;
+            txq->wakeup_ns += wakeup_ns;
+            txq->wakeup_buckets[gss_metrics_bucket(wakeup_ns)]++;
+            if (wakeup_ns > txq->wakeup_max_ns)
+            {
+                txq->wakeup_max_ns = wakeup_ns;
+            }
+        }
+
+        // A sampled frame's transmit timestamp may have arrived since it was sent, or it may have waited long enough.
+        if (txq->latency_pending.sample != NULL)
+        {
+            pthread_mutex_lock(txq->tx_lock);
+            gss_latency_reap(txq->latency, &txq->latency_pending, gss_txq_connected(txq) ? txq->network_data->socket : -1);
+            pthread_mutex_unlock(txq->tx_lock);
+        }
+
+        while (true)
+        {
+            // Pop and claim the socket under one hold of the lock, so that whoever holds it (see gss_route_splice(...)) knows no popped frame is still waiting to be sent.
+            unsigned char *frame = NULL;
+            size_t frame_size;
+            pthread_mutex_lock(txq->tx_lock);
+            bool ready = gss_txq_connected(txq) && txq->network_data->socket >= 0 && txq->network_data->socket != txq->failed_socket;
+
+            if (ready && txq->socket_in_use >= 0)
+            {
+                // A splice is sending; it wakes this writer when it is done.
+                pthread_mutex_unlock(txq->tx_lock);
+                break;
+            }
+
+            // Frames spooled while the destination was offline are older than anything queued since, so they go first.
+            if (ready && txq->spool != NULL)
+            {
+                frame = gss_spool_pop(txq->spool, &frame_size);
+            }
+            if (frame == NULL && !gss_txq_pop(txq, &frame, &frame_size))
+            {
+                pthread_mutex_unlock(txq->tx_lock);
+                break;
+            }
+
+            if (ready)
+            {
+                // The lock is not held while sending, so closing the connection never waits on a peer which has stopped reading.
+                int socket = gss_txq_claim_socket(txq);
+                pthread_mutex_unlock(txq->tx_lock);
+
+                // A sampled frame may ask the kernel when it actually went out.
+                unsigned char *sample = gss_latency_dequeued(txq->latency, frame, frame_size, txq->t_index);
+                int stamps = 0;
+                ssize_t sent_size;
+                if (sample != NULL && gss_latency_may_stamp(txq->latency, &txq->latency_pending))
+                {
+                    sent_size = gss_frame_send_stamped(socket, frame, frame_size, &stamps);
+                }
+                else
+                {
+                    sent_size = gss_frame_send(socket, frame, frame_size);
+                }
+
+                if (sent_size < 0)
+                {
+                    int error = errno;
+                    gss_pool_put(txq->pool, sample);
+                    txq->send_failed++;
+                    gss_metrics_failed(txq->metrics, txq->vertex, GSS_METRICS_SEND_FAILED);
+                    dbwarnlf(RED_FG "%sSend to %d failed, shutting down the connection: %s", t_tag, txq->t_index, strerror(error));
+                    gss_txq_fail_socket(txq);
+                }
+                else
+                {
+                    txq->sent++;
+
+                    GSS_TXQ_CLASS tx_class = gss_txq_classify(txq, frame);
+                    uint64_t stamp_ns = gss_pool_stamp(frame), now_ns = gss_health_now_ns();
+                    if (stamp_ns != 0 && now_ns >= stamp_ns)
+                    {
+                        txq->class_sent[tx_class]++;
+                        txq->class_latency_ns[tx_class] += now_ns - stamp_ns;
+                    }
+                    if (txq->metrics != NULL)
+                    {
+                        gss_metrics_sent(txq->metrics, frame, frame_size, tx_class, stamp_ns, now_ns);
+                    }
+                    if (sample != NULL)
+                    {
+                        gss_latency_sent(txq->latency, &txq->latency_pending, sample, stamps);
+                    }
+                }
+                gss_latency_reap(txq->latency, &txq->latency_pending, socket);
+                gss_txq_release_socket(txq);
+            }
+            else if (txq->spool != NULL && txq->spool_unsent)
+            {
+                // The connection dropped with this frame still queued; keep it for the reconnect.
+                gss_spool_push(txq->spool, frame, frame_size);
+                pthread_mutex_unlock(txq->tx_lock);
+                continue;
+            }
+            else
+            {
+                pthread_mutex_unlock(txq->tx_lock);
+                txq->send_failed++;
+                gss_metrics_failed(txq->metrics, txq->vertex, GSS_METRICS_NOT_READY);
+                dbwarnlf(RED_FG "%sDropping queued frame for ID:%d since the connection is not ready.", t_tag, txq->t_index);
+            }
+
+            gss_pool_put(txq->pool, frame);
+        }
+    }
+
+    // Whatever timestamp has not come by now is not coming.
+    gss_latency_reap(txq->latency, &txq->latency_pending, -1);
+
+    gss_txq_stats_t stats;
+    gss_txq_get_stats(txq, &stats);
+    dbwarnlf(YELLOW_FG "%sWriter deactivated (depth %lu, high-water %lu, enqueued %lu, dropped %lu/%lu, backpressured %lu, sent %lu, failed %lu, spliced %lu).", t_tag,
+             stats.depth, stats.high_water, stats.enqueued, stats.dropped_oldest, stats.dropped_newest, stats.backpressured, stats.sent, stats.send_failed, stats.spliced);
+
+    return NULL;
+}
@@ -21,10 +21,182 @@
 #include <string.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "network.hpp"
 #include "gss.hpp"
+#include "gss_reactor.hpp"
+#include "gss_txq.hpp"
+#include "gss_pool.hpp"
+#include "gss_log.hpp"
+#include "gss_metrics.hpp"
+#include "gss_spool.hpp"
+#include "gss_dedup.hpp"
+#include "gss_compress.hpp"
+#include "gss_latency.hpp"
+#include "gss_reload.hpp"
+#include "gss_topology.hpp"
+#include "gss_trace.hpp"
 #include "meb_debug.hpp"
 
+/**
+ * @brief Stops the writer threads and frees everything main(...) created.
+ *
+ * @param global
+ */
+static void gss_main_cleanup(global_data_t *global)
+{
+    if (global->health.heartbeat_ms > 0)
+    {
+        global->health.active = false;
+        pthread_join(global->health_pid, NULL);
+    }
+
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        global->txq[i]->active = false;
+    }
+
+    gss_print_stats(global);
+
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        pthread_join(global->tx_pid[i], NULL);
+        gss_txq_destroy(global->txq[i]);
+        pthread_mutex_destroy(&global->tx_lock[i]);
+        delete global->network_data[i];
+    }
+
+    for (int i = 0; i < global->topology.num_vertices; i++)
+    {
+        if (global->spool[i] != NULL)
+        {
+            gss_spool_destroy(global->spool[i]);
+        }
+        if (global->dedup[i] != NULL)
+        {
+            gss_dedup_destroy(global->dedup[i]);
+        }
+    }
+
+    // Writers are done routing, so whatever is in the log's ring now is all there will be.
+    if (global->log != NULL)
+    {
+        global->log->active = false;
+        pthread_join(global->log_pid, NULL);
+        gss_log_destroy(global->log);
+    }
+    if (global->capture != NULL)
+    {
+        global->capture->active = false;
+        pthread_join(global->capture_pid, NULL);
+        gss_log_destroy(global->capture);
+    }
+
+    if (global->metrics != NULL)
+    {
+        global->metrics->active = false;
+        pthread_join(global->metrics_pid, NULL);
+        gss_metrics_destroy(global->metrics);
+    }
+
+    // After the metrics, which read its counters.
+    if (global->compress != NULL)
+    {
+        gss_compress_destroy(global->compress);
+    }
+
+    // Likewise after the writers, which complete its samples.
+    if (global->latency != NULL)
+    {
+        global->latency->active = false;
+        if (global->latency->file != NULL)
+        {
+            pthread_join(global->latency_pid, NULL);
+        }
+        gss_latency_destroy(global->latency);
+    }
+
+    pthread_mutex_destroy(&global->netstat_lock);
+    gss_pool_destroy(global->pool);
+
+    gss_reload_exit();
+}
+
+/**
+ * @brief Handles the signals the server responds to, which are blocked in every other thread so they are always delivered here:
+ *
+ * SIGUSR1 (kill -USR1 <pid>) prints the server's counters.
+ * SIGTERM and SIGINT shut down gracefully (see gss_shutdown(...)), within the drain timeout; a second one exits immediately.
+ * SIGHUP restarts without closing the listening sockets (see gss_reload.hpp), then shuts this instance down gracefully.
+ *
+ * @return void* NULL
+ */
+static void *gss_main_signal_thread(void *global_vp)
+{
+    global_data_t *global = (global_data_t *)global_vp;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+
+    bool expired = false;
+    while (true)
+    {
+        // Once shutting down, also keeps the shutdown to its deadline (see gss_shutdown_expire(...)).
+        int signal_number;
+        if (global->stopping)
+        {
+            struct timespec tick = {0, GSS_SHUTDOWN_TICK_MS * 1000000};
+            signal_number = sigtimedwait(&signals, NULL, &tick);
+            if (signal_number < 0)
+            {
+                if (!expired && gss_health_now_ns() >= global->drain_deadline_ns)
+                {
+                    gss_shutdown_expire(global);
+                    expired = true;
+                }
+                continue;
+            }
+        }
+        else if (sigwait(&signals, &signal_number) != 0)
+        {
+            continue;
+        }
+
+        switch (signal_number)
+        {
+        case SIGUSR1:
+            gss_print_stats(global);
+            break;
+        case SIGTERM:
+        case SIGINT:
+            if (global->stopping)
+            {
+                dberrorlf(RED_FG "Exiting without waiting for the transmit queues.");
+                _exit(1);
+            }
+            gss_shutdown(global);
+            break;
+        case SIGHUP:
+            if (global->stopping)
+            {
+                dbwarnlf(YELLOW_FG "Already shutting down, not restarting.");
+            }
+            else if (gss_reload_spawn() > 0)
+            {
+                gss_shutdown(global);
+            }
+            break;
+        }
+    }
+
+    return NULL;
+}
+
 int main(int argc, char *argv[])
 {
     // Ignores broken pipe signal, which is sent to the calling process when writing to a nonexistent socket (
@@ -35,46 +207,501 @@ int main(int argc, char *argv[])
     // Broken pipe signal will crash the process, and it caused by sending data to a closed socket.
     signal(SIGPIPE, SIG_IGN);
 
+    // Debug messages are formatted and written by a background thread (see gss_trace.hpp).
+    gss_trace_start();
+
     // Create global.
     global_data_t global[1] = {0};
+    global->health.active = true;
 
-    // Create NUM_PORTS network_data objects with their corresponding ports.
-    for (int i = 0; i < NUM_PORTS; i++)
+    // -C file loads the vertices, their ports and CPUs, and buffer and timeout settings (see gss.conf); without it the original five vertices are used.
+    // -r N runs N epoll reactor threads instead of one blocking RX thread per port.
+    // -q oldest|newest|block and -c N (overriding the topology's txq_capacity) set the overflow policy and capacity of every transmit queue.
+    // -p strict|control,command,bulk sends each queue's priority classes in strict priority order (default) or weighted round robin (see gss_txq.hpp).
+    // -z N splices frames with at least N payload bytes straight to their destination (RX thread mode only).
+    // -e frame|batch|uring sets how RX threads receive: a frame at a time, or in batches via recv or a multishot io_uring receive (see gss_recv.hpp).
+    // -l dir logs every routed frame to binary files in dir, rotating every -L MB (see tools/gss_logdump).
+    // -R dir captures every received frame and connection change to binary files in dir, also rotating every -L MB, for replay (see gss_capture.hpp and bench/gss_replay).
+    // -v 0-3 sets the debug message level (error, warn, info, debug).
+    // -n pushes a netstat frame to the GUI clients whenever a connection changes.
+    // -m N (overriding the topology's max_clients) accepts up to N GUI clients at once, and -a any|first sets which of them may send frames to the radios.
+    // -M port serves Prometheus metrics on 127.0.0.1:port (see gss_metrics.hpp).
+    // -S ttl_s[,frames] spools frames for offline vertices, overflowing to segments in -D dir[,mb] (see gss_spool.hpp).
+    // -d ms drops frames identical to one the same vertex sent within the last ms (see gss_dedup.hpp).
+    // -Z N lets GUI clients ask for their frames LZ4 compressed, for payloads of at least N bytes (see gss_compress.hpp).
+    // -H N[,file] times every Nth frame through each hop from the kernel receiving it to the kernel sending it on, writing them to file as a Chrome trace if given (see gss_latency.hpp).
+    // -k idle,interval,count enables TCP keepalive, -u ms sets TCP_USER_TIMEOUT, and -b ms[,misses] enables heartbeats (see gss_health.hpp).
+    // -T s sets how long a graceful shutdown (SIGTERM, or SIGHUP's restart) may take, most of it waiting for the transmit queues to empty.
+    // -P file writes the server's PID to file once every port is listening, and removes it on exit (see gss_reload.hpp).
+    const char *topology_path = NULL;
+    int num_reactors = 0;
+    int splice_threshold = 0;
+    GSS_RECV_ENGINE recv_engine = GSS_RECV_FRAME;
+    const char *log_directory = NULL;
+    const char *capture_directory = NULL;
+    uint64_t log_rotate_size = GSS_LOG_DEFAULT_ROTATE_SIZE;
+    bool netstat_push = false;
+    int metrics_port = 0;
+    const char *ready_path = NULL;
+    gss_spool_config_t spool_config = {0, GSS_SPOOL_DEFAULT_CAPACITY, NULL, GSS_SPOOL_DEFAULT_SEGMENT_MB};
+    int dedup_window_ms = 0;
+    int compress_min_size = 0;
+    int latency_every = 0;
+    const char *latency_path = NULL;
+    int max_clients = 0;
+    GSS_UPLINK_POLICY uplink_policy = GSS_UPLINK_ANY;
+    GSS_TXQ_POLICY txq_policy = GSS_TXQ_DROP_OLDEST;
+    int txq_capacity = 0;
+    int txq_weights[GSS_TXQ_NUM_CLASSES] = {0};
+    int drain_s = GSS_DRAIN_DEFAULT_S;
+    int opt;
+    while ((opt = getopt(argc, argv, "C:r:q:c:p:z:e:l:L:R:v:nm:a:M:S:D:d:Z:H:k:u:b:T:P:")) != -1)
     {
-        global->network_data[i] = new NetDataServer((NetPort)((int)NetPort::CLIENT + (10 * i)));
+        switch (opt)
+        {
+        case 'C':
+            topology_path = optarg;
+            break;
+        case 'r':
+            num_reactors = atoi(optarg);
+            if (num_reactors < 1)
+            {
+                dberrorlf(FATAL "Number of reactors must be positive.");
+                return -1;
+            }
+            break;
+        case 'q':
+            if (gss_txq_parse_policy(optarg, &txq_policy) < 0)
+            {
+                dberrorlf(FATAL "Unknown transmit queue policy %s (expected oldest, newest, or block).", optarg);
+                return -1;
+            }
+            break;
+        case 'c':
+            txq_capacity = atoi(optarg);
+            if (txq_capacity < 1)
+            {
+                dberrorlf(FATAL "Transmit queue capacity must be positive.");
+                return -1;
+            }
+            break;
+        case 'p':
+            if (gss_txq_parse_weights(optarg, txq_weights) < 0)
+            {
+                dberrorlf(FATAL "Transmit scheduling must be strict or control,command,bulk weights (all positive).");
+                return -1;
+            }
+            break;
+        case 'z':
+            splice_threshold = atoi(optarg);
+            if (splice_threshold < 1)
+            {
+                dberrorlf(FATAL "Splice threshold must be positive.");
+                return -1;
+            }
+            break;
+        case 'e':
+            if (gss_recv_parse_engine(optarg, &recv_engine) < 0)
+            {
+                dberrorlf(FATAL "Unknown receive engine %s (expected frame, batch, or uring).", optarg);
+                return -1;
+            }
+            break;
+        case 'l':
+            log_directory = optarg;
+            break;
+        case 'L':
+            if (atoi(optarg) < 1)
+            {
+                dberrorlf(FATAL "Log rotation size must be positive.");
+                return -1;
+            }
+            log_rotate_size = (uint64_t)atoi(optarg) * 1000000ULL;
+            break;
+        case 'R':
+            capture_directory = optarg;
+            break;
+        case 'v':
+            gss_trace_set_level(atoi(optarg));
+            break;
+        case 'n':
+            netstat_push = true;
+            break;
+        case 'm':
+            max_clients = atoi(optarg);
+            if (max_clients < 1)
+            {
+                dberrorlf(FATAL "Number of clients must be positive.");
+                return -1;
+            }
+            break;
+        case 'a':
+            if (gss_parse_uplink_policy(optarg, &uplink_policy) < 0)
+            {
+                dberrorlf(FATAL "Unknown uplink policy %s (expected any or first).", optarg);
+                return -1;
+            }
+            break;
+        case 'M':
+            metrics_port = atoi(optarg);
+            if (metrics_port < 1 || metrics_port > 65535)
+            {
+                dberrorlf(FATAL "Metrics port must be between 1 and 65535.");
+                return -1;
+            }
+            break;
+        case 'S':
+            if (gss_spool_parse(optarg, &spool_config) < 0)
+            {
+                dberrorlf(FATAL "Spool must be ttl_s[,frames] (both positive).");
+                return -1;
+            }
+            break;
+        case 'D':
+            if (gss_spool_parse_overflow(optarg, &spool_config) < 0)
+            {
+                dberrorlf(FATAL "Spool overflow must be directory[,segment_mb] (size positive).");
+                return -1;
+            }
+            break;
+        case 'd':
+            dedup_window_ms = atoi(optarg);
+            if (dedup_window_ms < 1)
+            {
+                dberrorlf(FATAL "Dedup window must be positive.");
+                return -1;
+            }
+            break;
+        case 'Z':
+            compress_min_size = atoi(optarg);
+            if (compress_min_size < 1 || compress_min_size > GSS_FRAME_MAX_PAYLOAD_SIZE)
+            {
+                dberrorlf(FATAL "Compression threshold must be between 1 and %d bytes.", GSS_FRAME_MAX_PAYLOAD_SIZE);
+                return -1;
+            }
+            break;
+        case 'H':
+            if (gss_latency_parse(optarg, &latency_every, &latency_path) < 0)
+            {
+                dberrorlf(FATAL "Latency sampling must be every[,trace_file] (every positive).");
+                return -1;
+            }
+            break;
+        case 'k':
+            if (gss_health_parse_keepalive(optarg, &global->health) < 0)
+            {
+                dberrorlf(FATAL "Keepalive must be idle_s,interval_s,count (all positive).");
+                return -1;
+            }
+            break;
+        case 'u':
+            global->health.user_timeout_ms = atoi(optarg);
+            if (global->health.user_timeout_ms < 1)
+            {
+                dberrorlf(FATAL "User timeout must be positive.");
+                return -1;
+            }
+            break;
+        case 'b':
+            if (gss_health_parse_heartbeat(optarg, &global->health) < 0)
+            {
+                dberrorlf(FATAL "Heartbeat must be interval_ms[,misses] (both positive).");
+                return -1;
+            }
+            break;
+        case 'T':
+            drain_s = atoi(optarg);
+            if (drain_s < 0)
+            {
+                dberrorlf(FATAL "Drain timeout must not be negative.");
+                return -1;
+            }
+            break;
+        case 'P':
+            ready_path = optarg;
+            break;
+        default:
+            dberrorlf(RED_FG "Usage: %s [-C topology_file] [-r num_reactors] [-q oldest|newest|block] [-c txq_capacity] [-p strict|control,command,bulk] [-z splice_threshold] [-e frame|batch|uring] [-l log_directory] [-L log_rotate_mb] [-R capture_directory] [-v 0-3] [-n] [-m max_clients] [-a any|first] [-M metrics_port] [-S spool_ttl_s[,frames]] [-D spool_directory[,segment_mb]] [-d dedup_window_ms] [-Z compress_min_bytes] [-H every[,trace_file]] [-k idle,interval,count] [-u user_timeout_ms] [-b heartbeat_ms[,misses]] [-T drain_s] [-P ready_file]", argv[0]);
+            return -1;
+        }
+    }
+
+    // The command line overrides the topology, which overrides the defaults.
+    if (topology_path == NULL)
+    {
+        gss_topology_default(&global->topology);
+    }
+    else if (gss_topology_load(topology_path, &global->topology) < 0)
+    {
+        return -1;
+    }
+    const gss_topology_t *topology = &global->topology;
+
+    if (max_clients == 0)
+    {
+        max_clients = topology->max_clients > 0 ? topology->max_clients : GSS_DEFAULT_CLIENTS;
+    }
+    if (txq_capacity == 0)
+    {
+        txq_capacity = topology->txq_capacity > 0 ? topology->txq_capacity : GSS_TXQ_DEFAULT_CAPACITY;
+    }
+    if (max_clients > GSS_MAX_CLIENTS)
+    {
+        dberrorlf(FATAL "Number of clients must be between 1 and %d.", GSS_MAX_CLIENTS);
+        return -1;
+    }
+    if (recv_engine != GSS_RECV_FRAME && splice_threshold > 0)
+    {
+        dberrorlf(FATAL "Splicing (-z) needs frames received one at a time (-e frame).");
+        return -1;
+    }
+    if (capture_directory != NULL && splice_threshold > 0)
+    {
+        dberrorlf(FATAL "Capturing (-R) needs every payload, which splicing (-z) never sees.");
+        return -1;
+    }
+    if (num_reactors > topology->num_vertices)
+    {
+        dberrorlf(FATAL "Number of reactors must be between 1 and %d (the number of vertices).", topology->num_vertices);
+        return -1;
+    }
+
+    global->max_clients = max_clients;
+    global->num_connections = topology->num_vertices - 1 + max_clients;
+    global->uplink_policy = uplink_policy;
+    global->connected = 0;
+
+    // Each vertex has its own connection; the client's additional connections come after the last vertex's.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        global->vertex_connections[gss_vertex(global, i)] |= 1u << i;
+    }
+
+    // Create a network_data object for each connection with its vertex's port.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        global->network_data[i] = new NetDataServer((NetPort)topology->vertices[gss_vertex(global, i)].port);
+        global->network_data[i]->socket = -1;
+        pthread_mutex_init(&global->tx_lock[i], NULL);
+    }
+
+    global->pool = gss_pool_create();
+    global->splice_threshold = splice_threshold;
+    global->recv_engine = recv_engine;
+    global->netstat = 0x0;
+    global->netstat_push = netstat_push;
+    pthread_mutex_init(&global->netstat_lock, NULL);
+
+    if (metrics_port > 0)
+    {
+        global->metrics = gss_metrics_create(metrics_port, topology);
+    }
+
+    if (spool_config.ttl_s > 0)
+    {
+        for (int i = 0; i < topology->num_vertices; i++)
+        {
+            global->spool[i] = gss_spool_create(topology->vertices[i].id, &spool_config, global->pool);
+            if (global->spool[i] == NULL)
+            {
+                return -1;
+            }
+        }
+    }
+
+    if (dedup_window_ms > 0)
+    {
+        for (int i = 0; i < topology->num_vertices; i++)
+        {
+            global->dedup[i] = gss_dedup_create(dedup_window_ms);
+        }
+    }
+
+    if (compress_min_size > 0)
+    {
+        global->compress = gss_compress_create(compress_min_size);
+    }
+
+    // Reactors take a socket with anything on its error queue for a failed connection, so their writers do without transmit timestamps.
+    if (latency_every > 0)
+    {
+        global->latency = gss_latency_create(latency_every, latency_path, num_reactors == 0, topology, global->pool);
+        if (global->latency == NULL)
+        {
+            return -1;
+        }
+    }
+
+    // Block the handled signals before any thread starts so that every thread inherits the mask, then let the signal thread wait for them.
+    sigset_t handled_signals;
+    sigemptyset(&handled_signals);
+    sigaddset(&handled_signals, SIGUSR1);
+    sigaddset(&handled_signals, SIGTERM);
+    sigaddset(&handled_signals, SIGINT);
+    sigaddset(&handled_signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &handled_signals, NULL);
+
+    // Every vertex's port and the metrics port are handed to the next instance on SIGHUP.
+    gss_reload_init(argv, topology->num_vertices + (metrics_port > 0 ? 1 : 0), ready_path);
+
+    // Bind every port before any worker starts, so that the server is ready (see gss_reload_listening(...)) as soon as the last one is listening.
+    for (int i = 0; i < topology->num_vertices; i++)
+    {
+        global->listening_socket[i] = gss_network_listen(global, i);
+        if (global->listening_socket[i] < 0)
+        {
+            return -1;
+        }
+    }
+    if (global->metrics != NULL && gss_metrics_listen(global->metrics) < 0)
+    {
+        return -1;
+    }
+
+    // Begin writer threads, one per destination socket.
+    for (int i = 0; i < global->num_connections; i++)
+    {
+        global->txq[i] = gss_txq_create(txq_capacity, txq_policy, i, global->network_data[i], &global->connected, &global->tx_lock[i], global->pool);
+        if (global->txq[i] != NULL)
+        {
+            global->txq[i]->metrics = global->metrics;
+            global->txq[i]->latency = global->latency;
+            global->txq[i]->vertex = gss_vertex(global, i);
+            global->txq[i]->spool = global->spool[gss_vertex(global, i)];
+            global->txq[i]->spool_unsent = gss_vertex(global, i) != topology->client;
+            global->txq[i]->server_id = topology->server_id;
+            global->txq[i]->to_client = gss_vertex(global, i) == topology->client;
+            memcpy(global->txq[i]->weights, txq_weights, sizeof(txq_weights));
+        }
+        if (global->txq[i] == NULL || gss_topology_create_thread(&global->tx_pid[i], &topology->vertices[gss_vertex(global, i)], gss_txq_writer_thread, global->txq[i]) < 0)
+        {
+            dberrorlf(FATAL "Writer %d failed to start.", i);
+            return -1;
+        }
+    }
+
+    // Begin the frame log's writer, if logging.
+    if (log_directory != NULL)
+    {
+        global->log = gss_log_create(log_directory, "gsslog", GSS_LOG_MAGIC, log_rotate_size, global->pool);
+        if (global->log == NULL || pthread_create(&global->log_pid, NULL, gss_log_writer_thread, global->log) != 0)
+        {
+            dberrorlf(FATAL "Frame log failed to start.");
+            return -1;
+        }
+    }
+
+    // Begin the capture's writer, if capturing.
+    if (capture_directory != NULL)
+    {
+        global->capture = gss_log_create(capture_directory, GSS_CAPTURE_NAME, GSS_CAPTURE_MAGIC, log_rotate_size, global->pool);
+        if (global->capture == NULL || pthread_create(&global->capture_pid, NULL, gss_log_writer_thread, global->capture) != 0)
+        {
+            dberrorlf(FATAL "Capture failed to start.");
+            return -1;
+        }
+    }
+
+    // Begin the latency trace's writer, if tracing to a file.
+    if (global->latency != NULL && global->latency->file != NULL && pthread_create(&global->latency_pid, NULL, gss_latency_writer_thread, global->latency) != 0)
+    {
+        dberrorlf(FATAL "Latency trace failed to start.");
+        return -1;
+    }
+
+    // Begin serving metrics, if enabled.
+    if (global->metrics != NULL && pthread_create(&global->metrics_pid, NULL, gss_metrics_thread, global) != 0)
+    {
+        dberrorlf(FATAL "Metrics thread failed to start.");
+        return -1;
+    }
+
+    // Begin heartbeats, if enabled.
+    if (global->health.heartbeat_ms > 0 && pthread_create(&global->health_pid, NULL, gss_health_thread, global) != 0)
+    {
+        dberrorlf(FATAL "Heartbeat thread failed to start.");
+        return -1;
+    }
+
+    global->drain_s = drain_s;
+    pthread_t signal_pid;
+    if (pthread_create(&signal_pid, NULL, gss_main_signal_thread, global) == 0)
+    {
+        pthread_detach(signal_pid);
     }
 
     // Activate each thread's receive ability.
-    for (int i = 0; i < NUM_PORTS; i++)
+    for (int i = 0; i < global->num_connections; i++)
     {
         global->network_data[i]->recv_active = true;
     }
 
+    if (num_reactors > 0)
+    {
+        pthread_t reactor_pid[GSS_MAX_VERTICES];
+        gss_reactor_args_t reactor_args[GSS_MAX_VERTICES];
+
+        for (int i = 0; i < num_reactors; i++)
+        {
+            reactor_args[i].global = global;
+            reactor_args[i].reactor_index = i;
+            reactor_args[i].num_reactors = num_reactors;
+
+            if (pthread_create(&reactor_pid[i], NULL, gss_reactor_thread, &reactor_args[i]) != 0)
+            {
+                dberrorlf(FATAL "Reactor %d failed to start.", i);
+                return -1;
+            }
+            dbinfolf(GREEN_FG "Reactor %d started.", i);
+        }
+
+        for (int i = 0; i < num_reactors; i++)
+        {
+            if (pthread_join(reactor_pid[i], NULL) != 0)
+            {
+                dberrorlf(RED_FG "Reactor %d failed to join.", i);
+            }
+            else
+            {
+                dbinfolf(GREEN_FG "Reactor %d joined.", i);
+            }
+        }
+
+        gss_drain(global);
+        gss_main_cleanup(global);
+
+        return 1;
+    }
+
     // Begin receiver threads.
-    // 0:Client, 1:RoofUHF, 2: RoofXB, 3: Haystack, 4: Track
-    for (int i = 0; i < NUM_PORTS; i++)
+    // One per vertex, in topology order (by default 0:Client, 1:RoofUHF, 2: RoofXB, 3: Haystack, 4: Track), then the additional Clients.
+    gss_rx_args_t rx_args[GSS_MAX_CONNECTIONS];
+    for (int i = 0; i < global->num_connections; i++)
     {
-        if (pthread_create(&global->pid[i], NULL, gss_network_rx_thread, global) != 0)
+        rx_args[i].global = global;
+        rx_args[i].t_index = i;
+
+        if (gss_topology_create_thread(&global->pid[i], &topology->vertices[gss_vertex(global, i)], gss_network_rx_thread, &rx_args[i]) < 0)
         {
-            dbprintlf(FATAL "Thread %d failed to start.", i);
+            dberrorlf(FATAL "Thread %d failed to start.", i);
             return -1;
         }
         else
         {
-            dbprintlf(GREEN_FG "Thread %d started.", i);
+            dbinfolf(GREEN_FG "Thread %d started.", i);
         }
     }
 
-    for (int i = 0; i < NUM_PORTS; i++)
+    for (int i = 0; i < global->num_connections; i++)
     {
         void *status;
         if (pthread_join(global->pid[i], &status) != 0)
         {
-            dbprintlf(RED_FG "Thread %d failed to join.", i);
+            dberrorlf(RED_FG "Thread %d failed to join.", i);
         }
         else
         {
-            dbprintlf(GREEN_FG "Thread %d joined.", i);
+            dbinfolf(GREEN_FG "Thread %d joined.", i);
         }
     }
 
@@ -85,10 +712,8 @@ int main(int argc, char *argv[])
     // - Accept, perform relevant actions, and respond.
 
     // Finished.
-    for (int i = 0; i < NUM_PORTS; i++)
-    {
-        delete global->network_data[i];
-    }
+    gss_drain(global);
+    gss_main_cleanup(global);
 
     return 1;
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+/**
+ * @file gss_logdump.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Decodes and filters the server's binary frame logs (see gss_log.hpp).
+ * @version 0.1
+ * @date 2026.10.16
+ *
+ * Usage: gss_logdump.out [-o origin] [-d destination] [-t type] [-s start_s] [-u until_s] [-p] file...
+ *
+ * Times are UNIX seconds. -p also prints each payload in hex.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "gss_log.hpp"
+
+typedef struct
+{
+    int origin;
+    int destination;
+    long type;
+    uint64_t start_ns;
+    uint64_t until_ns;
+    bool payload;
+} gss_logdump_filter_t;
+
+static bool gss_logdump_match(const gss_logdump_filter_t *filter, const gss_log_record_t *record)
+{
+    return (filter->origin < 0 || filter->origin == record->origin) &&
+           (filter->destination < 0 || filter->destination == record->destination) &&
+           (filter->type < 0 || filter->type == record->type) &&
+           record->timestamp_ns >= filter->start_ns &&
+           record->timestamp_ns <= filter->until_ns;
+}
+
+static void gss_logdump_print(const gss_logdump_filter_t *filter, const gss_log_record_t *record, const unsigned char *payload)
+{
+    time_t seconds = record->timestamp_ns / 1000000000ULL;
+    struct tm calendar;
+    char when[32];
+    localtime_r(&seconds, &calendar);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &calendar);
+
+    printf("%s.%09lu  %d -> %d  type 0x%02x  netstat 0x%02x  %u bytes%s%s%s\n", when, (unsigned long)(record->timestamp_ns % 1000000000ULL),
+           record->origin, record->destination, record->type, record->netstat, record->payload_size,
+           (record->flags & GSS_LOG_FLAG_NO_PAYLOAD) ? "  (spliced, payload not logged)" : "",
+           (record->flags & GSS_LOG_FLAG_NOT_FORWARDED) ? "  (not forwarded)" : "",
+           (record->flags & GSS_LOG_FLAG_SPOOLED) ? "  (spooled)" : "");
+
+    if (filter->payload && !(record->flags & GSS_LOG_FLAG_NO_PAYLOAD))
+    {
+        for (uint32_t i = 0; i < record->payload_size; i++)
+        {
+            printf("%02x%s", payload[i], (i % 32 == 31 || i + 1 == record->payload_size) ? "\n" : " ");
+        }
+    }
+}
+
+/**
+ * @brief Prints every record in one log file which passes the filter.
+ *
+ * @return int Number of records printed, or -1 if the file is not a log.
+ */
+static int gss_logdump_file(const char *path, const gss_logdump_filter_t *filter)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "%s: could not open.\n", path);
+        return -1;
+    }
+
+    gss_log_file_header_t file_header;
+    if (fread(&file_header, sizeof(file_header), 1, fp) != 1 || memcmp(file_header.magic, GSS_LOG_MAGIC, sizeof(file_header.magic)) != 0)
+    {
+        fprintf(stderr, "%s: not a frame log.\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    static unsigned char payload[UINT16_MAX + 1];
+    gss_log_record_t record;
+    int printed = 0;
+
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+    {
+        uint32_t logged_size = (record.flags & GSS_LOG_FLAG_NO_PAYLOAD) ? 0 : record.payload_size;
+        if (logged_size > sizeof(payload) || fread(payload, 1, logged_size, fp) != logged_size)
+        {
+            fprintf(stderr, "%s: truncated record at offset %ld.\n", path, ftell(fp));
+            break;
+        }
+
+        if (gss_logdump_match(filter, &record))
+        {
+            gss_logdump_print(filter, &record, payload);
+            printed++;
+        }
+    }
+
+    fclose(fp);
+    return printed;
+}
+
+int main(int argc, char *argv[])
+{
+    gss_logdump_filter_t filter[1];
+    filter->origin = -1;
+    filter->destination = -1;
+    filter->type = -1;
+    filter->start_ns = 0;
+    filter->until_ns = UINT64_MAX;
+    filter->payload = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:d:t:s:u:p")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o':
+            filter->origin = atoi(optarg);
+            break;
+        case 'd':
+            filter->destination = atoi(optarg);
+            break;
+        case 't':
+            filter->type = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            filter->start_ns = strtoull(optarg, NULL, 10) * 1000000000ULL;
+            break;
+        case 'u':
+            filter->until_ns = strtoull(optarg, NULL, 10) * 1000000000ULL;
+            break;
+        case 'p':
+            filter->payload = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-o origin] [-d destination] [-t type] [-s start_s] [-u until_s] [-p] file...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        fprintf(stderr, "Usage: %s [-o origin] [-d destination] [-t type] [-s start_s] [-u until_s] [-p] file...\n", argv[0]);
+        return 1;
+    }
+
+    int retval = 0;
+    for (int i = optind; i < argc; i++)
+    {
+        if (gss_logdump_file(argv[i], filter) < 0)
+        {
+            retval = 1;
+        }
+    }
+
+    return retval;
+}